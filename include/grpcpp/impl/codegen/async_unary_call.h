@@ -173,22 +173,10 @@ class ClientAsyncResponseReader final
   void set_hash(::grpc::internal::Call call,const W& request) {
   
     //hash_arg,hash 㷨
-    char buf[ORIENTSEC_GRPC_PROPERTY_KEY_MAX_LEN] = {0};
-
-    orientsec_grpc_properties_get_value(
-        ORIENTSEC_GRPC_PROPERTIES_C_CONSISTENT_HASH_ARG, NULL, buf);
-    // add by yang
-    // style s = "name:\"heiden111111\"\n"
-    std::string str = single_buf.GetMessageName(request);
-    //ֵҪmapֵ洢Ҫ
-
-    std::map<std::string, std::string> map_;
-    std::vector<std::string> buf_vec;
-    orientsec_grpc_split_to_vec(buf, buf_vec, ",");
-    orientsec_grpc_split_to_map(str, map_, "\n");
-
+    // õֶȡپDebugString
     std::string hash_arg;
-    orientsec_grpc_joint_hash_input(map_, buf_vec, hash_arg);
+    single_buf.GetHashArg(request, orientsec_grpc_consistent_hash_arg_fields(),
+                          &hash_arg);
 
     //ݸcall 
     orientsec_grpc_setcall_hashinfo(call.call(), hash_arg.c_str());
@@ -203,7 +191,6 @@ class ClientAsyncResponseReader final
     // TODO(ctiller): don't assert
     GPR_CODEGEN_ASSERT(single_buf.SendMessage(request).ok());
     // Get the hash info from request object
-    // string str = single_buf.GetMessageName(request);
     set_hash(call,request);
 
     //----begin---- 
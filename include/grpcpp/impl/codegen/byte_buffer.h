@@ -209,10 +209,10 @@ class SerializationTraits<ByteBuffer, void> {
     return Status::OK;
   }
   //----begin----build adaption by jianbin
-  static string callSerialize(const ByteBuffer& byte_buffer) {
-    string ss(0);
-    return ss;
-  }
+  // raw bytes carry no fields, no hash argument
+  static void callHashArg(const ByteBuffer& byte_buffer,
+                          const std::vector<grpc::string>& fields,
+                          grpc::string* hash_arg) {}
   //----end----
 };
 
@@ -305,8 +305,10 @@ class CallOpSendMessage {
   template <class M>
   Status SendMessage(const M& message) GRPC_MUST_USE_RESULT;
   //----begin----
+  // reads the consistent hash argument fields of message
   template <class M>
-  string GetMessageName(const M& message)  GRPC_MUST_USE_RESULT;
+  void GetHashArg(const M& message, const std::vector<grpc::string>& fields,
+                  grpc::string* hash_arg);
   //-----end-----
 
  protected:
@@ -366,8 +368,10 @@ Status CallOpSendMessage::SendMessage(const M& message) {
 
 //----begin----
 template <class M>
-string CallOpSendMessage::GetMessageName(const M& message) {
-  return SerializationTraits<M,void>::callSerialize(message);
+void CallOpSendMessage::GetHashArg(const M& message,
+                                   const std::vector<grpc::string>& fields,
+                                   grpc::string* hash_arg) {
+  SerializationTraits<M, void>::callHashArg(message, fields, hash_arg);
 }
 //-----end-----
 template <class R>
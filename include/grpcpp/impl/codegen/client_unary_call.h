@@ -72,28 +72,15 @@ class BlockingUnaryCallImpl {
 
     //----begin----
     //hash_arg,hash 㷨
-    char buf[ORIENTSEC_GRPC_PROPERTY_KEY_MAX_LEN] = {0};
-
-    orientsec_grpc_properties_get_value(ORIENTSEC_GRPC_PROPERTIES_C_CONSISTENT_HASH_ARG,
-                                   NULL, buf);
-    // add by yang
-    // style s = "name:\"heiden111111\"\n"
-    std::string str = ops.GetMessageName(request);
-    //ֵҪmapֵ洢Ҫ
-    std::map<std::string, std::string> map_;
-    std::vector<std::string> buf_vec;
-    orientsec_grpc_split_to_vec(buf, buf_vec, ",");
-    orientsec_grpc_split_to_map(str, map_, "\n");
-
+    // õֶȡپDebugString
     std::string hash_arg;
-    orientsec_grpc_joint_hash_input(map_, buf_vec, hash_arg);
+    ops.GetHashArg(request, orientsec_grpc_consistent_hash_arg_fields(),
+                   &hash_arg);
 
     // Get method name
-    std::string m_fullname = method.name();
-    std::vector<std::string> ret;
-    orientsec_grpc_split_to_vec(m_fullname,ret ,"/");
-    std::string m_name = ret.back();
-    orientsec_grpc_setcall_methodname(call.call(), m_name.c_str());
+    const char* m_name = strrchr(method.name(), '/');
+    m_name = (m_name == nullptr) ? method.name() : m_name + 1;
+    orientsec_grpc_setcall_methodname(call.call(), m_name);
 
     //ݸcall 
     orientsec_grpc_transfer_setcall_hashinfo(call.call(), hash_arg.c_str());
@@ -102,8 +89,8 @@ class BlockingUnaryCallImpl {
     //----debug use----
     //const char* name = method.name();
     if (orientsec_grpc_consumer_control_requests(method.name()) == -1) {
-      Status state(StatusCode::EXCEEDING_REQUESTS,
-                   "Exceeding maximum requests");
+      status_ = Status(StatusCode::EXCEEDING_REQUESTS,
+                       "Exceeding maximum requests");
       return;
     }
 
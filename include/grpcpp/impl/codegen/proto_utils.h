@@ -21,7 +21,13 @@
 #ifndef GRPCPP_IMPL_CODEGEN_PROTO_UTILS_H
 #define GRPCPP_IMPL_CODEGEN_PROTO_UTILS_H
 
+#include <float.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <algorithm>
 #include <type_traits>
+#include <unordered_map>
+#include <vector>
 
 #include <grpc/impl/codegen/byte_buffer_reader.h>
 #include <grpc/impl/codegen/grpc_types.h>
@@ -97,6 +103,138 @@ Status GenericDeserialize(ByteBuffer* buffer, grpc::protobuf::Message* msg) {
   return result;
 }
 
+//----begin----
+namespace internal {
+
+// Appends the value of \a field (the first element if repeated) to \a out,
+// numbers and enums formatted as the text format prints them, messages as
+// their DebugString(). Returns false if the field is unset.
+inline bool AppendHashArgField(const grpc::protobuf::Message& msg,
+                               const grpc::protobuf::FieldDescriptor* field,
+                               grpc::string* out) {
+  typedef grpc::protobuf::FieldDescriptor FieldDescriptor;
+  const auto* reflection = msg.GetReflection();
+  const bool repeated = field->is_repeated();
+  if (repeated ? reflection->FieldSize(msg, field) == 0
+               : !reflection->HasField(msg, field)) {
+    return false;
+  }
+#define ORIENTSEC_HASH_ARG_GET(type)                          \
+  (repeated ? reflection->GetRepeated##type(msg, field, 0) \
+            : reflection->Get##type(msg, field))
+  char buf[32];
+  switch (field->cpp_type()) {
+    case FieldDescriptor::CPPTYPE_STRING: {
+      grpc::string scratch;
+      out->append(repeated ? reflection->GetRepeatedStringReference(
+                                 msg, field, 0, &scratch)
+                           : reflection->GetStringReference(msg, field,
+                                                            &scratch));
+      return true;
+    }
+    case FieldDescriptor::CPPTYPE_INT32:
+      snprintf(buf, sizeof(buf), "%d", (int)ORIENTSEC_HASH_ARG_GET(Int32));
+      break;
+    case FieldDescriptor::CPPTYPE_INT64:
+      snprintf(buf, sizeof(buf), "%lld",
+               (long long)ORIENTSEC_HASH_ARG_GET(Int64));
+      break;
+    case FieldDescriptor::CPPTYPE_UINT32:
+      snprintf(buf, sizeof(buf), "%u",
+               (unsigned)ORIENTSEC_HASH_ARG_GET(UInt32));
+      break;
+    case FieldDescriptor::CPPTYPE_UINT64:
+      snprintf(buf, sizeof(buf), "%llu",
+               (unsigned long long)ORIENTSEC_HASH_ARG_GET(UInt64));
+      break;
+    case FieldDescriptor::CPPTYPE_DOUBLE:
+    case FieldDescriptor::CPPTYPE_FLOAT: {
+      // shortest precision that round trips, like SimpleDtoa/SimpleFtoa
+      const bool is_double =
+          field->cpp_type() == FieldDescriptor::CPPTYPE_DOUBLE;
+      const double value = is_double ? ORIENTSEC_HASH_ARG_GET(Double)
+                                     : ORIENTSEC_HASH_ARG_GET(Float);
+      snprintf(buf, sizeof(buf), "%.*g", is_double ? DBL_DIG : FLT_DIG,
+               value);
+      if (is_double ? strtod(buf, nullptr) != value
+                    : strtof(buf, nullptr) != (float)value) {
+        snprintf(buf, sizeof(buf), "%.*g",
+                 is_double ? DBL_DIG + 2 : FLT_DIG + 3, value);
+      }
+      break;
+    }
+    case FieldDescriptor::CPPTYPE_BOOL:
+      out->append(ORIENTSEC_HASH_ARG_GET(Bool) ? "true" : "false");
+      return true;
+    case FieldDescriptor::CPPTYPE_ENUM:
+      out->append(ORIENTSEC_HASH_ARG_GET(Enum)->name());
+      return true;
+    case FieldDescriptor::CPPTYPE_MESSAGE:
+      out->append(ORIENTSEC_HASH_ARG_GET(Message).DebugString());
+      return true;
+    default:
+      return false;
+  }
+#undef ORIENTSEC_HASH_ARG_GET
+  out->append(buf);
+  return true;
+}
+
+// The configured hash fields of one message type resolved to descriptors,
+// and all of its fields ordered by name for the fallback.
+struct HashArgFields {
+  const std::vector<grpc::string>* names = nullptr;
+  std::vector<const grpc::protobuf::FieldDescriptor*> configured;
+  std::vector<const grpc::protobuf::FieldDescriptor*> by_name;
+};
+
+// Resolves \a fields against \a descriptor once per thread and message type.
+inline const HashArgFields& ResolveHashArgFields(
+    const grpc::protobuf::Descriptor* descriptor,
+    const std::vector<grpc::string>& fields) {
+  static thread_local std::unordered_map<const grpc::protobuf::Descriptor*,
+                                         HashArgFields>
+      cache;
+  HashArgFields& entry = cache[descriptor];
+  if (entry.names == &fields) return entry;
+  entry.names = &fields;
+  entry.configured.clear();
+  entry.by_name.clear();
+  for (size_t i = 0; i < fields.size(); i++) {
+    const grpc::protobuf::FieldDescriptor* field =
+        descriptor->FindFieldByName(fields[i]);
+    if (field != nullptr) entry.configured.push_back(field);
+  }
+  for (int i = 0; i < descriptor->field_count(); i++) {
+    entry.by_name.push_back(descriptor->field(i));
+  }
+  std::sort(entry.by_name.begin(), entry.by_name.end(),
+            [](const grpc::protobuf::FieldDescriptor* a,
+               const grpc::protobuf::FieldDescriptor* b) {
+              return a->name() < b->name();
+            });
+  return entry;
+}
+
+// Joins the values of the configured \a fields of \a msg into \a hash_arg.
+// Falls back to the set field whose name sorts first, as the DebugString map
+// did, when none of them is set or nothing is configured.
+inline void ExtractHashArg(const grpc::protobuf::Message& msg,
+                           const std::vector<grpc::string>& fields,
+                           grpc::string* hash_arg) {
+  const HashArgFields& resolved =
+      ResolveHashArgFields(msg.GetDescriptor(), fields);
+  for (size_t i = 0; i < resolved.configured.size(); i++) {
+    AppendHashArgField(msg, resolved.configured[i], hash_arg);
+  }
+  for (size_t i = 0; hash_arg->empty() && i < resolved.by_name.size(); i++) {
+    AppendHashArgField(msg, resolved.by_name[i], hash_arg);
+  }
+}
+
+}  // namespace internal
+//----end----
+
 // this is needed so the following class does not conflict with protobuf
 // serializers that utilize internal-only tools.
 #ifdef GRPC_OPEN_SOURCE_PROTO
@@ -108,9 +246,10 @@ class SerializationTraits<T, typename std::enable_if<std::is_base_of<
                                  grpc::protobuf::Message, T>::value>::type> {
  public:
   //----begin----
-  static string callSerialize(const grpc::protobuf::Message& msg) {
-    string ss;
-    return ss = msg.DebugString();
+  static void callHashArg(const grpc::protobuf::Message& msg,
+                          const std::vector<grpc::string>& fields,
+                          grpc::string* hash_arg) {
+    internal::ExtractHashArg(msg, fields, hash_arg);
   }
   //-----end-----
   static Status Serialize(const grpc::protobuf::Message& msg, ByteBuffer* bb,
@@ -140,6 +140,14 @@ typedef struct client_channel_channel_data {
   grpc_core::channelz::ClientChannelNode* channelz_channel;
   /* caches if the last resolution event contained addresses */
   bool previous_resolution_contained_addresses;
+  /* channelʱtargetнzookeeper:///svc ==> svc */
+  char* service_name;
+  /* ĵķ仯(channel)ԼchannelѴļ */
+  const gpr_atm* governance_generation;
+  gpr_atm governance_seen;
+  /* 仯combinerresolveͬһʱֻһ */
+  gpr_atm governance_reresolution_pending;
+  grpc_closure governance_reresolution;
 } channel_data;
 
 typedef struct {
@@ -319,36 +327,6 @@ static void request_reresolution_locked(void* arg, grpc_error* error) {
   chand->lb_policy->SetReresolutionClosureLocked(&args->closure);
 }
 
-//  ؽsubchannelʱresovler  lb Ϊյ
-static void process_resolver_shutdown_locked(channel_data* chand) {
-  //grpc_error* error = NULL;
-  if (chand->lb_policy != nullptr) {
-  
-    grpc_pollset_set_del_pollset_set(chand->lb_policy->interested_parties(),
-                                     chand->interested_parties);
-    //chand->lb_policy.reset();
-    chand->lb_policy = nullptr;
-  }
-  //if (chand->resolver != nullptr) {
-
-  //  chand->resolver.reset();
-  //  set_channel_connectivity_state_locked(
-  //      chand, GRPC_CHANNEL_SHUTDOWN,
-  //      GRPC_ERROR_CREATE_REFERENCING_FROM_STATIC_STRING(
-  //          "Resolver spontaneous shutdown", &error, 1),
-  //      "resolver_spontaneous_shutdown");
-  //}
-  //grpc_closure_list_fail_all(&chand->waiting_for_resolver_result_closures,
-  //                           GRPC_ERROR_CREATE_REFERENCING_FROM_STATIC_STRING(
-  //                               "Channel disconnected", &error, 1));
-  //GRPC_CLOSURE_LIST_SCHED(&chand->waiting_for_resolver_result_closures);
-  //GRPC_CHANNEL_STACK_UNREF(chand->owning_stack, "resolver");
-  grpc_channel_args_destroy(chand->resolver_result);
-  chand->resolver_result = nullptr;
- 
-}
-
-
 using TraceStringVector = grpc_core::InlinedVector<char*, 3>;
 
 // Creates a new LB policy, replacing any previous one.
@@ -700,6 +678,40 @@ static void cc_get_channel_info(grpc_channel_element* elem,
   gpr_mu_unlock(&chand->info_mu);
 }
 
+// 仯ں̨resolveӰڽеĵ
+static void governance_reresolution_locked(void* arg, grpc_error* ignored) {
+  channel_data* chand = static_cast<channel_data*>(arg);
+  gpr_atm_no_barrier_store(&chand->governance_reresolution_pending, 0);
+  if (chand->resolver != nullptr && chand->started_resolving) {
+    if (grpc_client_channel_trace.enabled()) {
+      gpr_log(GPR_INFO, "chand=%p: governance changed, re-resolving", chand);
+    }
+    chand->resolver->RequestReresolutionLocked();
+  }
+  GRPC_CHANNEL_STACK_UNREF(chand->owning_stack, "governance_reresolution");
+}
+
+// 鶩ĵ仯trueʾεҪα仯
+// òʱֻһtrue
+static bool governance_changed(channel_data* chand) {
+  if (chand->governance_generation == nullptr) {
+    return false;
+  }
+  gpr_atm generation = gpr_atm_acq_load(chand->governance_generation);
+  gpr_atm seen = gpr_atm_no_barrier_load(&chand->governance_seen);
+  if (GPR_LIKELY(generation == seen)) {
+    return false;
+  }
+  return gpr_atm_no_barrier_cas(&chand->governance_seen, seen, generation);
+}
+
+static void request_governance_reresolution(channel_data* chand) {
+  if (gpr_atm_no_barrier_cas(&chand->governance_reresolution_pending, 0, 1)) {
+    GRPC_CHANNEL_STACK_REF(chand->owning_stack, "governance_reresolution");
+    GRPC_CLOSURE_SCHED(&chand->governance_reresolution, GRPC_ERROR_NONE);
+  }
+}
+
 /* Constructor for channel_data */
 static grpc_error* cc_init_channel_elem(grpc_channel_element* elem,
                                         grpc_channel_element_args* args) {
@@ -733,6 +745,13 @@ static grpc_error* cc_init_channel_elem(grpc_channel_element* elem,
   chand->enable_retries = grpc_channel_arg_get_bool(arg, true);
   chand->channelz_channel = nullptr;
   chand->previous_resolution_contained_addresses = false;
+  chand->service_name = nullptr;
+  chand->governance_generation = nullptr;
+  gpr_atm_no_barrier_store(&chand->governance_seen, 0);
+  gpr_atm_no_barrier_store(&chand->governance_reresolution_pending, 0);
+  GRPC_CLOSURE_INIT(&chand->governance_reresolution,
+                    governance_reresolution_locked, chand,
+                    grpc_combiner_scheduler(chand->combiner));
   // Record client channel factory.
   arg = grpc_channel_args_find(args->channel_args,
                                GRPC_ARG_CLIENT_CHANNEL_FACTORY);
@@ -758,6 +777,13 @@ static grpc_error* cc_init_channel_elem(grpc_channel_element* elem,
     return GRPC_ERROR_CREATE_FROM_STATIC_STRING(
         "server uri arg must be a string");
   }
+  chand->service_name = orientsec_grpc_get_sn_from_target(arg->value.string);
+  if (chand->service_name != nullptr) {
+    chand->governance_generation =
+        consumer_governance_subscribe(chand->service_name);
+    gpr_atm_no_barrier_store(&chand->governance_seen,
+                             gpr_atm_acq_load(chand->governance_generation));
+  }
   char* proxy_name = nullptr;
   grpc_channel_args* new_args = nullptr;
   grpc_proxy_mappers_map_name(arg->value.string, args->channel_args,
@@ -807,6 +833,9 @@ static void cc_destroy_channel_elem(grpc_channel_element* elem) {
   GRPC_COMBINER_UNREF(chand->combiner, "client_channel");
   gpr_mu_destroy(&chand->info_mu);
   gpr_mu_destroy(&chand->external_connectivity_watcher_list_mu);
+  if (chand->service_name != nullptr) {
+    free(chand->service_name);
+  }
 }
 
 /*************************************************************************
@@ -3152,67 +3181,37 @@ static void start_pick_locked(void* arg, grpc_error* ignored) {
     lb_policy->hash_lb = hash_value;
     //ڴؾ,ΪЧʾ֮ǰ
     bool req = is_request_loadbalance();
+    int picked = 0;
     // if (lb_policy->elem && is_request_loadbalance()) {  //ǵһε
     if (req) {
-      char* target = grpc_get_call_target(channel_call);
-      if (target) {
-        char* service_name = orientsec_grpc_get_sn_from_target(target);
-        if (service_name && strlen(service_name) != 0) {
-          int num;
-          provider_t* provider = consumer_query_providers_write_point_policy(
-              service_name, lb_policy, &num, meth_name);
-          if (provider && num > 0) {
-            char** provider_addrs = (char**)malloc((size_t)num * sizeof(char*));
-            //Ч·
-            for (int i = 0; i < num; ++i) {
-              provider_addrs[i] = (char*)gpr_malloc(64);
-              sprintf(provider_addrs[i], "%s:%d", provider[i].host,
-                      provider[i].port);
-            }
-            // grpc_lb_policy_clear_invalid_lb_subchannel_locked(
-            //   exec_ctx, lb_policy, provider_addrs, num);
-            for (int i = 0; i < num; ++i) {
-              gpr_free(provider_addrs[i]);
-            }
-            gpr_free(provider_addrs);
-            free_provider_ex(&provider);
-            free(service_name);
-            //ûЧ·Ӧýѡpolicy߼
-            /*if (lb_policy->force_close) {
-              need_to_recreat_policy = true;
-            }*/
-          } else {
-            //Ӧý´policy߼
-            // grpc_lb_policy_clear_invalid_lb_subchannel_locked(
-            //   exec_ctx, lb_policy, NULL, 0);
-            free(service_name);
-            //need_to_recreat_policy = true;
-          }
-        } else {
-          gpr_log(GPR_DEBUG, "=========invalid servername, target=%s", target);
-        }
-      }
-    } /*else{ //connection mode 
-      if (GPR_UNLIKELY(chand->started_resolving)&&orientsec_grpc_version_changed_conn()) {
-        orientsec_reset_grpc_version_changed_conn();
-        //chand->lb_policy = nullptr;
-        chand->started_resolving = false;
-        chand->resolver->Setting();
-        process_resolver_shutdown_locked(chand);
-        //start_resolving_locked(chand);
-
-        grpc_core::New<grpc_core::ResolverResultWaiter>(elem);
-        maybe_add_call_to_channel_interested_parties_locked(elem);
-        return;
-        
+      char* service_name = chand->service_name;
+      if (service_name && strlen(service_name) != 0) {
+        // ѡеproviderдlb_policy->provider_addrûпѡproviderʱ
+        picked = consumer_pick_provider_write_point_policy(
+            service_name, lb_policy, meth_name);
+      } else {
+        lb_policy->provider_addr[0] = '\0';
+        gpr_log(GPR_DEBUG, "=========invalid servername, target=%s",
+                grpc_get_call_target(channel_call));
       }
-
-    }*/
+    }
     //----begin- ݴʱϢı
     lb_policy->elem = elem;
     // ѻȡؾѡȡipchannel
     grpc_set_call_provider_addr(grpc_get_call_from_top_elem(elem),
                                 lb_policy->provider_addr);
+    // ѡprovider;callյ״̬ʱͷš
+    // ؾûѡproviderʱҲpick̶֮ǰprovider
+    if (req && picked == 0) {
+      lb_policy->provider_load = nullptr;
+    } else if (lb_policy->provider_load == nullptr) {
+      lb_policy->provider_load =
+          consumer_provider_load_find(lb_policy->provider_addr);
+    }
+    orientsec_grpc_setcall_provider_load(channel_call,
+                                         lb_policy->provider_load);
+    // pickLBpendingpick֮ѡȡӰ
+    calld->pick.provider = req ? lb_policy->provider_load : nullptr;
     //-----end-----
 
     // We already have resolver results, so process the service config
@@ -3276,47 +3275,33 @@ static void cc_start_transport_stream_op_batch(
   } 
     /////add by liumin
     int have_no_provider = 0;
-    grpc_call* channel_call = grpc_get_call_from_top_elem(elem);
-    char* target = grpc_get_call_target(channel_call);
-    if (target) {
-      char* service_name = orientsec_grpc_get_sn_from_target(target);
-      //----debug ʱرؼڰ
-      if (service_name) {
-        if (orientsec_need_resolved()) {
-          orientsec_need_resolved_reset();
-          batch->payload->cancel_stream.cancel_error =
-              GRPC_ERROR_CREATE_FROM_STATIC_STRING("resolving is running.");
+    // ڴchannelʱ״̬ȡprovider
+    char* service_name = chand->service_name;
+    //----debug ʱرؼڰ
+    if (service_name) {
+      orientsec_grpc_governance_state governance;
+      consumer_governance_state_get(service_name, &governance);
+      //ڰûЧprovider
+      if (0 == governance.lb_providers) {
+        //УǷп÷
+        if (0 == governance.providers) {
+          batch->payload->cancel_stream.cancel_error = GRPC_ERROR_CANCELLED;
+          // batch->cancel_error = GRPC_ERROR_CANCELLED;
+          // op->cancel_error = GRPC_ERROR_CREATE("There are no providers in
+          // registry center,please check the service name");
+        } else {
+          batch->payload->cancel_stream
+              .cancel_error = GRPC_ERROR_CREATE_FROM_STATIC_STRING(
+              "The provider is being forbid for this client,or provider has go away");
           calld->cancel_error =
               GRPC_ERROR_REF(batch->payload->cancel_stream.cancel_error);
-          chand->started_resolving = false;
-          have_no_provider = 1;
-          //chand->resolver->Resetting();
-          //process_resolver_shutdown_locked(chand);
         }
-        //ڰûЧprovider
-        int provider_count = get_consumer_lb_providers_acount(service_name);
-        if (0 == provider_count) {
-          //УǷп÷
-          if (0 == get_consumer_providers_acount(service_name)) {
-            batch->payload->cancel_stream.cancel_error = GRPC_ERROR_CANCELLED;
-            // batch->cancel_error = GRPC_ERROR_CANCELLED;
-            // op->cancel_error = GRPC_ERROR_CREATE("There are no providers in
-            // registry center,please check the service name");
-          } else {
-            batch->payload->cancel_stream
-                .cancel_error = GRPC_ERROR_CREATE_FROM_STATIC_STRING(
-                "The provider is being forbid for this client,or provider has go away");
-            calld->cancel_error =
-                GRPC_ERROR_REF(batch->payload->cancel_stream.cancel_error);
-          }
-          chand->started_resolving = false;
-          have_no_provider = 1;
-        } else {
-     
-          // 汾
-        int provider_num = provider_num_after_service_check(service_name);
-          // ûпõķ汾,ֱcancel
-        if ( 0 == provider_num ) {
+        chand->started_resolving = false;
+        have_no_provider = 1;
+      } else {
+        // 汾
+        // ûпõķ汾,ֱcancel
+        if (0 == governance.version_matched) {
           batch->payload->cancel_stream.cancel_error =
               GRPC_ERROR_CREATE_FROM_STATIC_STRING(
                   "There is no appropriate service version online");
@@ -3326,80 +3311,25 @@ static void cc_start_transport_stream_op_batch(
           chand->started_resolving = false;
           have_no_provider = 1;
         } else {
-          if (orientsec_grpc_version_changed_conn()) {   // connetcion mode
-            // reset flag
-            orientsec_reset_grpc_version_changed_conn();
-            batch->payload->cancel_stream.cancel_error =
-                GRPC_ERROR_CREATE_FROM_STATIC_STRING(
-                    "service version switching...");
-            calld->cancel_error =
-                GRPC_ERROR_REF(batch->payload->cancel_stream.cancel_error);
-            chand->started_resolving = false;
-            chand->resolver->Resetting();
-            process_resolver_shutdown_locked(chand);
-          }
-          // method load balance occurred, then resolve again
-          if (orientsec_method_lb_changed()) {  // ⵽method urlı
-            orientset_method_lb_reset();
-            batch->payload->cancel_stream.cancel_error =
-                GRPC_ERROR_CREATE_FROM_STATIC_STRING(
-                    "method level load balance switching...");
-            calld->cancel_error =
-                GRPC_ERROR_REF(batch->payload->cancel_stream.cancel_error);
-            chand->started_resolving = false;
-            chand->resolver->Resetting();
-            process_resolver_shutdown_locked(chand);
-          }
-          
-          // ǷgroupԷ仯
-          if (orientsec_group_grade_changed()) {
-            orientsec_group_grade_reset();
-            batch->payload->cancel_stream.cancel_error =
-                GRPC_ERROR_CREATE_FROM_STATIC_STRING(
-                    "provider group property changing...");
-            calld->cancel_error =
-                GRPC_ERROR_REF(batch->payload->cancel_stream.cancel_error);
-            chand->started_resolving = false;
-            chand->resolver->Resetting();
-            process_resolver_shutdown_locked(chand);
-          }
-
           // ȡproviderûУ޸onlineԣresolve.
-          int active_num = provider_num_active_check(service_name);
-          gpr_log(GPR_DEBUG, "provider active_num = %d", active_num);
           // ûactive provider,standby server online
-          if (0 == active_num) {
-           //  provider online 
+          // onlineδ仯ʱprovider_active_standby_setting
+          gpr_log(GPR_DEBUG, "provider active_num = %d", governance.active);
+          if (0 == governance.active) {
+            //  provider online 
             provider_active_standby_setting(service_name, false);
-            printf("provider active_num = %d", active_num);
-          } 
-         
-            // Է仯
-            if (orientsec_active_standby_changed()) {
-              orientsec_active_standby_reset();
-              if (provider_num_active_check(service_name)) {
-                // master
-                 provider_active_standby_setting(service_name, true);
-              }else {
-                // ֻstandby
-                 provider_active_standby_setting(service_name, false);
-              }               
-              batch->payload->cancel_stream.cancel_error =
-                  GRPC_ERROR_CREATE_FROM_STATIC_STRING(
-                      "provider active/standby switching...");
-              calld->cancel_error =
-                  GRPC_ERROR_REF(batch->payload->cancel_stream.cancel_error);
-              chand->started_resolving = false;
-              chand->resolver->Resetting();
-              process_resolver_shutdown_locked(chand);
-            }
-          
+          }
+
+          // providerб顢ؾ⡢汾ȷ仯
+          if (governance_changed(chand)) {
+            // masterʱߣֻstandbyʱ
+            provider_active_standby_setting(service_name,
+                                            governance.active != 0);
+            request_governance_reresolution(chand);
+          }
         }
       }
-      // ͷservice_nameָ
-      free(service_name);
     }  // end service_name
-  }    // end target
   /////end by liumin
   //----begin by liumin----
   if (have_no_provider == 1) {
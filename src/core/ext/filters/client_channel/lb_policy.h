@@ -35,6 +35,9 @@
 
 extern grpc_core::DebugOnlyTraceFlag grpc_trace_lb_policy_refcount;
 
+// providerַ"ipv4:host:port"/"ipv6:[host]:port"󳤶
+#define ORIENTSEC_GRPC_PROVIDER_ADDR_LEN 64
+
 namespace grpc_core {
 
 /// Interface for load balancing policies.
@@ -90,14 +93,21 @@ class LoadBalancingPolicy
     void** user_data = nullptr;
     /// Next pointer.  For internal use by LB policy.
     PickState* next = nullptr;
+    /// ؾʱΪεѡеproviderʶ
+    /// (provider_load)Ϊʱround robinѡȡ
+    void* provider = nullptr;
   };
 
   //----begin----
-  char provider_addr[25] = {0};  //ipַ
+  char provider_addr[ORIENTSEC_GRPC_PROVIDER_ADDR_LEN] = {0};  //ipַ
   void* elem;                    //elem
   bool force_close;  // lujun ǿƽûпѡsubchannel
   // add by yang
   char* hash_lb = NULL;
+  // provider_addrӦĸͳƣַ仯ʱÿգѡȡʱַ²ҡ
+  // ͬһhost:portͳڽΨһҲͷţҲΪproviderıʶ
+  // ͨбֱӶλsubchannel
+  void* provider_load = nullptr;
   //-----end-----
 
   // Not copyable nor movable.
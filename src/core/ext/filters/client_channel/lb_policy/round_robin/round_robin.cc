@@ -28,10 +28,12 @@
 
 #include <grpc/support/port_platform.h>
 
+#include <stdio.h>
 #include <string.h>
 
 #include <grpc/support/alloc.h>
 
+#include "src/core/ext/filters/client_channel/client_channel.h"
 #include "src/core/ext/filters/client_channel/lb_policy/subchannel_list.h"
 #include "src/core/ext/filters/client_channel/lb_policy_registry.h"
 #include "src/core/ext/filters/client_channel/subchannel.h"
@@ -46,6 +48,7 @@
 #include "src/core/lib/transport/static_metadata.h"
 //----begin----
 //import balance mode
+#include "orientsec_consumer_intf.h"
 #include "orientsec_grpc_consumer_control_version.h"
 
 namespace grpc_core {
@@ -80,7 +83,7 @@ class RoundRobin : public LoadBalancingPolicy {
                                 channelz::ChildRefsList* ignored) override;
 
   //----begin----write ip from args to provider_addr for connection mode
-  void TransferArgIpToProviderIP(const grpc_channel_args& args);
+  void TransferArgIpToProviderIP(const grpc_lb_addresses* addresses);
   //----end----
 
  private:
@@ -156,6 +159,7 @@ class RoundRobin : public LoadBalancingPolicy {
       // any references to subchannels, since the subchannels'
       // pollset_sets will include the LB policy's pollset_set.
       policy->Ref(DEBUG_LOCATION, "subchannel_list").release();
+      if (UseProviderIndex(args)) BuildProviderIndexLocked();
     }
 
     ~RoundRobinSubchannelList() {
@@ -184,12 +188,37 @@ class RoundRobin : public LoadBalancingPolicy {
     // subchannels in each state.
     void UpdateRoundRobinStateFromSubchannelStateCountsLocked();
 
-    size_t GetNextReadySubchannelIndexLocked();
+    // provider is the one the governance layer chose for this pick
+    // (PickState::provider), nullptr for plain round robin.
+    size_t GetNextReadySubchannelIndexLocked(const void* provider);
     void UpdateLastReadySubchannelIndexLocked(size_t last_ready_index);
 
-    //----compare selected subchannel ip with provider ip
-    bool orientsec_grpc_item(size_t index, LoadBalancingPolicy* policy);
+    //----begin----
+    // providerʶsubchannel±꣬ûʱnum_subchannels()
+    size_t FindProviderSubchannelIndexLocked(const void* provider) const;
+    //----end----
    private:
+    struct ProviderSlot {
+      const void* provider = nullptr;
+      size_t index = 0;
+    };
+    static size_t ProviderHash(const void* provider) {
+      uintptr_t key = reinterpret_cast<uintptr_t>(provider) >> 4;
+      return static_cast<size_t>(key * 2654435761u);
+    }
+    // ֻ󼶸ؾµzookeeperͨŻѡprovider
+    static bool UseProviderIndex(const grpc_channel_args& args) {
+      if (!is_request_loadbalance()) return false;
+      const char* target =
+          grpc_channel_arg_get_string(grpc_channel_args_find(&args,
+                                                             GRPC_ARG_SERVER_URI));
+      return target != nullptr && strncmp(target, "zookeeper:", 10) == 0;
+    }
+    void BuildProviderIndexLocked();
+
+    // бʱõproviderʶ => subchannel±ĿѰַ
+    InlinedVector<ProviderSlot, 16> provider_slots_;
+    size_t provider_mask_ = 0;
     size_t num_ready_ = 0;
     size_t num_connecting_ = 0;
     size_t num_transient_failure_ = 0;
@@ -224,6 +253,9 @@ class RoundRobin : public LoadBalancingPolicy {
    * racing callbacks that reference outdated subchannel lists won't perform any
    * update. */
   OrphanablePtr<RoundRobinSubchannelList> latest_pending_subchannel_list_;
+  /** addresses of the latest subchannel list, an update carrying the same
+   * addresses (e.g. after a governance change) keeps the current list. */
+  grpc_lb_addresses* addresses_ = nullptr;
   /** have we started picking? */
   bool started_picking_ = false;
   /** are we shutting down? */
@@ -244,7 +276,6 @@ RoundRobin::RoundRobin(const Args& args) : LoadBalancingPolicy(args) {
   gpr_mu_init(&child_refs_mu_);
   grpc_connectivity_state_init(&state_tracker_, GRPC_CHANNEL_IDLE,
                                "round_robin");
-  TransferArgIpToProviderIP(*args.args);
   UpdateLocked(*args.args, args.lb_config);
  
   if (grpc_lb_round_robin_trace.enabled()) {
@@ -262,17 +293,25 @@ RoundRobin::~RoundRobin() {
   GPR_ASSERT(subchannel_list_ == nullptr);
   GPR_ASSERT(latest_pending_subchannel_list_ == nullptr);
   GPR_ASSERT(pending_picks_ == nullptr);
+  if (addresses_ != nullptr) {
+    grpc_lb_addresses_destroy(addresses_);
+  }
   grpc_connectivity_state_destroy(&state_tracker_);
   grpc_subchannel_index_unref();
 }
 //----begin----
-void RoundRobin::TransferArgIpToProviderIP(const grpc_channel_args& args) {
-  const grpc_arg* arg = grpc_channel_args_find(&args, GRPC_ARG_LB_ADDRESSES);
-  grpc_lb_addresses* addresses =
-      static_cast<grpc_lb_addresses*>(arg->value.pointer.p);
-  grpc_resolved_address* addrs = &addresses->addresses[0].address;
+void RoundRobin::TransferArgIpToProviderIP(
+    const grpc_lb_addresses* addresses) {
+  if (addresses->num_addresses == 0) {
+    return;
+  }
   // write ip info into lb in format:"ipv4:ip:port"
-  sprintf(provider_addr, "%s", grpc_sockaddr_to_uri(addrs));
+  char* uri = grpc_sockaddr_to_uri(&addresses->addresses[0].address);
+  if (uri != nullptr) {
+    snprintf(provider_addr, sizeof(provider_addr), "%s", uri);
+    gpr_free(uri);
+  }
+  provider_load = nullptr;
 }
 //----end----
 void RoundRobin::HandOffPendingPicksLocked(LoadBalancingPolicy* new_policy) {
@@ -393,7 +432,7 @@ bool RoundRobin::DoPickLocked(PickState* pick) {
   //ȡ´εsubchannelindex൱1.2.4
   // selected = peek_next_connected_locked_choose_subchannel
   const size_t next_ready_index =
-      subchannel_list_->GetNextReadySubchannelIndexLocked();
+      subchannel_list_->GetNextReadySubchannelIndexLocked(pick->provider);
   if (next_ready_index < subchannel_list_->num_subchannels()) {
     /* readily available, report right away */
     RoundRobinSubchannelData* sd =
@@ -644,32 +683,46 @@ void RoundRobin::RoundRobinSubchannelData::ProcessConnectivityChangeLocked(
   subchannel_list()->UpdateRoundRobinStateFromSubchannelStateCountsLocked();
   RenewConnectivityWatchLocked();
 }
-//----begin----by yang
-// select readylist
-bool RoundRobin::RoundRobinSubchannelList::orientsec_grpc_item(
-    size_t index, LoadBalancingPolicy* policy) {
-  const char* host_info =
-      grpc_get_subchannel_address_uri_char(subchannel(index)->subchannel());
-  //printf("next suchannel host_info = %s\n", host_info);
-  unsigned int i = 0;
-  if (host_info == NULL) {
-    return false;
-  }
-  //memset(policy->provider_addr,0,sizeof(policy->provider_addr));
-  //host_info = strchr(host_info, ':') + 1;
-  if (strcmp(policy->provider_addr, "") == 0) {
-    for (i = 0; i < sizeof(policy->provider_addr) && i < strlen(host_info);
-         i++) {
-      policy->provider_addr[i] = host_info[i];
+//----begin----
+void RoundRobin::RoundRobinSubchannelList::BuildProviderIndexLocked() {
+  // ѰַΪ2ҲСsubchannel
+  size_t capacity = 4;
+  while (capacity < num_subchannels() * 2) capacity <<= 1;
+  provider_mask_ = capacity - 1;
+  for (size_t i = 0; i < capacity; ++i) {
+    provider_slots_.push_back(ProviderSlot());
+  }
+  for (size_t i = 0; i < num_subchannels(); ++i) {
+    const char* uri =
+        grpc_get_subchannel_address_uri_char(subchannel(i)->subchannel());
+    const void* provider = consumer_provider_load_find(uri);
+    if (provider == nullptr) continue;
+    size_t slot = ProviderHash(provider) & provider_mask_;
+    while (provider_slots_[slot].provider != nullptr &&
+           provider_slots_[slot].provider != provider) {
+      slot = (slot + 1) & provider_mask_;
+    }
+    // ַظʱһ
+    if (provider_slots_[slot].provider == nullptr) {
+      provider_slots_[slot].provider = provider;
+      provider_slots_[slot].index = i;
     }
-    return true;
   }
-  
-  if (strcmp(policy->provider_addr, host_info) == 0) {
-    host_info = NULL;
-    return true;
+}
+
+size_t RoundRobin::RoundRobinSubchannelList::FindProviderSubchannelIndexLocked(
+    const void* provider) const {
+  if (provider == nullptr || provider_slots_.size() == 0) {
+    return num_subchannels();
   }
-  return false;
+  size_t slot = ProviderHash(provider) & provider_mask_;
+  while (provider_slots_[slot].provider != nullptr) {
+    if (provider_slots_[slot].provider == provider) {
+      return provider_slots_[slot].index;
+    }
+    slot = (slot + 1) & provider_mask_;
+  }
+  return num_subchannels();
 }
 //-----end-----
 
@@ -680,8 +733,8 @@ bool RoundRobin::RoundRobinSubchannelList::orientsec_grpc_item(
  * Note that this function does *not* update p->last_ready_subchannel_index.
  * The caller must do that if it returns a pick. */
 //peekһ ready list
-size_t
-RoundRobin::RoundRobinSubchannelList::GetNextReadySubchannelIndexLocked() {
+size_t RoundRobin::RoundRobinSubchannelList::GetNextReadySubchannelIndexLocked(
+    const void* provider) {
   if (grpc_lb_round_robin_trace.enabled()) {
     gpr_log(GPR_INFO,
             "[RR %p] getting next ready subchannel (out of %" PRIuPTR
@@ -689,22 +742,16 @@ RoundRobin::RoundRobinSubchannelList::GetNextReadySubchannelIndexLocked() {
             policy(), num_subchannels(), last_ready_index_);
   }
   //----begin----
-  //RoundRobin* p = static_cast<RoundRobin*>(policy());
-  LoadBalancingPolicy* p = policy();
-  bool is_request = is_request_loadbalance();
-  bool selected = false;  // select successfully or not
-  int ready_index = -1;
-  // Only set connectivity state if this is the current subchannel list.
-  /*if (p->subchannel_list_.get() != this) 
-    return num_subchannels();*/
-  //if (strcmp(p->provider_addr, "2.2.2.2:2222") == 0) {
-  //  return num_subchannels();
-  //  }
+  // ؾʱֱӶλѡеproviderʱٰround robinѡȡ
+  const size_t provider_index = FindProviderSubchannelIndexLocked(provider);
+  if (provider_index < num_subchannels() &&
+      subchannel(provider_index)->connectivity_state() == GRPC_CHANNEL_READY) {
+    return provider_index;
+  }
   //----end----
   for (size_t i = 0; i < num_subchannels(); ++i) {
     //㷨ģlast_ready_index_ Ϊϴѡindex
     const size_t index = (i + last_ready_index_ + 1) % num_subchannels();
-    
     if (grpc_lb_round_robin_trace.enabled()) {
       gpr_log(
           GPR_INFO,
@@ -714,39 +761,16 @@ RoundRobin::RoundRobinSubchannelList::GetNextReadySubchannelIndexLocked() {
           grpc_connectivity_state_name(
               subchannel(index)->connectivity_state()));
     }
-    //debug here
-    grpc_connectivity_state state = subchannel(index)->connectivity_state();
-    if (state == GRPC_CHANNEL_READY) {
+    if (subchannel(index)->connectivity_state() == GRPC_CHANNEL_READY) {
       if (grpc_lb_round_robin_trace.enabled()) {
         gpr_log(GPR_INFO,
                 "[RR %p] found next ready subchannel (%p) at index %" PRIuPTR
                 " of subchannel_list %p",
                 policy(), subchannel(index)->subchannel(), index, this);
       }
-      // ȡlb provider ipreadysubchannelipбȶԣ
-      //  ready listдڴipشindex roundrobin pick
-      if (is_request && orientsec_grpc_item(index, p)) {
-        selected = true;
-        return index;
-      } else {
-        ready_index = index;
-      } 
-      if (!is_request) { //connection
-        selected = true;
-        return index;
-      }
-    }
-  }//end for each subchannel
-  // fix one of invoked providers shut down abnormally,then consumer side crash
-  if ((!selected) && is_request){  // ƽ㷨ѡprovider ڲ״̬
-    
-    if (ready_index >= 0) {
-      return ready_index;
+      return index;
     }
   }
-  /*if (subchannel(last_ready_index_)->connectivity_state() == GRPC_CHANNEL_READY){
-      return last_ready_index_;
-  }*/
   if (grpc_lb_round_robin_trace.enabled()) {
     gpr_log(GPR_INFO, "[RR %p] no subchannels in ready state", this);
   }
@@ -801,7 +825,28 @@ void RoundRobin::UpdateLocked(const grpc_channel_args& args,
     gpr_log(GPR_INFO, "[RR %p] received update with %" PRIuPTR " addresses",
             this, addresses->num_addresses);
   }
+  //----begin----
+  // ½ͬĵַбʱе
+  // subchannel listкµĵüʹ
+  if (addresses_ != nullptr &&
+      grpc_lb_addresses_cmp(addresses_, addresses) == 0) {
+    if (grpc_lb_round_robin_trace.enabled()) {
+      gpr_log(GPR_INFO, "[RR %p] addresses unchanged, keeping subchannel list",
+              this);
+    }
+    return;
+  }
+  if (addresses_ != nullptr) {
+    grpc_lb_addresses_destroy(addresses_);
+  }
+  addresses_ = grpc_lb_addresses_copy(addresses);
+  // connection mode only resolves the chosen provider
+  TransferArgIpToProviderIP(addresses);
+  //----end----
   // Replace latest_pending_subchannel_list_.
+  // Subchannels are shared through the subchannel index, so providers kept
+  // by the update reuse their connections and report READY right away in
+  // StartWatchingLocked(), which promotes the new list without a gap.
   if (latest_pending_subchannel_list_ != nullptr) {
     if (grpc_lb_round_robin_trace.enabled()) {
       gpr_log(GPR_INFO,
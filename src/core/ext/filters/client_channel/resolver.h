@@ -112,8 +112,6 @@ class Resolver : public InternallyRefCountedWithTracing<Resolver> {
   char* get_hash() const { return hasharg; }
   char* get_meth_name() const { return method_name; }
 
-  virtual void Resetting() GRPC_ABSTRACT;
-
   //----end----
 
  protected:
@@ -68,8 +68,6 @@ class ZookeeperResolver : public Resolver {
 
   void ShutdownLocked() override;
 
- void Resetting() override;
-
     //----begin----
 
   //char* get_hash() const { return hasharg; }
@@ -93,6 +91,9 @@ class ZookeeperResolver : public Resolver {
   grpc_pollset_set* interested_parties_ = nullptr;
   /// are we currently resolving?
   bool resolving_ = false;
+  /// was re-resolution requested while resolving?
+  /// the running query may have read the registry cache before the change
+  bool reresolution_requested_ = false;
   grpc_closure on_resolved_;
   /// which version of the result have we published?
   int published_version_ = 0;
@@ -174,6 +175,8 @@ void ZookeeperResolver::NextLocked(grpc_channel_args** result,
 void ZookeeperResolver::RequestReresolutionLocked() {
   if (!resolving_) {
     MaybeStartResolvingLocked();
+  } else {
+    reresolution_requested_ = true;
   }
 }
 
@@ -185,33 +188,6 @@ void ZookeeperResolver::ResetBackoffLocked() {
 }
 
 
-void ZookeeperResolver::Resetting() {
-  if (next_completion_ != nullptr) {
-
-    //GRPC_CLOSURE_SCHED(next_completion_, GRPC_ERROR_CREATE_FROM_STATIC_STRING(
-     //                                        "Resolver reset"));
-    next_completion_ = nullptr;
-   } 
-  if (resolved_version_ != 0) 
-     resolved_version_ = 0;
-   if (last_resolution_timestamp_ != -1) 
-     last_resolution_timestamp_ = -1;
-
-   // deconstructor
-   if (resolved_result_ != nullptr) {
-     //grpc_channel_args_destroy(resolved_result_);
-     resolved_result_ = nullptr;
-   }
-   published_version_ = 0;
-   
-   grpc_pollset_set_destroy(interested_parties_);
-   //gpr_free(name_to_resolve_);
-   //name_to_resolve_ = nullptr;
-   //channel_args_ = nullptr;
-   //grpc_channel_args_destroy(channel_args_);
-   target_result_ = nullptr;
-
-}
 void ZookeeperResolver::ShutdownLocked() {
   if (have_next_resolution_timer_) {
     grpc_timer_cancel(&next_resolution_timer_);
@@ -285,6 +261,13 @@ void ZookeeperResolver::OnResolvedLocked(void* arg, grpc_error* error) {
   r->resolved_result_ = result;
   ++r->resolved_version_;
   r->MaybeFinishNextLocked();
+  // a failed resolution already retries from the timer
+  if (r->reresolution_requested_) {
+    r->reresolution_requested_ = false;
+    if (!r->have_next_resolution_timer_) {
+      r->MaybeStartResolvingLocked();
+    }
+  }
   GRPC_ERROR_UNREF(error);
   r->Unref(DEBUG_LOCATION, "zk-resolving");
 }
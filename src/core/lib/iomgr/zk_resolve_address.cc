@@ -106,13 +106,37 @@ static grpc_error* zk_blocking_resolve_address(
       sizeof(grpc_resolved_address) * (*addresses)->naddrs);
   i = 0;
   for (i = 0; i < (*addresses)->naddrs; i++) {
-    struct sockaddr_in my_addr;
     int myport =
         (0 == providers[i].port) ? atoi(default_port) : providers[i].port;
+    // ipv6 provider, host may be bracketed as in [::1]
+    if (strchr(providers[i].host, ':') != NULL) {
+      struct sockaddr_in6 my_addr6;
+      memset(&my_addr6, 0, sizeof(my_addr6));
+      char host6[INET6_ADDRSTRLEN + 2];
+      const char* h = providers[i].host;
+      size_t hlen = strlen(h);
+      if (hlen >= 2 && h[0] == '[' && h[hlen - 1] == ']') {
+        h++;
+        hlen -= 2;
+      }
+      if (hlen >= sizeof(host6)) hlen = sizeof(host6) - 1;
+      memcpy(host6, h, hlen);
+      host6[hlen] = '\0';
+      my_addr6.sin6_family = AF_INET6;
+      my_addr6.sin6_port = htons(myport);
+      inet_pton(AF_INET6, host6, (void*)&my_addr6.sin6_addr);
+
+      memcpy(&(*addresses)->addrs[i].addr, &my_addr6,
+             sizeof(struct sockaddr_in6));
+      (*addresses)->addrs[i].len = sizeof(struct sockaddr_in6);
+      continue;
+    }
+    struct sockaddr_in my_addr;
+    // zeroed so that equal providers compare equal in the lb address diff
+    memset(&my_addr, 0, sizeof(my_addr));
     my_addr.sin_family = AF_INET;
     my_addr.sin_port = htons(myport);
     inet_pton(AF_INET, providers[i].host, (void*)&my_addr.sin_addr.s_addr);
-    memset(&my_addr.sin_zero, 0, 8);
 
     memcpy(&(*addresses)->addrs[i].addr, &my_addr, sizeof(struct sockaddr_in));
     (*addresses)->addrs[i].len = sizeof(struct sockaddr_in);
@@ -263,6 +263,12 @@ struct grpc_call {
     // add by yang
   char hash_info[64]={0};
   char call_name[64] = {0};
+  // ѡproviderĸͳƼѡʱ䣬յ״̬ʱͷŲ¼ӳ
+  gpr_atm provider_load = 0;
+  gpr_timespec provider_load_start;
+  // ķ/ϢһԪʽ
+  gpr_atm send_message_ops = 0;
+  gpr_atm recv_message_ops = 0;
 };
 
 grpc_core::TraceFlag grpc_call_error_trace(false, "call_error");
@@ -289,6 +295,7 @@ static void cancel_with_error(grpc_call* c, grpc_error* error);
 static void destroy_call(void* call_stack, grpc_error* error);
 static void receiving_slice_ready(void* bctlp, grpc_error* error);
 static void set_final_status(grpc_call* call, grpc_error* error);
+static void release_call_provider_load(grpc_call* call, int status);
 static void process_data_after_md(batch_control* bctl);
 static void post_batch_completion(batch_control* bctl);
 
@@ -541,6 +548,7 @@ static void destroy_call(void* call, grpc_error* error) {
   if (c->cq) {
     GRPC_CQ_INTERNAL_UNREF(c->cq, "bind");
   }
+  release_call_provider_load(c, -1);
 
   grpc_error* status_error =
       reinterpret_cast<grpc_error*>(gpr_atm_acq_load(&c->status_error));
@@ -690,8 +698,10 @@ static void cancel_with_error(grpc_call* c, grpc_error* error) {
   // dengjq add,ͻݴ ԭôݴ
   if (c && c->is_client && !orientsec_grpc_channel_is_native(c->channel)) {
     gpr_log(GPR_DEBUG, "terminate_with_error trigger failover... ");
-    record_provider_failure(grpc_get_channel_client_reginfo(c->channel),
-                            grpc_get_channel_provider_addr(c->channel),c->call_name);
+    record_provider_failure(
+        grpc_get_channel_failover(c->channel),
+        reinterpret_cast<void*>(gpr_atm_acq_load(&c->provider_load)),
+        grpc_get_channel_provider_addr(c->channel), c->call_name);
   }
   //-----end-----
   GRPC_CALL_INTERNAL_REF(c, "termination");
@@ -744,6 +754,9 @@ static void set_final_status(grpc_call* call, grpc_error* error) {
     // explicitly take a ref
     grpc_slice_ref_internal(*call->final_op.client.status_details);
     gpr_atm_rel_store(&call->status_error, reinterpret_cast<gpr_atm>(error));
+    // ɹʱĵüӳ٣ʱprovider(GCͣ)źţ
+    // ״̬ͬʱȺĳɹ
+    release_call_provider_load(call, *call->final_op.client.status);
     grpc_core::channelz::ChannelNode* channelz_channel =
         grpc_channel_get_channelz_node(call->channel);
     if (channelz_channel != nullptr) {
@@ -1653,6 +1666,7 @@ static grpc_call_error call_start_batch(grpc_call* call, const grpc_op* ops,
             &op->data.send_message.send_message->data.raw.slice_buffer, flags);
         stream_op_payload->send_message.send_message.reset(
             call->sending_stream.get());
+        gpr_atm_no_barrier_fetch_add(&call->send_message_ops, 1);
         has_send_ops = true;
         break;
       }
@@ -1794,6 +1808,7 @@ static grpc_call_error call_start_batch(grpc_call* call, const grpc_op* ops,
                           grpc_schedule_on_exec_ctx);
         stream_op_payload->recv_message.recv_message_ready =
             &call->receiving_stream_ready;
+        gpr_atm_no_barrier_fetch_add(&call->recv_message_ops, 1);
         ++num_recv_ops;
         break;
       }
@@ -2053,3 +2068,33 @@ void orientsec_grpc_setcall_methodname(grpc_call* call, const char* s){
 char* orientsec_grpc_getcall_methodname(grpc_call* call){
   return call->call_name;
 }
+
+void orientsec_grpc_setcall_provider_load(grpc_call* call, void* load) {
+  // ʱѡȡͷ֮ǰproviderļ
+  call->provider_load_start = gpr_now(GPR_CLOCK_MONOTONIC);
+  void* prev = reinterpret_cast<void*>(
+      gpr_atm_full_xchg(&call->provider_load, reinterpret_cast<gpr_atm>(load)));
+  consumer_provider_load_call_started(load);
+  consumer_provider_load_call_finished(prev, -1, -1);
+}
+
+bool orientsec_grpc_call_is_unary(grpc_call* call) {
+  return gpr_atm_no_barrier_load(&call->send_message_ops) <= 1 &&
+         gpr_atm_no_barrier_load(&call->recv_message_ops) <= 1;
+}
+
+static void release_call_provider_load(grpc_call* call, int status) {
+  void* load =
+      reinterpret_cast<void*>(gpr_atm_full_xchg(&call->provider_load, 0));
+  if (load == nullptr) {
+    return;
+  }
+  // ʽõʱȡĴʱproviderӦٶȣΪӳ
+  int64_t latency_us = -1;
+  if ((status == GRPC_STATUS_OK || status == GRPC_STATUS_DEADLINE_EXCEEDED) &&
+      orientsec_grpc_call_is_unary(call)) {
+    latency_us = static_cast<int64_t>(gpr_timespec_to_micros(gpr_time_sub(
+        gpr_now(GPR_CLOCK_MONOTONIC), call->provider_load_start)));
+  }
+  consumer_provider_load_call_finished(load, latency_us, status);
+}
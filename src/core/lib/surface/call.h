@@ -135,6 +135,12 @@ char* orientsec_grpc_call_serverhost(grpc_call* call);
 // add by huyn ȡprovider addr
 char* orientsec_grpc_call_provider_addr_get(grpc_call* call);
 
+// ¼callѡproviderĸͳƣcallյ״̬ʱͷ
+void orientsec_grpc_setcall_provider_load(grpc_call* call, void* load);
+
+// ͺͽյϢһʱΪһԪãֻһԪõʱӳ
+bool orientsec_grpc_call_is_unary(grpc_call* call);
+
 //// add by yang
 //void orientsec_grpc_setcall_hashinfo(grpc_call* call, const char* s);
 //
@@ -78,7 +78,9 @@ struct grpc_channel {
   char* target;
   //add by liumin
   char* reginfo;
-  char c_provider_addr[32];
+  // consumerݴ¼עʱchannelʱͷ
+  void* failover;
+  char c_provider_addr[ORIENTSEC_GRPC_PROVIDER_ADDR_LEN];
   //end by liumin
 };
 
@@ -189,6 +191,7 @@ grpc_channel* grpc_channel_create_with_builder(
     if (0 == strncmp(channel->target, "zookeeper", 9)) {
       char* sn = orientsec_grpc_get_sn_from_target(channel->target);
       channel->reginfo = orientsec_grpc_consumer_register(sn);
+      channel->failover = consumer_failover_create(channel->reginfo);
       if (sn) {
         free(sn);
       }
@@ -487,6 +490,8 @@ static void destroy_channel(void* arg, grpc_error* error) {
                             GRPC_RESOURCE_QUOTA_CHANNEL_SIZE);
   }
   gpr_mu_destroy(&channel->registered_call_mu);
+  // callŻchannel
+  consumer_failover_destroy(channel->failover);
   gpr_free(channel->target);
   gpr_free(channel);
 }
@@ -541,7 +546,8 @@ void grpc_set_channel_provider_addr(grpc_channel* channel,
   if (!channel || !provider_addr) {
     return;
   }
-  sprintf(channel->c_provider_addr, "%s", provider_addr);
+  snprintf(channel->c_provider_addr, sizeof(channel->c_provider_addr), "%s",
+           provider_addr);
 }
 
 char* grpc_get_channel_provider_addr(grpc_channel* channel) {
@@ -557,6 +563,13 @@ char* grpc_get_channel_client_reginfo(grpc_channel* channel) {
   return channel->reginfo;
 }
 
+void* grpc_get_channel_failover(grpc_channel* channel) {
+  if (!channel) {
+    return NULL;
+  }
+  return channel->failover;
+}
+
 char* grpc_get_channel_target_addr(grpc_channel* channel) {
   if (!channel) {
     return NULL;
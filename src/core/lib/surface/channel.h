@@ -95,6 +95,7 @@ char* grpc_get_channel_target_addr(grpc_channel* channel);
 //----begin----dengjq add
 char* grpc_get_channel_provider_addr(grpc_channel* channel);
 char* grpc_get_channel_client_reginfo(grpc_channel* channel);
+void* grpc_get_channel_failover(grpc_channel* channel);
 //-----end-----
 
 //Уǲͨԭchannelе 1ԭchannel 0 ԭchannel
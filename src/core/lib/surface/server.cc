@@ -197,6 +197,9 @@ struct call_data {
 
   call_data* pending_next = nullptr;
   grpc_call_combiner* call_combiner;
+
+  // ͨƵĵãʱͷż
+  bool provider_request_admitted = false;
 };
 
 struct request_matcher {
@@ -375,7 +378,8 @@ static void cancel_client_method_call_concurrent_request(
     void* elem, grpc_error* error) {
   grpc_call_error err = grpc_call_cancel_with_status(
       grpc_call_from_top_element((grpc_call_element *) elem),
-      GRPC_STATUS_CANCELLED, ORIENTSEC_GRPC_PROVIDER_TOO_MANY_REQUEST, NULL);
+      GRPC_STATUS_RESOURCE_EXHAUSTED, ORIENTSEC_GRPC_PROVIDER_TOO_MANY_REQUEST,
+      NULL);
   if (err != GRPC_CALL_OK) {
     gpr_log(GPR_ERROR, "cancel_client_method_call_concurrent_request failed with: %d",
             err);
@@ -879,6 +883,7 @@ static void got_initial_metadata(void* ptr, grpc_error* error) {
                            GRPC_ERROR_NONE);
         return;
       }
+      calld->provider_request_admitted = true;
     }
     //-----end-----
 
@@ -968,13 +973,21 @@ static void destroy_call_elem(grpc_call_element* elem,
   call_data* calld = static_cast<call_data*>(elem->call_data);
 
   //----begin----
-  // Ϻ󣬲һ
-  if (calld) {
+  // Ϻ󣬲һܾĵûм
+  // ӳӦƣͻȡĵúʽòΪ
+  // Ĵʱ䲻˵Ŷ
+  if (calld && calld->provider_request_admitted) {
     char intf[ORIENTSEC_GRPC_BUF_LEN];
     char* ptr = get_service_name((char*)GRPC_SLICE_START_PTR(calld->path), intf,
                                  ORIENTSEC_GRPC_BUF_LEN);
     if (ptr) {
-      decrease_provider_request(intf);
+      int64_t latency_us = -1;
+      if (final_info->final_status != GRPC_STATUS_CANCELLED &&
+          orientsec_grpc_call_is_unary(grpc_call_from_top_element(elem))) {
+        latency_us = static_cast<int64_t>(
+            gpr_timespec_to_micros(final_info->stats.latency));
+      }
+      finish_provider_request(intf, latency_us);
     }
   }
   //-----end-----
@@ -47,6 +47,10 @@ extern "C" {
 #define ORIENTSEC_GRPC_PROPERTIES_P_DEFAULT_RETIES "provider.default.reties"
 #define ORIENTSEC_GRPC_PROPERTIES_P_DEFAULT_CONN "provider.default.connections"
 #define ORIENTSEC_GRPC_PROPERTIES_P_DEFAULT_REQ "provider.default.requests"
+// 并发请求控制方式：static(默认，按default.requests)或adaptive(按延迟自动调整)
+#define ORIENTSEC_GRPC_PROPERTIES_P_REQUESTS_LIMIT_MODE \
+  "provider.requests.limit.mode"
+#define ORIENTSEC_GRPC_PROVIDER_REQUESTS_LIMIT_ADAPTIVE "adaptive"
 #define ORIENTSEC_GRPC_PROPERTIES_P_DEFAULT_LB "provider.default.loadbalance"
 #define ORIENTSEC_GRPC_PROPERTIES_P_DEFAULT_ASYNC "provider.default.async"
 #define ORIENTSEC_GRPC_PROPERTIES_P_TOKEN "provider.token"
@@ -88,10 +92,28 @@ extern "C" {
 // add by yang
 #define ORIENTSEC_GRPC_PROPERTIES_C_CONSISTENT_HASH_ARG \
   "consumer.consistent.hash.arguments"
+#define ORIENTSEC_GRPC_PROPERTIES_C_CONSISTENT_HASH_LOAD_FACTOR \
+  "consumer.consistent.hash.load.factor"
 #define ORIENTSEC_GRPC_PROPERTIES_C_CONSUMER_SWITH_THRES \
   "consumer.switchover.threshold"
 #define ORIENTSEC_GRPC_PROPERTIES_C_CONSUMER_PUNISH_TIME \
   "consumer.unavailable.provider.punish.time"
+// 离群provider摘除，默认关闭
+#define ORIENTSEC_GRPC_PROPERTIES_C_OUTLIER_ENABLED \
+  "consumer.outlier.detection.enabled"
+#define ORIENTSEC_GRPC_PROPERTIES_C_OUTLIER_BASE_EJECTION_TIME \
+  "consumer.outlier.base.ejection.time"
+#define ORIENTSEC_GRPC_PROPERTIES_C_OUTLIER_MAX_EJECTION_PERCENT \
+  "consumer.outlier.max.ejection.percent"
+#define ORIENTSEC_GRPC_PROPERTIES_C_OUTLIER_MIN_REQUESTS \
+  "consumer.outlier.min.requests"
+#define ORIENTSEC_GRPC_PROPERTIES_C_OUTLIER_STDEV_FACTOR \
+  "consumer.outlier.success.rate.stdev.factor"
+#define ORIENTSEC_GRPC_PROPERTIES_C_OUTLIER_LATENCY_FACTOR \
+  "consumer.outlier.latency.factor"
+// 注册中心本地快照目录，未配置时不保存快照
+#define ORIENTSEC_GRPC_PROPERTIES_C_REGISTRY_SNAPSHOT_DIR \
+  "consumer.registry.snapshot.dir"
 
 
 #ifdef __cplusplus
@@ -111,25 +111,21 @@ bool orientsec_grpc_split_to_map(const std::string& str,
   return true;
 }
 
-bool orientsec_grpc_joint_hash_input(std::map<std::string, std::string> map_,
-                                     std::vector<std::string>& vec_,
-                                     std::string& hash_arg) {
-  if (vec_.empty()) {
-    // ϣδòֵȡһĲֵ
-    hash_arg = map_.begin()->second;
-    return true;
-  }
-  //vectorֶ ȡmapӦƴ
-  for (std::vector<std::string>::iterator vec_iter = vec_.begin();
-       vec_iter != vec_.end(); vec_iter++) {
-    std::map<std::string, std::string>::iterator map_iter =
-        map_.find((*vec_iter).c_str());
-    if (map_iter != map_.end())
-      // joint into hash_arg
-      hash_arg += map_iter->second;
+static std::vector<std::string>* load_consistent_hash_arg_fields() {
+  char buf[ORIENTSEC_GRPC_PROPERTY_VALUE_MAX_LEN] = {0};
+  std::vector<std::string>* fields = new std::vector<std::string>();
+  orientsec_grpc_properties_get_value(
+      ORIENTSEC_GRPC_PROPERTIES_C_CONSISTENT_HASH_ARG, NULL, buf);
+  orientsec_grpc_split_to_vec(buf, *fields, ",");
+  for (size_t i = 0; i < fields->size(); i++) {
+    orientsec_grpc_trim((*fields)[i]);
   }
-  // ֵбȷharh_argΪգȡһĲֵ
-  if (hash_arg.empty() || (hash_arg.size() == 0)) 
-    hash_arg = map_.begin()->second;
-  return true;
+  return fields;
+}
+
+const std::vector<std::string>& orientsec_grpc_consistent_hash_arg_fields() {
+  // ļgrpcʼʱѼأֶбֻһ
+  static const std::vector<std::string>* fields =
+      load_consistent_hash_arg_fields();
+  return *fields;
 }
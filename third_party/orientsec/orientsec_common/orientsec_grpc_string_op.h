@@ -45,9 +45,9 @@ extern "C" {
  bool orientsec_grpc_split_to_map(const std::string& str,
                            std::map<std::string, std::string>& ret_,
                            std::string sep);
- bool orientsec_grpc_joint_hash_input(std::map<std::string, std::string> map_,
-                               std::vector<std::string>& vec_,
-                               std::string& hash_arg);
+ // field names configured by consumer.consistent.hash.arguments, parsed once
+ // per process
+ const std::vector<std::string>& orientsec_grpc_consistent_hash_arg_fields();
  //----end----
 
 
@@ -434,6 +434,12 @@ char* lb_strategy_to_str(loadbalance_strategy_t strategy) {
     case CONSISTENT_HASH:
       return ORIENTSEC_GRPC_LB_TYPE_CH;
       break;
+    case CONSISTENT_HASH_BOUNDED:
+      return ORIENTSEC_GRPC_LB_TYPE_CHBL;
+      break;
+    case P2C_EWMA:
+      return ORIENTSEC_GRPC_LB_TYPE_P2C;
+      break;
     default:
       return ORIENTSEC_GRPC_LB_TYPE_RR;
       break;
@@ -456,6 +462,10 @@ loadbalance_strategy_t lb_strategy_from_str(char* strategy) {
     ret = WEIGHT_ROUND_ROBIN;
   } else if (0 == orientsec_stricmp(ORIENTSEC_GRPC_LB_TYPE_CH, strategy)) {
     ret = CONSISTENT_HASH;
+  } else if (0 == orientsec_stricmp(ORIENTSEC_GRPC_LB_TYPE_CHBL, strategy)) {
+    ret = CONSISTENT_HASH_BOUNDED;
+  } else if (0 == orientsec_stricmp(ORIENTSEC_GRPC_LB_TYPE_P2C, strategy)) {
+    ret = P2C_EWMA;
   } else {
     ret = ROUND_ROBIN;
   }
@@ -22,6 +22,8 @@ extern "C" {
 #define ORIENTSEC_GRPC_LB_TYPE_RR "round_robin"
 #define ORIENTSEC_GRPC_LB_TYPE_WRR "weight_round_robin"
 #define ORIENTSEC_GRPC_LB_TYPE_CH "consistent_hash"
+#define ORIENTSEC_GRPC_LB_TYPE_CHBL "consistent_hash_bounded"
+#define ORIENTSEC_GRPC_LB_TYPE_P2C "p2c_ewma"
 #define ORIENTSEC_GRPC_DEFAULT_LB_TYPE ORIENTSEC_GRPC_LB_TYPE_RR
 
 #define ORIENTSEC_GRPC_LB_MODE_REQUEST "request"
@@ -38,7 +40,9 @@ typedef enum _loadbalance_strategy_t {
 		PICK_FIRST,
 		ROUND_ROBIN,
 		WEIGHT_ROUND_ROBIN,
-                CONSISTENT_HASH
+                CONSISTENT_HASH,
+                CONSISTENT_HASH_BOUNDED,
+                P2C_EWMA
 }loadbalance_strategy_t;
 
 typedef enum _cluster_strategy_t {
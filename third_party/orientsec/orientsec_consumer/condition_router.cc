@@ -25,9 +25,9 @@
 #include "condition_router.h"
 #include <grpc/support/alloc.h>
 #include <grpc/support/log.h>
+#include <cstdio>
 #include <cstring>
 #include <map>
-#include <sstream>
 #include "orientsec_grpc_common_init.h"
 std::string& grpc_trim(std::string &s)
 {
@@ -41,13 +41,6 @@ std::string& grpc_trim(std::string &s)
 	return s;
 }
 
-void int2str(const int &int_temp, string &string_temp)
-{
-	stringstream stream;
-	stream << int_temp;
-	string_temp = stream.str();   //此处也可以用 stream>>string_temp  
-}
-
 int grpc_split_to_vec(const std::string& str, std::vector<string>& ret_, std::string sep = ",")
 {
 	if (str.empty())
@@ -117,43 +110,154 @@ int grpc_split_to_set(const std::string& str, std::set<string>& ret_, std::strin
 }
 
 
-std::map<std::string, std::string> url_to_map(url_t *url) {
-	std::map<std::string, std::string> result;
-	if (url->protocol)
-	{
-		result.insert(std::pair<std::string, std::string>("protocol",url->protocol));
+condition_router::value_matcher::value_matcher(const string& pattern_str)
+	: kind(MATCH_EXACT), pattern(pattern_str) {
+	if (pattern == "*") {
+		kind = MATCH_ANY;
+		return;
 	}
-	if (url->username)
-	{
-		result.insert(std::pair<std::string, std::string>("username", url->username));
+	if (is_start_with(pattern.c_str(), "$")) {
+		// consumer参数在匹配时才确定，无consumer参数时按字面值匹配
+		kind = MATCH_PARAM;
+		prefix = pattern.substr(1);
+		return;
 	}
-	if (url->password)
-	{
-		result.insert(std::pair<std::string, std::string>("password", url->password));
+	string::size_type i = pattern.find_last_of('*');
+	if (i == string::npos) {
+		prefix = pattern;
 	}
-	if (url->host)
-	{
-		result.insert(std::pair<std::string, std::string>("host", url->host));
+	else if (i == pattern.length() - 1) {
+		kind = MATCH_PREFIX;
+		prefix = pattern.substr(0, i);
+	}
+	else if (i == 0) {
+		kind = MATCH_SUFFIX;
+		suffix = pattern.substr(1);
+	}
+	else {
+		kind = MATCH_PREFIX_SUFFIX;
+		prefix = pattern.substr(0, i);
+		suffix = pattern.substr(i + 1);
 	}
+}
 
-	if (url->port > 0)
-	{
-		std::string port_str;
-		int2str(url->port, port_str);
-		result.insert(std::pair<std::string, std::string>("port", port_str));
+bool condition_router::value_matcher::is_match(const char* value, url_t* param) const {
+	switch (kind) {
+	case MATCH_ANY:
+		return true;
+	case MATCH_PARAM:
+		if (param != NULL) {
+			char *paramPtr = url_get_raw_parameter(param, prefix.c_str());
+			std::string resolved = paramPtr ? paramPtr : "";
+			FREE_PTR(paramPtr);
+			return is_match_glob_pattern2(resolved, value);
+		}
+		return is_match_glob_pattern2(pattern, value);
+	default:
+		break;
 	}
-	if (url->path)
-	{
-		result.insert(std::pair<std::string, std::string>("path", url->path));
+	if (value[0] == '\0') {
+		// 空值只与空的通配值匹配
+		return kind == MATCH_EXACT && prefix.empty();
 	}
-	for (size_t i = 0; i < url->params_num; i++)
-	{
-		result.insert(std::pair<std::string, std::string>(url->parameters[i].key, url->parameters[i].value));
+	switch (kind) {
+	case MATCH_EXACT:
+		return strcmp(prefix.c_str(), value) == 0;
+	case MATCH_PREFIX:
+		return is_start_with(value, prefix.c_str());
+	case MATCH_SUFFIX:
+		return is_ends_with(value, suffix.c_str());
+	default:
+		return is_start_with(value, prefix.c_str()) && is_ends_with(value, suffix.c_str());
+	}
+}
+
+condition_router::condition_entry::condition_entry(const string& key_str, const match_pair& pair)
+	: key_id(KEY_PARAMETER), key(key_str), valid(true) {
+	static const struct {
+		const char* name;
+		url_key_t key_id;
+	} url_keys[] = {
+		{ "protocol", KEY_PROTOCOL },
+		{ "username", KEY_USERNAME },
+		{ "password", KEY_PASSWORD },
+		{ "host", KEY_HOST },
+		{ "port", KEY_PORT },
+		{ "path", KEY_PATH },
+	};
+	for (size_t i = 0; i < sizeof(url_keys) / sizeof(url_keys[0]); i++) {
+		if (key == url_keys[i].name) {
+			key_id = url_keys[i].key_id;
+			break;
+		}
+	}
+	if (!pair.matches.empty() && !pair.mismatches.empty()) {
+		gpr_log(GPR_ERROR, "路由规则配置出错，条件不能同时出现=和!=，请检查！key:%s", key.c_str());
+		valid = false;
+	}
+	for (std::set<std::string>::const_iterator it = pair.matches.begin(); it != pair.matches.end(); it++) {
+		matches.push_back(value_matcher(*it));
+	}
+	for (std::set<std::string>::const_iterator it = pair.mismatches.begin(); it != pair.mismatches.end(); it++) {
+		mismatches.push_back(value_matcher(*it));
 	}
-	return result;
 }
 
-condition_router::condition_router(url_t* url_param) {
+// 字段优先，字段为空时取首个同名参数，都没有时返回NULL
+const char* condition_router::condition_entry::sample(url_t* url, char* port_buf, size_t port_buf_len) const {
+	const char* value = NULL;
+	switch (key_id) {
+	case KEY_PROTOCOL: value = url->protocol; break;
+	case KEY_USERNAME: value = url->username; break;
+	case KEY_PASSWORD: value = url->password; break;
+	case KEY_HOST: value = url->host; break;
+	case KEY_PORT:
+		if (url->port > 0) {
+			snprintf(port_buf, port_buf_len, "%d", url->port);
+			value = port_buf;
+		}
+		break;
+	case KEY_PATH: value = url->path; break;
+	default: break;
+	}
+	if (value != NULL) {
+		return value;
+	}
+	for (int i = 0; i < url->params_num; i++) {
+		if (url->parameters[i].key && 0 == strcmp(url->parameters[i].key, key.c_str())) {
+			return url->parameters[i].value;
+		}
+	}
+	return NULL;
+}
+
+bool condition_router::condition_entry::is_match(url_t* url, url_t* param) const {
+	char port_buf[16];
+	const char* value = sample(url, port_buf, sizeof(port_buf));
+	if (value == NULL) {
+		return true;  // url中没有该key，条件不生效
+	}
+	if (!valid || (matches.empty() && mismatches.empty())) {
+		return false;
+	}
+	if (!matches.empty()) {
+		for (size_t i = 0; i < matches.size(); i++) {
+			if (matches[i].is_match(value, param)) {
+				return true;
+			}
+		}
+		return false;// matches，如果都匹配不上返回false
+	}
+	for (size_t i = 0; i < mismatches.size(); i++) {
+		if (mismatches[i].is_match(value, param)) {
+			return false;
+		}
+	}
+	return true;// mismatches，如果都匹配不上返回true
+}
+
+condition_router::condition_router(url_t* url_param)
+	: priority(0), force(false), when_matched(false), generation(0) {
 	char *p = NULL;
 	url = (url_t*)gpr_zalloc(sizeof(url_t));
 	url_init(url);
@@ -197,11 +301,11 @@ condition_router::condition_router(url_t* url_param) {
 	grpc_trim(then_rule);
 	if (!when_rule.empty() && 0 != strcmp(when_rule.c_str(),"true"))
 	{
-		when_condition = parse_rule(when_rule);
+		when_condition = compile_rule(when_rule);
 	}
 	if (!then_rule.empty() && 0 != strcmp(then_rule.c_str(), "false"))
 	{
-		then_condition = parse_rule(then_rule);
+		then_condition = compile_rule(then_rule);
 	}
 }
 
@@ -274,29 +378,67 @@ std::map<std::string, condition_router::match_pair> condition_router::parse_rule
 	return condition;
 }
 
+condition_router::compiled_condition condition_router::compile_rule(const std::string& rule) {
+	compiled_condition compiled;
+	std::map<std::string, match_pair> condition = parse_rule(rule);
+	for (std::map<std::string, match_pair>::iterator it = condition.begin(); it != condition.end(); it++) {
+		compiled.push_back(condition_entry(it->first, it->second));
+	}
+	return compiled;
+}
+
+// consumer不同时缓存的路由结果全部失效
+void condition_router::reset_cache(url_t* url_param) {
+	char* consumer = url_to_string(url_param);
+	bool same = consumer != NULL && !cached_consumer.empty() && cached_consumer == consumer;
+	if (!same) {
+		then_results.clear();
+		cached_consumer = consumer ? consumer : "";
+		when_matched = match_when(url_param);
+	}
+	if (consumer) {
+		free(consumer);
+	}
+}
+
+// 同一provider注册信息不变(host:port及时间戳相同)时复用上次的匹配结果
+bool condition_router::cached_match_then(const provider_t& provider, url_t* url_param) {
+	char key[HOST_MAX_LEN + 16];
+	snprintf(key, sizeof(key), "%s:%d", provider.host, provider.port);
+	route_result& result = then_results[key];
+	if (result.generation == 0 || result.timestamp != provider.timestamp) {
+		result.timestamp = provider.timestamp;
+		result.matched = match_then((url_t*)provider.ext_data, url_param);
+	}
+	result.generation = generation;
+	return result.matched;
+}
+
 //算法优先考虑黑名单
 //注意：本处直接操作g_valid_provider不太合理
-int condition_router::route(provider_t* providers, url_t *url_param) {
+int condition_router::route(provider_t* providers, int num, url_t *url_param) {
 
 	//匹配条件和过滤条件为空时。
 	if ((when_condition.size() == 0) && (0 == then_condition.size())) {
            gpr_log(GPR_ERROR, "The current consumer in the service blacklist. consumer:%s", url_param->host);
            // 全部设置黑名单标记
-          for (size_t i = 0;i <orientsec_grpc_cache_provider_count_get();i++) 
+          for (int i = 0;i < num;i++) 
              ORIENTSEC_GRPC_SET_BIT( providers[i].flag_in_blklist,ORIENTSEC_GRPC_PROVIDER_FLAG_IN_BLKLIST);  //设置黑名单标记
 
 	  return -1;
 	}
 		
-	//校验定义的规则对改客户端是否有效
-	if (!match_when(url_param))
+	//校验定义的规则对改客户端是否有效，结果按consumer缓存
+	reset_cache(url_param);
+	if (!when_matched)
 	{
 		return 0;
 	}
+	generation++;
 	int valid_provider_num = 0;;
 	
 	std::vector<int> provider_pos;
-	for (size_t i = 0; i < orientsec_grpc_cache_provider_count_get(); i++)
+	for (int i = 0; i < num; i++)
 	{
 		if (ORIENTSEC_GRPC_CHECK_BIT(providers[i].flag_in_blklist, ORIENTSEC_GRPC_PROVIDER_FLAG_IN_BLKLIST))
 		{
@@ -308,7 +450,7 @@ int condition_router::route(provider_t* providers, url_t *url_param) {
 		}
 
 		//筛选条件为空或不在允许内
-		if ((then_condition.size() == 0) || !match_then((url_t*)providers[i].ext_data, url_param)) {
+		if ((then_condition.size() == 0) || !cached_match_then(providers[i], url_param)) {
 			ORIENTSEC_GRPC_SET_BIT(providers[i].flag_in_blklist, ORIENTSEC_GRPC_PROVIDER_FLAG_IN_BLKLIST); //设置黑名单标记
 			provider_pos.push_back(i);
 		}
@@ -317,6 +459,15 @@ int condition_router::route(provider_t* providers, url_t *url_param) {
 			valid_provider_num++;
 		}
 	}
+	// 清理已下线provider的缓存
+	for (std::map<std::string, route_result>::iterator it = then_results.begin(); it != then_results.end();) {
+		if (it->second.generation != generation) {
+			then_results.erase(it++);
+		}
+		else {
+			it++;
+		}
+	}
 	if (valid_provider_num > 0)
 	{
 		return 1;
@@ -353,18 +504,10 @@ bool condition_router::match_then(url_t* url, url_t* param) {
 	return match_condition(then_condition, url, param);
 }
 
-bool condition_router::match_condition(std::map<std::string, match_pair> condition, url_t* url, url_t* param) {
-	std::map<std::string, std::string> sample = url_to_map(url);
-	std::map<std::string, std::string>::iterator samp_iter;
-	std::map<std::string, match_pair>::iterator cond_iter;
-	for (samp_iter = sample.begin(); samp_iter != sample.end(); samp_iter++) {
-		cond_iter = condition.find(samp_iter->first);
-		if (cond_iter != condition.end())
-		{
-			match_pair &pair = cond_iter->second;
-			if (!pair.is_match(samp_iter->second, param)) {
-				return false;
-			}
+bool condition_router::match_condition(const compiled_condition& condition, url_t* url, url_t* param) {
+	for (size_t i = 0; i < condition.size(); i++) {
+		if (!condition[i].is_match(url, param)) {
+			return false;
 		}
 	}
 	return true;
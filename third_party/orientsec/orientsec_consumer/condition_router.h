@@ -31,6 +31,7 @@
 #include <set>
 #include <string>
 #include <map>
+#include <vector>
 
 #ifdef __cplusplus
 extern "C" {
@@ -44,56 +45,84 @@ class condition_router :
 	public:
 		set<string> matches;
 		set<string> mismatches;
-	public:
-		bool is_match(string value, url_t* param) {
-			int mathces_num = matches.size();
-			int mismatches_num = mismatches.size();
-
-			if (mathces_num > 0 && mismatches_num > 0) {
-				gpr_log(GPR_ERROR,"路由规则配置出错，条件不能同时出现=和!=，请检查！");
-				return false;
-			}
-			if (mathces_num == 0 && mismatches_num == 0) {
-				gpr_log(GPR_ERROR, "ConditionRouter.MatchPair.isMatch程序发现一个不应该出现的情况");
-				return false;
-			} 
+	};
 
-			bool default_value;
-			if (mathces_num > 0) {
-				default_value = false;// matches，如果都匹配不上返回false
-			}
-			else {
-				default_value = true;// mismatches，如果都匹配不上返回true
-			}
+	// 编译后的单个通配值，与is_match_glob_pattern的规则一致
+	class value_matcher {
+	public:
+		enum kind_t {
+			MATCH_ANY,           // *
+			MATCH_EXACT,         // abc
+			MATCH_PREFIX,        // abc*
+			MATCH_SUFFIX,        // *abc
+			MATCH_PREFIX_SUFFIX, // ab*c
+			MATCH_PARAM          // $key，取consumer的参数值作为通配值
+		};
+		value_matcher(const string& pattern);
+		bool is_match(const char* value, url_t* param) const;
+	private:
+		kind_t kind;
+		string prefix;  // MATCH_EXACT时为整个值，MATCH_PARAM时为参数名
+		string suffix;
+		string pattern;
+	};
 
-			for (std::set<std::string>::iterator it = matches.begin();it != matches.end();it++) {
-				if (is_match_glob_pattern(*it, value, param)) {
-					return true;
-				}
-			}
+	// url中参与匹配的字段，其余key取url参数
+	enum url_key_t {
+		KEY_PROTOCOL,
+		KEY_USERNAME,
+		KEY_PASSWORD,
+		KEY_HOST,
+		KEY_PORT,
+		KEY_PATH,
+		KEY_PARAMETER
+	};
 
-			for (std::set<std::string>::iterator it = mismatches.begin();it != mismatches.end();it++) {
-				if (is_match_glob_pattern(*it, value, param)) {
-					return false;
-				}
-			}
+	// 一个key的匹配条件，=与!=不能同时出现
+	class condition_entry {
+	public:
+		condition_entry(const string& key, const match_pair& pair);
+		bool is_match(url_t* url, url_t* param) const;
+	private:
+		// 取url中key对应的值，与规则中的key含义一致
+		const char* sample(url_t* url, char* port_buf, size_t port_buf_len) const;
+		url_key_t key_id;
+		string key;
+		bool valid;
+		vector<value_matcher> matches;
+		vector<value_matcher> mismatches;
+	};
+	typedef vector<condition_entry> compiled_condition;
 
-			return default_value;
-		}
+	// 按provider(host:port及注册时间戳)缓存的then匹配结果
+	struct route_result {
+		int64_t timestamp;
+		bool matched;
+		int generation;
 	};
+
 	url_t *url;
 	int priority;
 	bool force;
-	std::map<std::string, match_pair> when_condition;
-	std::map<std::string, match_pair> then_condition;
+	compiled_condition when_condition;
+	compiled_condition then_condition;
+
+	// 路由结果缓存，规则变化时整个router重建；consumer变化时清空
+	string cached_consumer;
+	bool when_matched;
+	int generation;
+	std::map<std::string, route_result> then_results;
 private:
 	bool match_when(url_t* url);
 	bool match_then(url_t* url, url_t* param);
-	bool match_condition(std::map<std::string, match_pair> condition, url_t* url, url_t* param);
+	static bool match_condition(const compiled_condition& condition, url_t* url, url_t* param);
+	static compiled_condition compile_rule(const std::string& rule);
+	void reset_cache(url_t* url_param);
+	bool cached_match_then(const provider_t& provider, url_t* url_param);
 public:
 	condition_router(url_t* url_param);
 	static std::map<std::string, match_pair> parse_rule(std::string rule);
-	int route(provider_t* providers, url_t *url_param);
+	int route(provider_t* providers, int num, url_t *url_param);
 	int get_priority() { return priority; }
 	~condition_router();
 };
@@ -22,44 +22,20 @@
  *    consistent hash ؾ⴦෽ʵ
  */
 
-#include "url.h"
-#include "registry_utils.h"
-#include "orientsec_grpc_consumer_utils.h"
-
-#include "orientsec_grpc_common_init.h"
-#include "orientsec_grpc_consumer_control_version.h"
 #include "consistent_hash_lb.h"
 
-#include <cstdlib> 
-#include <iostream>
-
-const int REPLICA_NUMBER = 160;
-
-template <class T>
-
-int getArrayLen(T& array)
-{
-	return (sizeof(array) / sizeof(array[0]));
-}
-
+#include <string.h>
 
 conistent_hash_lb::conistent_hash_lb()
+	: providers(NULL)
 {
-	func = new cmd5_hash_fun();
-	// make consistent hash object
-	conhash = new ccon_hash(func);
-
-	//init flag of rebuid tree
-	set_rebuild_flag(true);
 }
 
 conistent_hash_lb::~conistent_hash_lb()
 {
-	delete func;
-	delete conhash;
 }
 
-void conistent_hash_lb::set_providers(std::map<std::string, provider_t*>* _providers)
+void conistent_hash_lb::set_providers(std::map<std::string, provider_list*>* _providers)
 {
 	this->providers = _providers;
 }
@@ -79,207 +55,37 @@ int conistent_hash_lb::choose_subchannel(const char * sn, provider_t * provider,
 	if (provider == NULL || *nums == 0) {
 		return 0;
 	}
-	// õб
-	int index = 0, index_valid = 0;
-	int size = *nums;
-	std::string factor;
-	//bool rebuild_tree;
-	//used for returning of provider node
-	cnode_s * node;
-
-	if (arg.empty())
-		factor = sn;
-	else
-		factor = arg;
-
-	//жϷбǷ仯仯Ҫ¹
-	if (get_rebuild_flag() || !compare_provider_list(provider, size))  //βһfalse
-	{
-		// rebuild hash tree
-		gen_hash_rbtree(provider, size);
-		// rebuild provider_list for comparing
-		gen_provider_list(provider, nums);
-		set_rebuild_flag(false);
-	}
-
-	//ݲֵѡָķṩ
-	node = conhash->lookup_node_s(factor.c_str());
-	if (node != NULL)
-	{
-		if (prov_list.size() == 0)
-			return index_valid;
-
-		std::map<int, std::string>::iterator provider_iter = prov_list.begin();
-		while (provider_iter != prov_list.end())  //???
-		{
-			if (strcmp(node->get_iden(), provider_iter->second.c_str()) == 0)
-			{
-				index_valid = index;
-				break;
-
-			}
-			provider_iter++;
-			index++;
-		}
-	}
-	else
-	{
-		std::cout << "not find corresponding provider" << std::endl;
-	}
-	return index_valid;
+	consistent_hash_ring ring(provider, *nums);
+	return choose_subchannel(&ring, sn, arg.c_str());
 }
 
-void conistent_hash_lb::reset_cursor(const char * sn)
+int conistent_hash_lb::choose_subchannel(const consistent_hash_ring * ring, const char * sn, const char * arg)
 {
-	std::map<std::string, int>::iterator iter = cursors.find(sn);
-	if (iter == cursors.end())
-	{
-		cursors.insert(std::pair<std::string, int>(sn, -1));
-		return;
+	if (ring == NULL || sn == NULL) {
+		return 0;
 	}
-	iter->second = -1;
+	//ݲֵѡָķṩߣ޲ʱ
+	const char * factor = (arg == NULL || arg[0] == '\0') ? sn : arg;
+	int index = ring->lookup(factor);
+	return index < 0 ? 0 : index;
 }
 
-
-void conistent_hash_lb::gen_hash_rbtree(provider_t *prov, int num)
+int conistent_hash_lb::choose_subchannel_bounded(const consistent_hash_ring * ring, const char * sn, const char * arg,
+	provider_load_stats * const * loads, double factor)
 {
-	// provider list  hash 
-	 //every provider    &provider_lst_iter->second[index]  
-	int i;
-	char key[32] = { 0 };
-	for (i = 0; i < num; ++i)
-	{
-		sprintf(key, "%s:%d", prov[i].host, prov[i].port);
-		// index stored in data
-		cnode_s * node = new cnode_s(key, REPLICA_NUMBER, (void*)i);
-		// ڵhashֵʵڵӳ
-		conhash->add_node_s(node);
-		memset(key, 0, 32);
+	if (ring == NULL || sn == NULL) {
+		return 0;
 	}
+	const char * key = (arg == NULL || arg[0] == '\0') ? sn : arg;
+	int index = ring->lookup_bounded(key, strlen(key), loads, factor);
+	return index < 0 ? 0 : index;
 }
 
-
-provider_t * conistent_hash_lb::choose_provider(const char * sn, const std::string arg, int step)
+void conistent_hash_lb::reset_cursor(const char * sn)
 {
-	// õб
-	if (!sn)
-	{
-		return NULL;
-	}
-	int index = -1, index_valid = -1;
-	int size = 0;
-	std::string factor;
-	bool rebuild_tree = false;
-	//ڷҵ provider ڵ
-	cnode_s * node;
-
-	std::map<std::string, provider_t*>::iterator provider_iter = providers->find(sn);
-	if (provider_iter == providers->end())
-	{
-		return NULL;
-	}
-	
-        // fix divided by zero error
-        size = orientsec_grpc_cache_provider_count_get();
-        if (!size) return NULL;
-        
-        // object process
-	if (arg.empty())
-		factor = rand() % size;
-
-	//жϷбǷ仯仯Ҫ¹
-	provider_t *prov_list = provider_iter->second;
-	if (rebuild_tree)
-		gen_hash_rbtree(prov_list, 0);
-
-	//ݲֵѡָķṩ
-	//ʲôʶ provider?
-	node = conhash->lookup_node_s(arg.c_str());
-	if (node != NULL)
-	{
-
-		if (strcmp(node->get_iden(), "192.168.2.12:50033") == 0)
-			index_valid = 1;
-		if (strcmp(node->get_iden(), "192.168.2.12:50044") == 0)
-			index_valid = 2;
-
-	}
-	else
-	{
-		std::cout << "not find corresponding provider" << std::endl;
-	}
-
-	//ݲֵѡָķṩ
-
-	return clone_provider(&provider_iter->second[index_valid]);
-
 }
 
 provider_t * conistent_hash_lb::choose_provider(const char * sn, int step)
 {
 	return NULL;
 }
-
-void conistent_hash_lb::set_rebuild_flag(bool flag)
-{
-	this->rebuild_tree = flag;
-}
-
-bool conistent_hash_lb::get_rebuild_flag()
-{
-	return rebuild_tree;
-}
-
-bool conistent_hash_lb::gen_provider_list(provider_t * provider, const int * nums)
-{
-	int i = 0;
-	char prov_info[32] = { 0 };
-	//ݴproviderб,prov_list
-	prov_list.clear();
-
-	for (i = 0; i < *nums; ++i)
-	{
-		sprintf(prov_info, "%s:%d", provider[i].host, provider[i].port);
-		prov_list.insert(std::pair<int, std::string>(i, prov_info));
-	}
-	if (prov_list.size() == *nums)
-		return true;
-	else
-		return false;
-}
-
-bool conistent_hash_lb::compare_provider_list(provider_t * provider, int nums)
-{
-	//ȶԽһfalse
-	if ((int)(prov_list.size() != nums))
-		return false;
-	int comp_right_num = 0;
-	int i = 0;
-	char prov_info[32] = { 0 };
-	//ݴproviderб,prov_list
-	std::map<int, std::string>::iterator provider_iter;
-	for (i = 0; i < nums; ++i)
-	{
-		sprintf(prov_info, "%s:%d", provider[i].host, provider[i].port);
-		provider_iter = prov_list.begin();
-		while (provider_iter != prov_list.end())
-		{
-			if (provider_iter->second == prov_info)
-			{
-				comp_right_num++;
-				break;
-			}
-			else {
-				provider_iter++;
-			}
-		}
-	}
-	if (comp_right_num != nums)
-	{
-		return false;
-	}
-	else{
-		return true;
-	}
-
-}
@@ -43,40 +43,26 @@ extern "C" {
 	public:
 		conistent_hash_lb();
 		~conistent_hash_lb();
-		
-		void set_providers(std::map<std::string, provider_t*> *_providers);
+
+		void set_providers(std::map<std::string, provider_list*> *_providers);
 		int choose_subchannel(const char * sn, provider_t * provider, const int * nums);
 
+		// ʱѡȡеĿѡӦʹԴĻ
 		int choose_subchannel(const char * sn, provider_t * provider, const int * nums, const std::string &arg);
-		
-
-		void reset_cursor(const char* sn);
-
-		void gen_hash_rbtree(provider_t * prov,int num);
-		
-		provider_t * choose_provider(const char * sn, const std::string arg, int step);
-
-		provider_t* choose_provider(const char* sn, int step = 0);
 
-		void set_rebuild_flag(bool flag);
+		// ѽõĻѡȡargΪʱѡȡ
+		static int choose_subchannel(const consistent_hash_ring * ring, const char * sn, const char * arg);
 
-		bool get_rebuild_flag();
+		// bounded loadѡȡ;ƽֵfactorprovider
+		static int choose_subchannel_bounded(const consistent_hash_ring * ring, const char * sn, const char * arg,
+			provider_load_stats * const * loads, double factor);
 
-		bool gen_provider_list(provider_t * provider, const int * nums);
+		void reset_cursor(const char* sn);
 
-		bool compare_provider_list(provider_t * provider, int nums);
+		provider_t* choose_provider(const char* sn, int step = 0);
 
 	private:
-		std::map<std::string, provider_t*> *providers;
-		//ĳѡproviderλ
-		std::map<std::string, int> cursors;
-		std::string argument;
-
-		cmd5_hash_fun * func;
-		ccon_hash * conhash;
-
-		bool rebuild_tree;
-		std::map<int, std::string> prov_list;
+		std::map<std::string, provider_list*> *providers;
 	};
 
 
@@ -16,17 +16,77 @@
  */
 
 #include "failover_utils.h"
+#include <grpc/support/log.h>
+#include <string.h>
 #include "orientsec_consumer_intf.h"
 #include "orientsec_grpc_utils.h"
 #include "url.h"
 
-#define CONSUMERID_PROVIDERID_SEPARATOR "@"
 #define ONE_MINUTES_IN_MILLIS 60000
 
+failover_counter::failover_counter(const void* _key, const char* _provider,
+                                   failover_counter* _next)
+    : key(_key), provider(_provider), next(_next) {
+  gpr_atm_no_barrier_store(&failures, 0);
+  gpr_atm_no_barrier_store(&last_failure, 0);
+  gpr_atm_no_barrier_store(&last_refresh, 0);
+}
+
+failover_consumer::failover_consumer(const char* consumerid) {
+  for (int i = 0; i < ORIENTSEC_GRPC_FAILOVER_SHARDS; i++) {
+    gpr_atm_no_barrier_store(&m_shards[i], 0);
+  }
+  url_t* consumer_url = url_parse((char*)consumerid);
+  if (consumer_url) {
+    if (consumer_url->path) {
+      m_service_name = consumer_url->path;
+    }
+    url_free(consumer_url);
+    FREE_PTR(consumer_url);
+  }
+}
+
+failover_consumer::~failover_consumer() {
+  for (int i = 0; i < ORIENTSEC_GRPC_FAILOVER_SHARDS; i++) {
+    failover_counter* counter =
+        (failover_counter*)gpr_atm_no_barrier_load(&m_shards[i]);
+    while (counter) {
+      failover_counter* next = counter->next;
+      delete counter;
+      counter = next;
+    }
+  }
+}
+
+failover_counter* failover_consumer::find_or_add(const void* key,
+                                                 const char* provider) {
+  size_t hash = (size_t)((uintptr_t)key >> 4);
+  gpr_atm* shard = &m_shards[hash % ORIENTSEC_GRPC_FAILOVER_SHARDS];
+  failover_counter* added = NULL;
+  for (;;) {
+    gpr_atm head = gpr_atm_acq_load(shard);
+    for (failover_counter* counter = (failover_counter*)head; counter;
+         counter = counter->next) {
+      if (counter->key == key) {
+        delete added;  // 并发插入时以先插入的为准
+        return counter;
+      }
+    }
+    if (added == NULL) {
+      added = new failover_counter(key, provider, NULL);
+    }
+    added->next = (failover_counter*)head;
+    if (gpr_atm_rel_cas(shard, head, (gpr_atm)added)) {
+      return added;
+    }
+  }
+}
+
 failover_utils::failover_utils() { 
   // initializztion
   m_switch_threshold = 5; 
   m_punish_time = ONE_MINUTES_IN_MILLIS;
+  max_backoff_time = 0;
 }
 
 failover_utils::~failover_utils() {}
@@ -46,113 +106,112 @@ int failover_utils::get_max_backoff_time() {
 }
 
 // client需要用长连接
-void failover_utils::record_provider_failure(char* consumerid,
-                                             char* providerid,char* methods) {
-  if (!consumerid || strlen(providerid) == 0 || providerid == NULL) {
+// provider_key为调用选中provider的负载统计对象，为空时按providerid查找
+void failover_utils::record_provider_failure(failover_consumer* consumer,
+                                             const void* provider_key,
+                                             char* providerid, char* methods) {
+  if (!consumer || providerid == NULL || strlen(providerid) == 0) {
     return;
   }
-  // format provider ID(ip:port)
-  std::string provider = providerid;
-  char* pi = new char[32];
-  size_t pos = provider.find_first_of(':');
-  if (pos == std::string::npos) {
+  // format provider ID(ip:port)，去掉ipv4:/ipv6:前缀，ipv6为[ip]:port
+  const char* pi = strchr(providerid, ':');
+  if (pi == NULL) {
     gpr_log(GPR_ERROR,
             "invalid providerId,[%s],should split by : ", providerid);
     return;
   }
-  std::string provider_host = provider.substr(pos + 1);
-  strcpy(pi, provider_host.c_str());
-
-  std::string key =
-      std::string(consumerid) + CONSUMERID_PROVIDERID_SEPARATOR + pi;
-  uint64_t current_timestamp = orientsec_get_timestamp_in_mills();
-  uint64_t last_timestamp = 0;  //上次更新时间
-  std::map<std::string, uint64_t>::iterator last_failing_timeiter =
-      m_last_failing_timestamp.find(key.c_str());
-  //查询上次更新时间
-  if (last_failing_timeiter != m_last_failing_timestamp.end()) {
-    last_timestamp = last_failing_timeiter->second;
-  } else {
-    last_timestamp = current_timestamp;
-    m_last_failing_timestamp[key] =
-        current_timestamp;  // 初始化为0时，首次满足容错次数立马更新
+  pi++;
+  if (provider_key == NULL) {
+    provider_key = consumer_provider_load_find(providerid);
+    if (provider_key == NULL) {
+      return;
+    }
+  }
+
+  failover_counter* counter = consumer->find_or_add(provider_key, pi);
+  int64_t current_timestamp = (int64_t)orientsec_get_timestamp_in_mills();
+  //查询上次更新时间，首次失败时初始化为当前时间
+  int64_t last_timestamp = (int64_t)gpr_atm_acq_load(&counter->last_refresh);
+  if (last_timestamp == 0) {
+    if (gpr_atm_rel_cas(&counter->last_refresh, 0,
+                        (gpr_atm)current_timestamp)) {
+      last_timestamp = current_timestamp;
+    } else {
+      last_timestamp = (int64_t)gpr_atm_acq_load(&counter->last_refresh);
+    }
   }
   //如果已经更新,记录更新时间
-  if (update_fail_times(consumerid, pi, last_timestamp,
-                        current_timestamp,methods) == 1) {
-    m_last_failing_timestamp[key] = current_timestamp;
+  if (update_fail_times(consumer, counter, last_timestamp, current_timestamp,
+                        methods) == 1) {
+    gpr_atm_rel_store(&counter->last_refresh, (gpr_atm)current_timestamp);
   }
-
-  free(pi);
 }
 
 //目前不需要记录错误关系
 void failover_utils::update_failing_providers(char* consumerid,
                                               char* providerid) {}
 // 记录更新时间
-int failover_utils::update_fail_times(char* consumerid, char* providerid,
+int failover_utils::update_fail_times(failover_consumer* consumer,
+                                      failover_counter* counter,
                                       int64_t lasttime_stamp,
                                       int64_t current_timestamp,
                                       char* methods) {
   int result = 0;
-  if (!consumerid || !providerid || strlen(providerid) == 0) {
+  char* service_name = (char*)consumer->service_name();
+  char* providerid = (char*)counter->provider.c_str();
+  if (strlen(service_name) == 0) {
     return result;
   }
-  std::string key =
-      std::string(consumerid) + CONSUMERID_PROVIDERID_SEPARATOR + providerid;
-  std::map<std::string, gpr_atm>::iterator request_failure_iter =
-      m_request_failures.find(key);
-  if (request_failure_iter == m_request_failures.end()) {
-    m_request_failures.insert(std::pair<std::string, int>(key, 0));
-    request_failure_iter = m_request_failures.find(key);
-  }
   // 为了提高性能，不对调用成功的情况进行记录，使用以下策略近似判断连续多次调用失败：
   // 将当前时间和最后一次出错时间的记录做比较，如果时间间隔大于60秒，将之前的错误次数清0
-  if (current_timestamp - lasttime_stamp > ONE_MINUTES_IN_MILLIS) {
-    gpr_atm_rel_store(&request_failure_iter->second, 0);
+  int64_t last_failure = (int64_t)gpr_atm_no_barrier_load(&counter->last_failure);
+  gpr_atm_no_barrier_store(&counter->last_failure, (gpr_atm)current_timestamp);
+  if (last_failure != 0 &&
+      current_timestamp - last_failure > ONE_MINUTES_IN_MILLIS) {
+    gpr_atm_rel_store(&counter->failures, 0);
   }
 
   //出错次数+1
-  gpr_atm_full_fetch_add(&request_failure_iter->second, 1);
-  url_t* consumer_url = url_parse(consumerid);
-  if (!consumer_url) {
-    return result;
-  }
+  gpr_atm failures = gpr_atm_full_fetch_add(&counter->failures, 1) + 1;
 
-  //可用provider
-  int consumer_lb_provider_count =
-      get_valid_providers_acount(consumer_url->path, methods);
+  //可用provider，-1表示尚未查询，只在需要时读取快照
+  int consumer_lb_provider_count = -1;
   //出错次数大于允许次数
-  if (gpr_atm_acq_load(&request_failure_iter->second) > m_switch_threshold) {
+  if (failures > m_switch_threshold) {
+    consumer_lb_provider_count =
+        get_valid_providers_acount(service_name, methods);
     //只存在一个可用provider，并且调用还失败了
     if (consumer_lb_provider_count == 1) {
       //需要进行惩罚
       if (m_punish_time > 0) {
-        set_provider_failover_flag(consumer_url->path, providerid);
+        set_provider_failover_flag(service_name, providerid);
+        consumer_lb_provider_count = -1;
       }
     } else if (consumer_lb_provider_count >
                1) {  //存在多个provider的情况，可以选择其他provider
-      set_provider_failover_flag(consumer_url->path, providerid);
+      set_provider_failover_flag(service_name, providerid);
+      consumer_lb_provider_count = -1;
     }
-    gpr_atm_rel_store(&request_failure_iter->second, 0);
+    gpr_atm_rel_store(&counter->failures, 0);
   }
-    printf("failed time = %Id,valid provider num= %d\n",request_failure_iter->second,consumer_lb_provider_count);
-
-  //获取可用provider数量
-  consumer_lb_provider_count =
-      get_valid_providers_acount(consumer_url->path, methods);
+  gpr_log(GPR_DEBUG, "failed time = %ld,valid provider num= %d",
+          (long)failures, consumer_lb_provider_count);
 
   //无可用provider，当前时间和上次更新时间差大于等于惩罚时间时更新provider列表
-  if (consumer_lb_provider_count == 0 &&
-      (current_timestamp - lasttime_stamp) >= m_punish_time) {
-    //出错次数清理
-    gpr_atm_rel_store(&request_failure_iter->second, 0);
-
-    // 重新查询一遍服务提供者，将注册中心上的服务列表写入当前消费者的服务列表
-    get_all_providers_by_name(consumer_url->path);
-    result = 1;
+  if ((current_timestamp - lasttime_stamp) >= m_punish_time) {
+    //获取可用provider数量
+    if (consumer_lb_provider_count < 0) {
+      consumer_lb_provider_count =
+          get_valid_providers_acount(service_name, methods);
+    }
+    if (consumer_lb_provider_count == 0) {
+      //出错次数清理
+      gpr_atm_rel_store(&counter->failures, 0);
+
+      // 重新查询一遍服务提供者，将注册中心上的服务列表写入当前消费者的服务列表
+      get_all_providers_by_name(service_name);
+      result = 1;
+    }
   }
-  url_free(consumer_url);
-  FREE_PTR(consumer_url);
   return result;
 }
@@ -28,10 +28,46 @@
 #include<vector>
 #include<string>
 
+// 每个consumer的provider失败计数分片数
+#define ORIENTSEC_GRPC_FAILOVER_SHARDS 16
+
 #ifdef __cplusplus
 extern "C" {
 #endif
 
+// 某consumer调用某provider(ip:port)的失败计数，只用原子操作读写
+class failover_counter
+{
+public:
+	failover_counter(const void* _key, const char* _provider, failover_counter* _next);
+	//provider的负载统计对象，每个host:port一个且不释放，作为provider的唯一标识
+	const void* key;
+	std::string provider;
+	gpr_atm failures;
+	//最后一次失败时间(毫秒)，间隔超过1分钟时失败次数清零
+	gpr_atm last_failure;
+	//上次刷新provider列表的时间(毫秒)，首次失败时初始化
+	gpr_atm last_refresh;
+	failover_counter* next;
+};
+
+// 一个channel(consumer)的容错记录，consumer url只在创建时解析一次。
+// provider计数按provider分片挂在链表上，只增不删，channel销毁时一并释放
+class failover_consumer
+{
+public:
+	failover_consumer(const char* consumerid);
+	~failover_consumer();
+	const char* service_name() const { return m_service_name.c_str(); }
+	// 按provider标识无锁查找，不存在时CAS插入，provider(ip:port)只在插入时复制
+	failover_counter* find_or_add(const void* key, const char* provider);
+private:
+	failover_consumer(const failover_consumer&);
+	failover_consumer& operator=(const failover_consumer&);
+	std::string m_service_name;
+	gpr_atm m_shards[ORIENTSEC_GRPC_FAILOVER_SHARDS];
+};
+
 class failover_utils
 {
 private:
@@ -45,17 +81,7 @@ private:
         //zookeeper算法里backoff算法里max backoff参数取值
         int max_backoff_time;
 
-	//调用失败的客户端对应服务提供者列表,key值为：consumerId 
-	std::map<std::string, std::vector<std::string> > m_failing_providers;
-
-	//各个客户端最后一个服务提供者的删除时间,key值为：consumerId 
-	std::map<std::string, uint64_t> m_remove_provider_timestamp;
-
-	//各个客户端对应服务提供者最后一次服务调用失败时间,key值为：consumerId@IP:port
-	std::map<std::string, uint64_t> m_last_failing_timestamp;
-
-	//各个客户端对应服务提供者服务调用失败次数,key值为：consumerId@IP:port
-	std::map<std::string, gpr_atm> m_request_failures;
+	// 失败计数保存在各channel的failover_consumer中
 public:
 	failover_utils();
 	~failover_utils();
@@ -63,9 +89,10 @@ public:
 	void set_punish_time(int _punishtime);
         void set_max_backoff_time(int _max_backoff_time);
         int get_max_backoff_time();
-        void record_provider_failure(char* consumerid, char* providerid,char* methods);
+        void record_provider_failure(failover_consumer* consumer, const void* provider_key,
+                                     char* providerid, char* methods);
 	void update_failing_providers(char* consumerid, char* providerid);
-        int update_fail_times(char* consumerid, char* providerid,
+        int update_fail_times(failover_consumer* consumer, failover_counter* counter,
                               int64_t lasttime_stamp, int64_t currenttime_stamp,
                               char* methods);
 
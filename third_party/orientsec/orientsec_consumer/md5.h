@@ -1,36 +0,0 @@
-/*
- * Copyright 2019 Orient Securities Co., Ltd.
- * Copyright 2019 BoCloud Inc.
- *
- * Licensed under the Apache License, Version 2.0 (the "License");
- * you may not use this file except in compliance with the License.
- * You may obtain a copy of the License at
- *
- * http://www.apache.org/licenses/LICENSE-2.0
- *
- * Unless required by applicable law or agreed to in writing, software
- * distributed under the License is distributed on an "AS IS" BASIS,
- * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
- * See the License for the specific language governing permissions and
- * limitations under the License.
- */
-
-#ifndef MD5_H
-#define MD5_H
-
-
-typedef unsigned char md5_byte_t; /* 8-bit byte */
-typedef unsigned int md5_word_t; /* 32-bit word */
-
-								 /* Define the state of the MD5 Algorithm. */
-typedef struct md5_state_s {
-	md5_word_t count[2];	/* message length in bits, lsw first */
-	md5_word_t abcd[4];		/* digest buffer */
-	md5_byte_t buf[64];		/* accumulate block */
-} md5_state_t;
-
-void md5_init(md5_state_t *pms);
-void md5_append(md5_state_t *pms, const md5_byte_t *data, int nbytes);
-void md5_finish(md5_state_t *pms, md5_byte_t digest[16]);
-
-#endif
@@ -30,12 +30,15 @@
 #include <map>
 #include <set>
 #include <string>
+#include <unordered_set>
 #include <vector>
 
 #include <grpc/support/alloc.h>
 #include <grpc/support/log.h>
 #include <grpc/support/sync.h>
+#include <grpc/support/time.h>
 #include <src/core/lib/gpr/spinlock.h>
+#include <src/core/lib/gprpp/thd.h>
 #include "orientsec_grpc_properties_constants.h"
 #include "orientsec_grpc_properties_tools.h"
 #include "orientsec_grpc_registy_intf.h"
@@ -57,7 +60,12 @@
 #include "orientsec_grpc_string_op.h"
 #include "orientsec_loadbalance.h"
 #include "orientsec_router.h"
+#include "outlier_detection.h"
+#include "p2c_ewma_lb.h"
 #include "pickfirst_lb.h"
+#include "provider_load_stats.h"
+#include "provider_snapshot.h"
+#include "registry_snapshot_file.h"
 #include "requests_controller_utils.h"
 #include "round_robin_lb.h"
 #include "weight_round_robin_lb.h"
@@ -65,11 +73,11 @@
 // addbylm
 #include "src/core/ext/filters/client_channel/lb_policy_registry.h"
 
-// 全局provider list缓存
-static std::map<std::string, provider_t*> g_cache_providers;
+// 全局provider list缓存，只保存在线的provider
+static std::map<std::string, provider_list*> g_cache_providers;
 
-// 过滤后的缓存provider，用于建立subchannel，用于负载均衡
-static std::map<std::string, provider_t*> g_valid_providers;
+// g_cache_providers的只读快照，选取provider时无锁读取
+static provider_snapshot_registry g_provider_snapshots;
 
 //保存某服务名下的router列表
 static std::map<std::string, std::vector<router*> > g_valid_routers;
@@ -85,17 +93,19 @@ static std::map<std::string, std::string> g_method_lbalgorithem;
 
 // 判断是否存在master provider online
 static bool g_exist_master = true;
-/* 由于主备属性发生变化是否需要resolve,规则：
+/* 每个服务的治理变化计数，channel订阅后比较计数决定是否重新resolve。
+ * 以下变化会增加计数：provider列表、路由规则、主备属性、服务分组、
+ * 方法级负载均衡配置，以及连接负载均衡模式下的服务版本和容错标记。
+ * 主备属性的规则：
  * (1) 当服务端列表中全部都是主服务器的时候，服务端列表不发生变化
  * (2) 当服务端列表中全部都是备服务器的时候，服务端列表不发生变化
  * (3) 当服务端列表中既有主服务器也有备服务器的时候，将备服务器从
  *     服务列表中移除出去，只保留主服务器
+ * 计数只增不删，订阅者可以一直持有返回的指针
  */
-static bool g_active_standby = false;
-
-static bool g_group_grading = false;
-
-static bool g_need_resolve = false;
+static std::map<std::string, gpr_atm*> g_governance_generations;
+static gpr_mu g_governance_mu;
+static gpr_once g_governance_once = GPR_ONCE_INIT;
 
 /* Protects provider_queue */
 static gpr_mu g_providers_mu;
@@ -110,13 +120,15 @@ static gpr_spinlock g_checker_consumer_mu = GPR_SPINLOCK_STATIC_INITIALIZER;
 static bool g_initialized = false;
 
 static bool g_isrequest_lb_mode = false;  //默认是连接负载均衡
-// 是否基于方法的负载均衡
-static bool g_method_lb = false;
+
+// consistent_hash_bounded的负载系数
+static double g_ch_load_factor = ORIENTSEC_GRPC_CH_DEFAULT_LOAD_FACTOR;
 
 static orientsec_grpc_loadbalance* pfLB = new pickfirst_lb();
 static orientsec_grpc_loadbalance* rrLB = new round_robin_lb();
 static orientsec_grpc_loadbalance* wrrLB = new weight_round_robin_lb();
 static conistent_hash_lb* chLB = new conistent_hash_lb();
+static orientsec_grpc_loadbalance* p2cLB = new p2c_ewma_lb();
 
 static failover_utils g_failover_utils;  // 容错切换
 static int orientsec_grpc_provider_callback_ok =
@@ -125,6 +137,13 @@ static int orientsec_grpc_router_callback_ok = 0;  //初始回调时置0 回调
 
 static requests_controller_utils g_request_controller_utils;
 
+static outlier_detection_config g_outlier_config;  // 离群provider摘除
+static grpc_core::Thread* g_outlier_thd = NULL;     // 离群检测线程
+static void outlier_detection_loop(void* arg);
+
+// 注册中心本地快照，配置目录后启用
+static registry_snapshot_store g_registry_snapshots;
+
 #define GRPC_PROVIDERS_LIST_LOCK_START          \
   {                                             \
     gpr_spinlock_lock(&g_checker_providers_mu); \
@@ -149,6 +168,67 @@ static requests_controller_utils g_request_controller_utils;
     gpr_spinlock_unlock(&g_checker_consumer_mu); \
   }
 
+// 发布某服务的provider快照，调用方需持有provider锁
+static void publish_providers_snapshot_locked(const char* service_name) {
+  if (!service_name) {
+    return;
+  }
+  std::map<std::string, provider_list*>::iterator provider_lst =
+      g_cache_providers.find(service_name);
+  if (provider_lst == g_cache_providers.end()) {
+    g_provider_snapshots.remove(service_name);
+    return;
+  }
+  provider_t* providers = provider_lst->second->data();
+  int num = provider_lst->second->size();
+  g_provider_snapshots.publish(service_name, providers, num);
+  // 过时提示在发布时记录，快照的读取路径不写全局状态
+  for (int i = 0; i < num; i++) {
+    if (providers[i].flag_invalid == 0 && providers[i].deprecated) {
+      consumer_check_provider_deprecated((char*)service_name, true);
+      break;
+    }
+  }
+}
+
+static void governance_mu_init() { gpr_mu_init(&g_governance_mu); }
+
+// 返回某服务的治理变化计数，不存在时创建，调用方需持有g_governance_mu
+static gpr_atm* governance_generation_locked(const char* service_name) {
+  std::map<std::string, gpr_atm*>::iterator iter =
+      g_governance_generations.find(service_name);
+  if (iter != g_governance_generations.end()) {
+    return iter->second;
+  }
+  gpr_atm* generation = new gpr_atm;
+  gpr_atm_no_barrier_store(generation, 0);
+  g_governance_generations.insert(
+      std::pair<std::string, gpr_atm*>(service_name, generation));
+  return generation;
+}
+
+// 通知订阅该服务的channel重新resolve
+static void governance_changed(const char* service_name) {
+  if (!service_name) {
+    return;
+  }
+  gpr_once_init(&g_governance_once, governance_mu_init);
+  gpr_mu_lock(&g_governance_mu);
+  gpr_atm_full_fetch_add(governance_generation_locked(service_name), 1);
+  gpr_mu_unlock(&g_governance_mu);
+}
+
+const gpr_atm* consumer_governance_subscribe(const char* service_name) {
+  if (!service_name) {
+    return NULL;
+  }
+  gpr_once_init(&g_governance_once, governance_mu_init);
+  gpr_mu_lock(&g_governance_mu);
+  gpr_atm* generation = governance_generation_locked(service_name);
+  gpr_mu_unlock(&g_governance_mu);
+  return generation;
+}
+
 void init_providers_list() {
   if (!g_initialized) {
     char buf[ORIENTSEC_GRPC_PROPERTY_KEY_MAX_LEN] = {0};
@@ -159,6 +239,7 @@ void init_providers_list() {
     rrLB->set_providers(&g_cache_providers);
     wrrLB->set_providers(&g_cache_providers);
     chLB->set_providers(&g_cache_providers);
+    p2cLB->set_providers(&g_cache_providers);
     orientsec_grpc_properties_init();
     if (0 == orientsec_grpc_properties_get_value(
                  ORIENTSEC_GRPC_PROPERTIES_C_CONSUMER_SWITH_THRES, NULL, buf)) {
@@ -194,6 +275,78 @@ void init_providers_list() {
       }
     }
     // end by liumin
+    memset(buf, 0, ORIENTSEC_GRPC_PROPERTY_KEY_MAX_LEN);
+    if (0 == orientsec_grpc_properties_get_value(
+                 ORIENTSEC_GRPC_PROPERTIES_C_CONSISTENT_HASH_LOAD_FACTOR, NULL,
+                 buf)) {
+      double factor = atof(buf);
+      if (factor >= 1.0) {
+        g_ch_load_factor = factor;
+      }
+    }
+    memset(buf, 0, ORIENTSEC_GRPC_PROPERTY_KEY_MAX_LEN);
+    if (0 == orientsec_grpc_properties_get_value(
+                 ORIENTSEC_GRPC_PROPERTIES_C_OUTLIER_ENABLED, NULL, buf)) {
+      g_outlier_config.enabled = (0 == strcmp(buf, "true"));
+    }
+    memset(buf, 0, ORIENTSEC_GRPC_PROPERTY_KEY_MAX_LEN);
+    if (0 == orientsec_grpc_properties_get_value(
+                 ORIENTSEC_GRPC_PROPERTIES_C_OUTLIER_BASE_EJECTION_TIME, NULL,
+                 buf)) {
+      value = atoi(buf);
+      if (value > 0) {
+        g_outlier_config.base_ejection_us = (int64_t)value * 1000 * 1000;
+        if (g_outlier_config.max_ejection_us <
+            g_outlier_config.base_ejection_us) {
+          g_outlier_config.max_ejection_us = g_outlier_config.base_ejection_us;
+        }
+      }
+    }
+    memset(buf, 0, ORIENTSEC_GRPC_PROPERTY_KEY_MAX_LEN);
+    if (0 == orientsec_grpc_properties_get_value(
+                 ORIENTSEC_GRPC_PROPERTIES_C_OUTLIER_MAX_EJECTION_PERCENT, NULL,
+                 buf)) {
+      value = atoi(buf);
+      if (value >= 0 && value <= 100) {
+        g_outlier_config.max_ejection_percent = value;
+      }
+    }
+    memset(buf, 0, ORIENTSEC_GRPC_PROPERTY_KEY_MAX_LEN);
+    if (0 == orientsec_grpc_properties_get_value(
+                 ORIENTSEC_GRPC_PROPERTIES_C_OUTLIER_MIN_REQUESTS, NULL, buf)) {
+      value = atoi(buf);
+      if (value > 0) {
+        g_outlier_config.min_requests = value;
+      }
+    }
+    memset(buf, 0, ORIENTSEC_GRPC_PROPERTY_KEY_MAX_LEN);
+    if (0 == orientsec_grpc_properties_get_value(
+                 ORIENTSEC_GRPC_PROPERTIES_C_OUTLIER_STDEV_FACTOR, NULL, buf)) {
+      double factor = atof(buf);
+      if (factor > 0) {
+        g_outlier_config.stdev_factor = factor;
+      }
+    }
+    memset(buf, 0, ORIENTSEC_GRPC_PROPERTY_KEY_MAX_LEN);
+    if (0 == orientsec_grpc_properties_get_value(
+                 ORIENTSEC_GRPC_PROPERTIES_C_OUTLIER_LATENCY_FACTOR, NULL,
+                 buf)) {
+      double factor = atof(buf);
+      if (factor > 1.0) {
+        g_outlier_config.latency_factor = factor;
+      }
+    }
+    if (g_outlier_config.enabled && g_outlier_thd == NULL) {
+      g_outlier_thd = new grpc_core::Thread("outlier_detection",
+                                            outlier_detection_loop, NULL);
+      g_outlier_thd->Start();
+    }
+    memset(buf, 0, ORIENTSEC_GRPC_PROPERTY_KEY_MAX_LEN);
+    if (0 == orientsec_grpc_properties_get_value(
+                 ORIENTSEC_GRPC_PROPERTIES_C_REGISTRY_SNAPSHOT_DIR, NULL,
+                 buf)) {
+      g_registry_snapshots.set_dir(buf);
+    }
 
     g_initialized = true;
   }
@@ -220,7 +373,8 @@ char* orientsec_grpc_get_sn_from_target(char* target) {
   return gprc_strdup(sn.c_str());
 }
 
-void revoker_providers_list_process(const char* sn) {
+// 重新计算黑白名单标记，调用方需持有provider锁
+static void revoker_providers_list_process_locked(const char* sn) {
   if (!sn) {
     return;
   }
@@ -231,11 +385,12 @@ void revoker_providers_list_process(const char* sn) {
   }
   std::map<std::string, std::vector<router*> >::iterator routeMapIter =
       g_valid_routers.find(sn);
-  std::map<std::string, provider_t*>::iterator provider_lst_iter =
+  std::map<std::string, provider_list*>::iterator provider_lst_iter =
       g_cache_providers.find(sn);
   if (provider_lst_iter == g_cache_providers.end()) {
     return;
   }
+  provider_list* providers = provider_lst_iter->second;
   if (routeMapIter != g_valid_routers.end()) {
     //遍历执行路由规则，按指定服务逐条执行路由规则
     for (std::vector<router*>::iterator routeIter =
@@ -244,16 +399,27 @@ void revoker_providers_list_process(const char* sn) {
       router* route = *routeIter;
 
       // consumer参数作用是什么  ？
-      route->route(provider_lst_iter->second, consumerIter->second[0]);
+      route->route(providers->data(), providers->size(),
+                   consumerIter->second[0]);
     }
   } else {  //清除黑名单，为对provider进行恢复
-    for (size_t i = 0; i < orientsec_grpc_cache_provider_count_get(); i++) {
-      provider_lst_iter->second[i].flag_in_blklist =
+    for (int i = 0; i < providers->size(); i++) {
+      providers->at(i).flag_in_blklist =
           ORIENTSEC_GRPC_PROVIDER_FLAG_IN_BLKLIST_NOT;
     }
   }
 }
 
+void revoker_providers_list_process(const char* sn) {
+  if (!sn) {
+    return;
+  }
+  GRPC_PROVIDERS_LIST_LOCK_START
+  revoker_providers_list_process_locked(sn);
+  publish_providers_snapshot_locked(sn);
+  GRPC_PROVIDERS_LIST_LOCK_END
+}
+
 bool provider_weight_comp(provider_t* p1, provider_t* p2) {
   if (!p1 || !p2) {
     return false;
@@ -264,153 +430,68 @@ bool provider_weight_comp(provider_t* p1, provider_t* p2) {
   return false;
 }
 
-//更新缓存，首先清除原空间，再保存
+//更新缓存，调用方需持有provider锁
 // reset  是否重置容错标记 1 重置 0 不重置
-void updateProvidersCache(const char* service_name, url_t* urls, int url_num,
-                          int reset) {
-  GRPC_PROVIDERS_LIST_LOCK_START
-  // char provider_add[HOST_MAX_LEN];
-  bool need_free_cache = false;
-  std::set<std::string> new_providers;
-  std::set<std::string> old_providers;
-  int i = 0;
-  // change function to local variable
-  int cache_providers_num = orientsec_grpc_cache_provider_count_get();
-  int index_free = -1;
-  int index_invalid = -1;
-  uint64_t time_invalid = 0;
-  uint64_t time_now = orientsec_get_timestamp_in_mills();
-  std::map<std::string, provider_t*>::iterator provider_lst =
+static void update_providers_cache_locked(const char* service_name,
+                                          url_t* urls, int url_num,
+                                          int reset) {
+  std::map<std::string, provider_list*>::iterator provider_lst =
       g_cache_providers.find(service_name);
   if (urls == NULL) {
+    //全部下线
     if (provider_lst != g_cache_providers.end()) {
-      //设置provider标记为无效myurl
-      for (i = 0; i < cache_providers_num; i++) {
-        provider_lst->second[i].flag_invalid = 1;
-        provider_lst->second[i].flag_invalid_timestamp =
-            orientsec_get_timestamp_in_mills();
-      }
+      provider_lst->second->clear();
     }
   } else {
-    if (provider_lst != g_cache_providers.end()) {
-      provider_t provider;
-
-      int index_provider = -1;  //同ip和端口的provider坐标位置
-      int index_write = -1;     //可更新的坐标位置
-      bool need_update = true;
-
-      //如果服务列表在url列表不存在，代表服务已下线
-      for (i = 0; i < cache_providers_num; i++) {
-        need_update = true;
-        for (int j = 0; j < url_num; j++) {
-          //如果指定服务在url列表仍然存在，这不需要下线该服务
-          if (provider_lst->second[i].flag_invalid == 0 &&
-              (provider_lst->second[i].host != NULL && urls[j].host != NULL &&
-               strcmp(provider_lst->second[i].host, urls[j].host) == 0) &&
-              (provider_lst->second[i].port != NULL && urls[j].port != NULL &&
-               provider_lst->second[i].port == urls[j].port)) {
-            need_update = false;
-          }
-        }
-        if (need_update) {
-          provider_lst->second[i].flag_invalid = 1;
-          provider_lst->second[i].flag_invalid_timestamp = time_now;
-        }
-      }
-
-      for (int j = 0; j < url_num; j++) {
-        init_provider_from_url(&provider, &urls[j]);
-
-        index_free = -1;
-        index_write = -1;
-        need_update = true;
-        for (i = 0; i < cache_providers_num; i++) {
-          //查找首个未占用的数组元素
-          if (provider_lst->second[i].flag_invalid_timestamp =
-                  0 && index_free == -1) {
-            index_free = i;
-          }
-
-          //最早的无效数据坐标
-          if (provider_lst->second[i].flag_invalid == 1) {
-            if (index_invalid == -1) {
-              time_invalid = provider_lst->second[i].flag_invalid_timestamp;
-              index_invalid = i;
-            } else if (time_invalid >
-                       provider_lst->second[i].flag_invalid_timestamp) {
-              time_invalid = provider_lst->second[i].flag_invalid_timestamp;
-              index_invalid = i;
-            }
-          }
-
-          //原来数据位置
-          if (provider_lst->second[i].flag_invalid == 0 &&
-              strcmp(provider.host, provider_lst->second[i].host) == 0 &&
-              provider.port == provider_lst->second[i].port) {
-            //重置容错标记
-            if (reset) {
-              provider_lst->second[i].flag_call_failover = 0;
-            }
-
-            //比较时间戳确定是否需要更新
-            if (provider.timestamp > provider_lst->second[i].timestamp) {
-              index_provider = i;
-            } else {
-              need_update = false;
-              break;
-            }
-          }
-        }
-
-        if (need_update == false) {
-          free_provider_v2_ex(&provider);
-          continue;
+    if (provider_lst == g_cache_providers.end()) {
+      provider_lst = g_cache_providers
+                         .insert(std::pair<std::string, provider_list*>(
+                             std::string(service_name), new provider_list()))
+                         .first;
+    }
+    provider_list* providers = provider_lst->second;
+    int64_t time_now = orientsec_get_timestamp_in_mills();
+
+    std::unordered_set<std::string> online;
+    provider_t provider;
+    for (int j = 0; j < url_num; j++) {
+      memset(&provider, 0, sizeof(provider_t));
+      init_provider_from_url(&provider, &urls[j]);
+      online.insert(provider_list::key(provider.host, provider.port));
+      provider_t* cached = providers->find(provider.host, provider.port);
+      if (cached != NULL) {
+        //重置容错标记
+        if (reset) {
+          cached->flag_call_failover = 0;
         }
-
-        if (index_free >= 0) {
-          index_write = index_free;
-        } else if (index_invalid >= 0) {
-          index_write = index_invalid;
-        } else {  //数组已经放满
-          printf("service buffer is full....");
+        //比较时间戳确定是否需要更新
+        if (provider.timestamp <= cached->timestamp) {
           free_provider_v2_ex(&provider);
           continue;
         }
-
-        //把新服务写入所查找到的位置。
-        provider.flag_invalid_timestamp = time_now;
-        provider_lst->second[index_write] = provider;
-
-        //标记老数据为无效,并记录无效时间
-        if (index_provider >= 0) {
-          provider_lst->second[index_provider].flag_invalid = 1;
-          provider_lst->second[index_provider].flag_invalid_timestamp =
-              time_now;
-        }
       }
-    } else {
-      provider_t* providers =
-          (provider_t*)gpr_zalloc(sizeof(provider_t) * cache_providers_num);
+      provider.flag_invalid_timestamp = time_now;
+      providers->upsert(provider);
+    }
 
-      for (i = 0; i < cache_providers_num && i < url_num; i++) {
-        init_provider_from_url(&providers[i], &urls[i]);
-        providers[i].flag_invalid_timestamp = time_now;
-      }
-      if (cache_providers_num > url_num) {
-        i = url_num;
-      } else {
-        i = cache_providers_num;
-      }
-      for (i; i < cache_providers_num; i++) {
-        providers[i].flag_invalid = 1;  //初始列表
-        providers[i].flag_invalid_timestamp = 0;
+    //如果服务列表在url列表不存在，代表服务已下线
+    for (int i = providers->size() - 1; i >= 0; i--) {
+      const provider_t& cached = providers->at(i);
+      if (online.find(provider_list::key(cached.host, cached.port)) ==
+          online.end()) {
+        providers->remove_at(i);
       }
-      g_cache_providers.insert(std::pair<std::string, provider_t*>(
-          std::string(service_name), providers));
     }
   }
   rrLB->reset_cursor(service_name);
   wrrLB->reset_cursor(service_name);
+}
+
+void updateProvidersCache(const char* service_name, url_t* urls, int url_num,
+                          int reset) {
+  GRPC_PROVIDERS_LIST_LOCK_START
+  update_providers_cache_locked(service_name, urls, url_num, reset);
+  publish_providers_snapshot_locked(service_name);
   GRPC_PROVIDERS_LIST_LOCK_END
 }
 
@@ -425,13 +506,96 @@ void consumer_providers_callback(url_t* urls, int url_num) {
     updateProvidersCache(service_name, NULL, 0, 1);  // 置所有服无效 url_num
                                                      //重置服务状态。
   } else {
-    updateProvidersCache(service_name, urls, url_num, 1);
+    // 更新列表与黑白名单计算在同一次加锁内完成，只发布一次快照
+    GRPC_PROVIDERS_LIST_LOCK_START
+    update_providers_cache_locked(service_name, urls, url_num, 1);
     //重新计算黑白名单标记 ----debug 调试临时关闭
-    revoker_providers_list_process(urls[0].path);
+    revoker_providers_list_process_locked(urls[0].path);
+    publish_providers_snapshot_locked(service_name);
+    GRPC_PROVIDERS_LIST_LOCK_END
 
     // zookeeper provider list changed
-    g_active_standby = true;
+    governance_changed(service_name);
   }
+  g_registry_snapshots.update(REGISTRY_SNAPSHOT_PROVIDERS, urls, url_num);
+}
+
+//按增量更新缓存，调用方需持有provider锁
+static void update_providers_delta_locked(const char* service_name,
+                                          url_t* added, int added_num,
+                                          url_t* removed, int removed_num) {
+  std::map<std::string, provider_list*>::iterator provider_lst =
+      g_cache_providers.find(service_name);
+  if (provider_lst == g_cache_providers.end()) {
+    provider_lst = g_cache_providers
+                       .insert(std::pair<std::string, provider_list*>(
+                           std::string(service_name), new provider_list()))
+                       .first;
+  }
+  provider_list* providers = provider_lst->second;
+  int64_t time_now = orientsec_get_timestamp_in_mills();
+
+  //先处理下线，同一host:port重新注册时由新增的url覆盖
+  char host[HOST_MAX_LEN];
+  for (int i = 0; i < removed_num; i++) {
+    snprintf(host, sizeof(host), "%s", removed[i].host);
+    provider_t* cached = providers->find(host, removed[i].port);
+    if (cached == NULL) {
+      continue;
+    }
+    // 缓存来自时间戳更新的子节点时保留
+    char* timestamp = url_get_parameter_v2(
+        &removed[i], ORIENTSEC_GRPC_REGISTRY_KEY_TIMESTAMP, NULL);
+    if (timestamp != NULL && cached->timestamp > atoll(timestamp)) {
+      continue;
+    }
+    providers->remove(host, removed[i].port);
+  }
+
+  provider_t provider;
+  for (int j = 0; j < added_num; j++) {
+    memset(&provider, 0, sizeof(provider_t));
+    init_provider_from_url(&provider, &added[j]);
+    provider_t* cached = providers->find(provider.host, provider.port);
+    if (cached != NULL && provider.timestamp <= cached->timestamp) {
+      free_provider_v2_ex(&provider);
+      continue;
+    }
+    provider.flag_invalid_timestamp = time_now;
+    providers->upsert(provider);
+  }
+  //与全量更新相同，provider列表变化时重置容错标记，
+  //重新注册但时间戳未变化的provider也不会一直处于容错状态
+  for (int i = 0; i < providers->size(); i++) {
+    providers->at(i).flag_call_failover = 0;
+  }
+  rrLB->reset_cursor(service_name);
+  wrrLB->reset_cursor(service_name);
+}
+
+//消费者 providers目录增量订阅函数，只处理上线与下线的provider
+void consumer_providers_delta_callback(url_t* added, int added_num,
+                                       url_t* removed, int removed_num) {
+  if (added_num <= 0 && removed_num <= 0) {
+    return;
+  }
+  url_t* any = added_num > 0 ? &added[0] : &removed[0];
+  char* service_name =
+      url_get_parameter_v2(any, ORIENTSEC_GRPC_REGISTRY_KEY_INTERFACE, NULL);
+  if (service_name == NULL) {
+    return;
+  }
+  GRPC_PROVIDERS_LIST_LOCK_START
+  update_providers_delta_locked(service_name, added, added_num, removed,
+                                removed_num);
+  revoker_providers_list_process_locked(service_name);
+  publish_providers_snapshot_locked(service_name);
+  GRPC_PROVIDERS_LIST_LOCK_END
+
+  // zookeeper provider list changed
+  governance_changed(service_name);
+  g_registry_snapshots.update_delta(REGISTRY_SNAPSHOT_PROVIDERS, added,
+                                    added_num, removed, removed_num);
 }
 
 bool route_comp(router* a, router* b) {
@@ -485,17 +649,22 @@ void consumer_routers_callback(url_t* urls, int url_num) {
   //应该先用临时变量记录改服务对应的provider，并把临时变量的结果和g_valid_provider比对。
   //当黑白名单有变化时，需要重置provider列表中的标志位
   GRPC_PROVIDERS_LIST_LOCK_START
-  std::map<std::string, provider_t*>::iterator provider_lst_iter =
+  std::map<std::string, provider_list*>::iterator provider_lst_iter =
       g_cache_providers.find(urls[0].path);
   if (provider_lst_iter != g_cache_providers.end()) {
-    for (size_t i = 0; i < orientsec_grpc_cache_provider_count_get(); i++) {
-      ORIENTSEC_GRPC_SET_BIT(provider_lst_iter->second[i].flag_in_blklist,
+    provider_list* providers = provider_lst_iter->second;
+    for (int i = 0; i < providers->size(); i++) {
+      ORIENTSEC_GRPC_SET_BIT(providers->at(i).flag_in_blklist,
                              ORIENTSEC_GRPC_PROVIDER_FLAG_IN_BLKLIST_NOT);
     }
   }
-  GRPC_PROVIDERS_LIST_LOCK_END
   //黑白名单有更新，更新provider列表,设置provider黑名单标记
-  revoker_providers_list_process(urls[0].path);
+  revoker_providers_list_process_locked(urls[0].path);
+  publish_providers_snapshot_locked(urls[0].path);
+  GRPC_PROVIDERS_LIST_LOCK_END
+  // 连接负载均衡模式下被禁用provider的subchannel需要重新resolve才能移除
+  governance_changed(urls[0].path);
+  g_registry_snapshots.update(REGISTRY_SNAPSHOT_ROUTERS, urls, url_num);
 }
 
 bool url_comp(url_t* a, url_t* b) {
@@ -510,8 +679,12 @@ bool url_comp(url_t* a, url_t* b) {
 
 //消费者 configurator订阅函数
 void consumer_configurators_callback(url_t* urls, int url_num) {
-  if (urls[0].protocol == NULL || 0 == url_num ||
-      0 == strcmp(urls[0].protocol, ORIENTSEC_GRPC_EMPTY_PROTOCOL)) {
+  if (urls[0].protocol == NULL || 0 == url_num) {
+    return;
+  }
+  // 配置全部删除时已生效的配置保持不变，快照中同样清除，恢复时不再应用
+  g_registry_snapshots.update(REGISTRY_SNAPSHOT_CONFIGURATORS, urls, url_num);
+  if (0 == strcmp(urls[0].protocol, ORIENTSEC_GRPC_EMPTY_PROTOCOL)) {
     return;
   }
   char* service_name = url_get_parameter_v2(
@@ -530,73 +703,79 @@ void consumer_configurators_callback(url_t* urls, int url_num) {
   // add method load balance
   char* lb_strategy = NULL;
   char* lb_algorithem = NULL;
+  // 主备、分组属性发生变化时需要重新resolve
+  bool need_resolve = false;
 
   GRPC_PROVIDERS_LIST_LOCK_START
 
-  std::map<std::string, provider_t*>::iterator provider_lst_iter =
+  std::map<std::string, provider_list*>::iterator provider_lst_iter =
       g_cache_providers.find(service_name);
   // updated weight of provider and deprecated property
   for (size_t i = 0; i < urlVec.size(); i++) {
     ip = urlVec[i]->host;
     if (provider_lst_iter != g_cache_providers.end()) {
-      for (size_t j = 0; j < orientsec_grpc_cache_provider_count_get(); j++) {
+      for (int j = 0; j < provider_lst_iter->second->size(); j++) {
         if ((0 == strcmp(ip, ORIENTSEC_GRPC_ANYHOST_VALUE)) ||
-            (0 == strcmp(ip, provider_lst_iter->second[j].host))) {
+            (0 == strcmp(ip, provider_lst_iter->second->at(j).host))) {
           param = url_get_parameter_v2(
               urlVec[i], ORIENTSEC_GRPC_REGISTRY_KEY_WEIGHT, NULL);
           if (param) {
             weight = atoi(param);
             if (weight > 0) {
-              provider_lst_iter->second[j].weight = weight;
+              provider_lst_iter->second->at(j).weight = weight;
             }
           }
           param = url_get_parameter_v2(
               urlVec[i], ORIENTSEC_GRPC_REGISTRY_KEY_DEPRECATED, NULL);
           if (param) {
             if (0 == strcmp(param, "true")) {
-              provider_lst_iter->second[j].deprecated = true;
+              provider_lst_iter->second->at(j).deprecated = true;
             } else {
-              provider_lst_iter->second[j].deprecated = false;
+              provider_lst_iter->second->at(j).deprecated = false;
             }
             consumer_check_provider_deprecated(
-                service_name, provider_lst_iter->second[j].deprecated);
+                service_name, provider_lst_iter->second->at(j).deprecated);
           }
           param = url_get_parameter_v2(
               urlVec[i], ORIENTSEC_GRPC_REGISTRY_KEY_MASTER, NULL);
           if (param) {
             if (0 == strcmp(param, "true")) {
-              provider_lst_iter->second[j].is_master = true;
+              provider_lst_iter->second->at(j).is_master = true;
               //当有主服务上线时，触发resolve
-              g_active_standby = true;
+              need_resolve = true;
               if (!g_exist_master) g_exist_master = true;
               gpr_log(GPR_DEBUG, "1provider:%s.is_master=%d",
-                      provider_lst_iter->second[j].host,
-                      provider_lst_iter->second[j].is_master);
+                      provider_lst_iter->second->at(j).host,
+                      provider_lst_iter->second->at(j).is_master);
             } else {
-              provider_lst_iter->second[j].is_master = false;
+              provider_lst_iter->second->at(j).is_master = false;
               // 当有备服务上线时，
               // 1. 有主服务时，不resolve 2. 无主服务时，重新resolve
-              g_active_standby = true;
+              need_resolve = true;
               gpr_log(GPR_DEBUG, "2provider:%s.is_master=%d",
-                      provider_lst_iter->second[j].host,
-                      provider_lst_iter->second[j].is_master);
+                      provider_lst_iter->second->at(j).host,
+                      provider_lst_iter->second->at(j).is_master);
             }
           }
           // 更新服务分组
           param = url_get_parameter_v2(urlVec[i],
                                        ORIENTSEC_GRPC_REGISTRY_KEY_GROUP, NULL);
           if (param) {
-            if (0 != strcmp(provider_lst_iter->second[j].group, param)){
+            if (0 != strcmp(provider_lst_iter->second->at(j).group, param)){
               // group 属性发生改变时，触发resolve
-              g_group_grading = true;
-              strcpy(provider_lst_iter->second[j].group, param);
+              need_resolve = true;
+              strcpy(provider_lst_iter->second->at(j).group, param);
             }
           }
         }
       }
     }
   }
+  publish_providers_snapshot_locked(service_name);
   GRPC_PROVIDERS_LIST_LOCK_END
+  if (need_resolve) {
+    governance_changed(service_name);
+  }
 
   //更新客户端负载均衡策略配置以及流量控制参数
   char* lb = NULL;
@@ -608,8 +787,15 @@ void consumer_configurators_callback(url_t* urls, int url_num) {
       // 动态更新客户端流量控制参数
       lb = url_get_parameter_v2(urlVec[i],
                                 ORIENTSEC_GRPC_CONSUMER_DEFAULT_REQUEST, NULL);
+      // 本机IP规则优先于0.0.0.0通用规则，与配置的先后顺序无关
       if (lb) {
-        orientsec_grpc_consumer_update_maxrequest(urlVec[i]->path, atol(lb));
+        g_request_controller_utils.SetMaxRequest(
+            urlVec[i]->path,
+            0 != strcmp(urlVec[i]->host, ORIENTSEC_GRPC_ANYHOST_VALUE),
+            atol(lb));
+        orientsec_grpc_consumer_update_maxrequest(
+            urlVec[i]->path,
+            g_request_controller_utils.GetMaxRequest(urlVec[i]->path));
       }
 
       // 动态更新客户端负载均衡策略
@@ -632,8 +818,8 @@ void consumer_configurators_callback(url_t* urls, int url_num) {
       // 监听到客户端的负载均衡模式配置发生变化
       // 基于方法级的lb 更新
       if (meth_lb && lb) {
-        // set method level flag
-        g_method_lb = true;
+        // 方法级负载均衡配置变化，重新resolve
+        governance_changed(urlVec[i]->path);
         // get lb mode and algorithem from url
         lb_strategy = url_get_parameter_v2(
             urlVec[i], ORIENTSEC_GRPC_REGISTRY_KEY_LB_MODE, NULL);
@@ -666,8 +852,15 @@ void consumer_configurators_callback(url_t* urls, int url_num) {
       char* intf = url_get_parameter_v2(
           urlVec[i], ORIENTSEC_GRPC_REGISTRY_KEY_INTERFACE, NULL);
       if (version && intf) {
-        // 更新全局的 g_consumer_service_version
+        // 更新全局的 g_consumer_service_version，版本影响可选provider集合
+        GRPC_PROVIDERS_LIST_LOCK_START
         orientsec_grpc_consumer_control_version_update(intf, version);
+        publish_providers_snapshot_locked(intf);
+        GRPC_PROVIDERS_LIST_LOCK_END
+        // 连接负载均衡模式下切换版本需要重新resolve
+        if (!is_request_loadbalance()) {
+          governance_changed(intf);
+        }
       }
       lb = NULL;
       version = NULL;
@@ -704,11 +897,14 @@ int get_index_from_lb_aglorithm(const char* service_name, provider_t* provider,
   // round_robin
   else if (0 == strcmp(stragry, ORIENTSEC_GRPC_LB_TYPE_RR)) {
     return rrLB->choose_subchannel(service_name, provider, nums);
+  }
+  // p2c_ewma
+  else if (0 == strcmp(stragry, ORIENTSEC_GRPC_LB_TYPE_P2C)) {
+    return p2cLB->choose_subchannel(service_name, provider, nums);
   } else {
-    // std::string arg("ip:port");
-    int select_idx =
-        chLB->choose_subchannel(service_name, provider, nums, hash_info);
-    return select_idx;
+    // 临时建环，快照中的可选集合直接用pick set的环
+    return chLB->choose_subchannel(service_name, provider, nums,
+                                   hash_info ? hash_info : "");
   }
   return 0;
 }
@@ -760,15 +956,19 @@ void get_all_providers_by_name(const char* service_name) {
   url_t* query_url = url_parse(query_str);
 
   url_t* provider_urls = lookup(query_url, &provider_nums);
+  GRPC_PROVIDERS_LIST_LOCK_START
   if (provider_urls) {
-    updateProvidersCache(service_name, provider_urls, provider_nums, 1);
+    update_providers_cache_locked(service_name, provider_urls, provider_nums,
+                                  1);
     for (size_t i = 0; i < provider_nums; i++) {
       url_free(provider_urls + i);
     }
     if (!provider_urls) free(provider_urls);
   }
+  revoker_providers_list_process_locked(service_name);
+  publish_providers_snapshot_locked(service_name);
+  GRPC_PROVIDERS_LIST_LOCK_END
   url_full_free(&query_url);
-  revoker_providers_list_process(service_name);
 }
 
 provider_t* consumer_query_providers_one(const char* service_name, int* nums) {
@@ -825,123 +1025,58 @@ provider_t* consumer_query_providers_one(const char* service_name, int* nums) {
   return providers;
 }
 
-// 在cc_start_transport_stream_op_batch中查看是否需要resolve
-bool orientsec_need_resolved() { return g_need_resolve; }
-
-void orientsec_need_resolved_reset() { g_need_resolve = false; }
-
-bool orientsec_group_grade_changed() { return g_group_grading; }
-
-void orientsec_group_grade_reset() { g_group_grading = false; }
-
-bool orientsec_active_standby_changed() { return g_active_standby; }
-
-void orientsec_active_standby_reset() { g_active_standby = false; }
-
-bool orientsec_method_lb_changed() { return g_method_lb; }
-
-void orientset_method_lb_reset() { g_method_lb = false; }
+// 复制快照中的可选provider，只复制负载均衡需要的字段，返回空间由调用方释放
+static provider_t* clone_pick_set_providers(const provider_pick_set* pick_set) {
+  int num = pick_set->size();
+  if (num == 0) {
+    return NULL;
+  }
+  const provider_t* picked = pick_set->providers();
+  provider_t* providers = (provider_t*)gpr_zalloc(sizeof(provider_t) * num);
+  for (int i = 0; i < num; i++) {
+    strcpy(providers[i].host, picked[i].host);
+    strcpy(providers[i].group, picked[i].group);
+    providers[i].port = picked[i].port;
+    providers[i].weight = picked[i].weight;
+  }
+  return providers;
+}
 
-// 判断provider是否提供此方法的调用
-static bool method_check(provider_t* provider, char* method_name,
-                         const int length) {
-  std::string methods = provider->methods;
-  // std::string methods("SayHello1,SayHello,SayBay,SayHello2");
-  std::vector<std::string> resultVec;
-  orientsec_grpc_split_to_vec(methods, resultVec, ",");
-  int nRet = std::count(resultVec.begin(), resultVec.end(), method_name);
-  if (nRet > 0) return true;
-  return false;
+static bool is_consistent_hash_stragry(const char* stragry) {
+  return 0 == strcmp(stragry, ORIENTSEC_GRPC_LB_TYPE_CH) ||
+         0 == strcmp(stragry, ORIENTSEC_GRPC_LB_TYPE_CHBL);
 }
 
-// 客户端需要分组调用时，根据规则调用优先级高的分组中的provider
-// 算法：对每个分组进行匹配，如果有provider，则返回对应的provider
-//       如果没有则循环到下一分组。
-static provider_t* orientsec_grpc_consumer_control_group_filter(
-    provider_t* providers, int *num) {
-  // 获取consumer group information
-  std::vector<std::string> group_info;
-  int grade_count = 0; // 统计各个分组里面的provider数量
-  provider_t* prov = NULL;  // 用于返回堆上的provider list
-  
-  std::vector<std::string> tmp;
-  std::vector<std::string> temp;
-
-  char* group_conf = orientsec_grpc_consumer_service_group_get();
-  if (group_conf == NULL || strlen(group_conf) == 0) {
-    return prov;
-  }
-  // 字符串分解成字符vector
-  orientsec_grpc_split_to_vec(std::string(group_conf), group_info, ";");
-  int grade = group_info.size();
-
-  for (int index = 0; index < grade; index++) {
-    std::string str= group_info[index];
-    orientsec_grpc_split_to_vec(str, tmp, ",");
-    grade_count = 0;
-    for (int in = 0; in < tmp.size(); in++) {
-      // 取高优先级的provider
-      for (int pro = 0; pro < *num; pro++) {
-        if (0 == strcmp(providers[pro].group,tmp[in].c_str()))
-          grade_count ++;
-      }
-    }
-    // 对每个分组的count进行处理
-    if (grade_count > 0) break;
-  }
-  // 如果找不到所有分组的provider，返回调用失败
-  if (0 == grade_count) {
-    *num = grade_count;
-    return prov;
-  }
-
-  // 取出对应分组的provider
-  prov= (provider_t*)gpr_zalloc(sizeof(provider_t) * grade_count);
-  int j = 0;
-  for (int index = 0; index < grade; index++) {
-    std::string str = group_info[index];
-    orientsec_grpc_split_to_vec(str, temp, ",");
-    grade_count = 0;
-    for (int in = 0; in < temp.size(); in++) {
-      // 取高优先级的provider
-      for (int pro = 0; pro < *num; pro++) {
-        if (0 == strcmp(providers[pro].group, temp[in].c_str())){
-          grade_count++;
-          strcpy(prov[j].host, providers[pro].host);
-          prov[j].port = providers[pro].port;
-          prov[j].weight = providers[pro].weight;
-          prov[j].curr_weight = providers[pro].curr_weight;
-          j++;
-        }
-      }
-    }
-    // 对每个分组的count进行处理
-    if (grade_count > 0) break;
-  }
-  gpr_free(providers);
-  *num = grade_count;
-  return prov;
+// 在可选集合自带的环上选取，bounded模式下按在途请求数跳过满载的provider
+static int choose_consistent_hash_index(const provider_pick_set* pick_set,
+                                        const char* stragry,
+                                        const char* service_name,
+                                        const char* hash_arg) {
+  if (0 == strcmp(stragry, ORIENTSEC_GRPC_LB_TYPE_CHBL)) {
+    return conistent_hash_lb::choose_subchannel_bounded(
+        pick_set->hash_ring(), service_name, hash_arg, pick_set->loads(),
+        g_ch_load_factor);
+  }
+  return conistent_hash_lb::choose_subchannel(pick_set->hash_ring(),
+                                              service_name, hash_arg);
 }
 
 // query valid provider and write ip:port information into policy for
 // transferring
 // adding method input for lb based method
-provider_t* consumer_query_providers_write_point_policy(
+// 可选provider集合在快照发布时已算好，这里不加锁、不分配内存
+int consumer_pick_provider_write_point_policy(
     const char* service_name, grpc_core::LoadBalancingPolicy* lb_policy,
-    int* nums, char* method_name) {
-  char query_str[ORIENTSEC_GRPC_PATH_MAX_LEN] = {0};
-  // change function to local variable
-  int cache_providers_num = orientsec_grpc_cache_provider_count_get();
-  size_t i = 0;
+    char* method_name) {
+  // 没有选中provider时不保留上一次调用的选择
+  lb_policy->provider_load = NULL;
+  lb_policy->provider_addr[0] = '\0';
   if (!service_name) {
-    return NULL;
+    return 0;
   }
   if (!method_name) {
-    return NULL;
+    return 0;
   }
-  int provider_nums = 0;
-  provider_t* providers = NULL;
-  //provider_t* providers_trans = NULL;
 
   // 计算负载均衡算法
   std::string strLbStragry = ORIENTSEC_GRPC_DEFAULT_LB_TYPE;
@@ -956,113 +1091,46 @@ provider_t* consumer_query_providers_write_point_policy(
     is_method_level = true;
   }
 
-  // 是否开启服务分组
-  bool is_group = is_group_grading();
-  // providers 每次申请再释放，未和全局provider效率作比较，
-  // 有待试验
-
-  GRPC_PROVIDERS_LIST_LOCK_START
-  //原始代码代码，返回所有providers，未应用负载均衡策略
-  std::map<std::string, provider_t*>::iterator provider_lst_iter =
-      g_cache_providers.find(service_name);
-  if (provider_lst_iter != g_cache_providers.end()) {
-    //首先统计合法的provider个数
-    for (i = 0; i < cache_providers_num; i++) {
-      provider_t* provider = &provider_lst_iter->second[i];
-      if (!ORIENTSEC_GRPC_CHECK_BIT(provider->flag_in_blklist,
-                                    ORIENTSEC_GRPC_PROVIDER_FLAG_IN_BLKLIST) &&
-          provider->flag_invalid == 0 && provider->flag_call_failover == 0 &&
-          provider->online) {
-        if (!is_method_level) {
-          if (orientsec_grpc_consumer_control_version_match(
-                  service_name, provider->version) == true)
-            provider_nums++;
-        } else {
-          if (method_check(provider, method_name, cache_providers_num)) {
-            if (orientsec_grpc_consumer_control_version_match(
-                    service_name, provider->version) == true)
-              provider_nums++;
-          }
-        }
-      }
-    }
-    if (provider_nums != 0) {
-      providers = (provider_t*)gpr_zalloc(sizeof(provider_t) * provider_nums);
-      int j = 0;
-      for (int i = 0; i < cache_providers_num; i++) {
-        provider_t* provider = &provider_lst_iter->second[i];
-        //有效且未在黑名单内的数据。
-        if (!ORIENTSEC_GRPC_CHECK_BIT(
-                provider->flag_in_blklist,
-                ORIENTSEC_GRPC_PROVIDER_FLAG_IN_BLKLIST) &&
-            provider->flag_invalid == 0 && provider->flag_call_failover == 0 &&
-            provider->online) {
-          // 服务版本check
-          if (!is_method_level) {
-            if (orientsec_grpc_consumer_control_version_match(
-                    service_name, provider->version) == true) {
-              strcpy(providers[j].host, provider->host);
-              strcpy(providers[j].group, provider->group);
-              providers[j].port = provider->port;
-              providers[j].weight = provider->weight;
-              providers[j].curr_weight = provider->curr_weight;
-              j++;
-            }
-          } else {
-            if (method_check(provider, method_name, cache_providers_num)) {
-              if (orientsec_grpc_consumer_control_version_match(
-                      service_name, provider->version) == true) {
-                strcpy(providers[j].host, provider->host);
-                strcpy(providers[j].group, provider->group);
-                providers[j].port = provider->port;
-                providers[j].weight = provider->weight;
-                providers[j].curr_weight = provider->curr_weight;
-                j++;
-              }
-            }
-          }
-        }
-      }
-      *nums = provider_nums;
-    }
-  }
+  provider_snapshot_guard guard(g_provider_snapshots);
+  const provider_snapshot* snapshot = guard.get(service_name);
+  const provider_pick_set* pick_set =
+      snapshot == NULL
+          ? NULL
+          : snapshot->pick_set(is_method_level ? method_name : NULL, true);
+  int provider_nums = pick_set == NULL ? 0 : pick_set->size();
 
   // no appriate provide
   if (provider_nums == 0) {
-    printf("-----------------provider_nums=%d  !!!\n", provider_nums);
-    *nums = provider_nums;
-    // memset(lb_policy->provider_addr,0,sizeof(lb_policy->provider_addr));
-    // sprintf(lb_policy->provider_addr, "%s:%s","2.2.2.2","2222");
-    GRPC_PROVIDERS_LIST_LOCK_END
-    return providers;
-  } else {
-    // 进行服务分组的校验
-    if (is_group) {
-      providers = orientsec_grpc_consumer_control_group_filter(
-          providers, &provider_nums);
-      *nums = provider_nums;
-    }
+    gpr_log(GPR_DEBUG, "no provider available for service %s", service_name);
+    return provider_nums;
   }
-  //printf("REQ valid provider_num = %d\n", provider_nums);
   // add by yang
+  provider_t* providers = pick_set->providers();
   char* hash_info = lb_policy->hash_lb;
-  int index = get_index_from_lb_aglorithm(
-      service_name, providers, nums, hash_info,
-                                  strLbStragry.c_str());  // provider为一个列表
-  sprintf(lb_policy->provider_addr, "ipv4:%s:%d", providers[index].host,
-          providers[index].port);
-  // addbylm
-  for (int i = 0, j = 0; i < cache_providers_num; i++) {
-    if (!strcmp(providers[j].host, provider_lst_iter->second[i].host) &&
-        providers[j].port == provider_lst_iter->second[i].port) {
-      provider_lst_iter->second[i].curr_weight = providers[j].curr_weight;
-      j++;
-      if (j > *nums - 1) break;
-    }
+  int index = 0;
+  if (0 == strcmp(strLbStragry.c_str(), ORIENTSEC_GRPC_LB_TYPE_WRR)) {
+    index = pick_set->wrr()->pick();
+  } else if (is_consistent_hash_stragry(strLbStragry.c_str())) {
+    index = choose_consistent_hash_index(pick_set, strLbStragry.c_str(),
+                                         service_name, hash_info);
+  } else if (0 == strcmp(strLbStragry.c_str(), ORIENTSEC_GRPC_LB_TYPE_P2C)) {
+    index = p2c_ewma_lb::choose_subchannel(pick_set->loads(), provider_nums);
+  } else {
+    index = get_index_from_lb_aglorithm(service_name, providers,
+                                        &provider_nums, hash_info,
+                                        strLbStragry.c_str());
+  }
+  // 与grpc的地址uri格式一致，ipv6地址加方括号
+  if (strchr(providers[index].host, ':') != NULL) {
+    snprintf(lb_policy->provider_addr, sizeof(lb_policy->provider_addr),
+             "ipv6:[%s]:%d", providers[index].host, providers[index].port);
+  } else {
+    snprintf(lb_policy->provider_addr, sizeof(lb_policy->provider_addr),
+             "ipv4:%s:%d", providers[index].host, providers[index].port);
   }
-  GRPC_PROVIDERS_LIST_LOCK_END
-  *nums = provider_nums;
-  return providers;
+  // 负载统计同时是provider的标识，round robin按它直接定位subchannel
+  lb_policy->provider_load = pick_set->loads()[index];
+  return provider_nums;
 }
 
 // put the provider selected by hash into first location
@@ -1089,14 +1157,15 @@ provider_t* consumer_query_providers(const char* service_name, int* nums,
   size_t i = 0;
   size_t ind = 0;
   int standby_count = 0;
-  int j = 0;
   if (!service_name) {
     return NULL;
   }
   if (!method_name) return NULL;
   bool is_req = is_request_loadbalance();
-  int cache_providers_num = orientsec_grpc_cache_provider_count_get();
+  int cache_providers_num = 0;
   int provider_nums = 0;
+  int hash_index = 0;  // consistent hash选中的provider
+  int conn_index = 0;  // 连接负载均衡时在可选集合上选中的provider(wrr、p2c)
   provider_t* providers = NULL;
   //provider_t* providers_trans = NULL;
 
@@ -1123,18 +1192,16 @@ provider_t* consumer_query_providers(const char* service_name, int* nums,
     is_method_level = true;
   }
 
-  // 是否开启服务分组
-  bool is_group = is_group_grading();
-
   GRPC_PROVIDERS_LIST_LOCK_START
   //*nums = 0;
   //原始代码实现，返回所有providers，未应用负载均衡策略
-  std::map<std::string, provider_t*>::iterator provider_lst_iter =
+  std::map<std::string, provider_list*>::iterator provider_lst_iter =
       g_cache_providers.find(service_name);
   if (provider_lst_iter != g_cache_providers.end()) {
+    cache_providers_num = provider_lst_iter->second->size();
     // 判断是否存在master server
     for (ind = 0; ind < cache_providers_num; ind++) {
-      provider_t* provider = &provider_lst_iter->second[ind];
+      provider_t* provider = &provider_lst_iter->second->at(ind);
       // 备服务或者 下线的主服务
       if ((!provider->is_master)||(provider->is_master&&provider->flag_invalid)) {
         standby_count++;
@@ -1142,14 +1209,15 @@ provider_t* consumer_query_providers(const char* service_name, int* nums,
     }
     if (standby_count == cache_providers_num) {
       g_exist_master = false;
-      // g_active_standby = true;
     } else {
       g_exist_master = true;
     }
 
     // 标记provider 是否提供服务，根据active/standby 状态
+    bool online_changed = false;
     for (ind = 0; ind < cache_providers_num; ind++) {
-      provider_t* provider = &provider_lst_iter->second[ind];
+      provider_t* provider = &provider_lst_iter->second->at(ind);
+      bool online = provider->online;
       // 如果存在active provider，标记standby provider不可用
       if (g_exist_master) {
         if (!provider->is_master) {
@@ -1161,124 +1229,53 @@ provider_t* consumer_query_providers(const char* service_name, int* nums,
       } else {
         provider->online = 1;
       }
-
+      if (online != provider->online) {
+        online_changed = true;
+      }
+    }
+    if (online_changed) {
+      publish_providers_snapshot_locked(service_name);
     }
 
-    //首先统计合法的provider个数
-    for (i = 0; i < cache_providers_num; i++) {
-      provider_t* provider = &provider_lst_iter->second[i];
-      if (!ORIENTSEC_GRPC_CHECK_BIT(provider->flag_in_blklist,
-                                    ORIENTSEC_GRPC_PROVIDER_FLAG_IN_BLKLIST) &&
-          provider->flag_invalid == 0 && provider->flag_call_failover == 0 &&
-          provider->online) {
-        if (!is_method_level) {
-          // 请求负载均衡情况下，加上版本校验，切换版本时无 subchannel可连接，
-          // 这里获得的provider ip:port 和 num
-          // 将用于创建连接各个服务的subchannel service version check
-          if (!is_req) {  // connection mode
-            if (orientsec_grpc_consumer_control_version_match(
-                    service_name, provider->version) == true)
-              provider_nums++;
-          } else {
-            provider_nums++;
-          }
-        } else {  // 方法级别的判断
-          if (method_check(provider, method_name, cache_providers_num)) {
-            if (!is_req) {  // connection mode
-              if (orientsec_grpc_consumer_control_version_match(
-                      service_name, provider->version) == true) {
-                provider_nums++;
-              }
-            } else {
-              provider_nums++;
-            }
-          }
-        }
+    // 请求负载均衡时建立到所有版本provider的subchannel，选取时再做版本校验
+    provider_snapshot_guard guard(g_provider_snapshots);
+    const provider_snapshot* snapshot = guard.get(service_name);
+    if (snapshot != NULL) {
+      const provider_pick_set* pick_set =
+          snapshot->pick_set(is_method_level ? method_name : NULL, !is_req);
+      providers = clone_pick_set_providers(pick_set);
+      provider_nums = pick_set->size();
+      *nums = provider_nums;
+      // request模式只看服务级算法，与下面的处理一致
+      std::string ch_stragry = strLbStragry;
+      if (is_req && lbIter != g_consumer_lbstragry.end()) {
+        ch_stragry = lbIter->second;
       }
-    }
-    if (provider_nums != 0) {
-      providers = (provider_t*)gpr_zalloc(sizeof(provider_t) * provider_nums);
-
-      for (int k = 0; k < cache_providers_num; k++) {
-        provider_t* provider = &provider_lst_iter->second[k];
-
-        //有效且未在黑名单内的数据。
-        if (!ORIENTSEC_GRPC_CHECK_BIT(
-                provider->flag_in_blklist,
-                ORIENTSEC_GRPC_PROVIDER_FLAG_IN_BLKLIST) &&
-            provider->flag_invalid == 0 && provider->flag_call_failover == 0 &&
-            provider->online) {
-          if (!is_method_level) {
-            if (!is_req) {  // connection mode
-                            // service version check
-              if (orientsec_grpc_consumer_control_version_match(
-                      service_name, provider->version) == true) {
-                strcpy(providers[j].host, provider->host);
-                strcpy(providers[j].group, provider->group);
-                providers[j].port = provider->port;
-                providers[j].weight = provider->weight;
-                providers[j].curr_weight = provider->curr_weight;
-                j++;
-              }
-            } else {
-              strcpy(providers[j].host, provider->host);
-              strcpy(providers[j].group, provider->group);
-              providers[j].port = provider->port;
-              providers[j].weight = provider->weight;
-              providers[j].curr_weight = provider->curr_weight;
-              j++;
-            }       // end of is_req
-          } else {  //方法级别的判断
-            if (method_check(provider, method_name, cache_providers_num)) {
-              if (!is_req) {  // connection mode
-                              // service version check
-                if (orientsec_grpc_consumer_control_version_match(
-                        service_name, provider->version) == true) {
-                  strcpy(providers[j].host, provider->host);
-                  strcpy(providers[j].group, provider->group);
-                  providers[j].port = provider->port;
-                  providers[j].weight = provider->weight;
-                  providers[j].curr_weight = provider->curr_weight;
-                  j++;
-                }
-              } else {
-                strcpy(providers[j].host, provider->host);
-                strcpy(providers[j].group, provider->group);
-                providers[j].port = provider->port;
-                providers[j].weight = provider->weight;
-                providers[j].curr_weight = provider->curr_weight;
-                j++;
-              }  // end of is_req
-            }
-          }
+      if (provider_nums > 1 && is_consistent_hash_stragry(ch_stragry.c_str())) {
+        hash_index = choose_consistent_hash_index(
+            pick_set, ch_stragry.c_str(), service_name, hasharg);
+      }
+      if (!is_req && provider_nums > 1) {
+        if (0 == strcmp(strLbStragry.c_str(), ORIENTSEC_GRPC_LB_TYPE_P2C)) {
+          conn_index =
+              p2c_ewma_lb::choose_subchannel(pick_set->loads(), provider_nums);
+        } else if (0 == strcmp(strLbStragry.c_str(),
+                               ORIENTSEC_GRPC_LB_TYPE_WRR)) {
+          conn_index = pick_set->wrr()->pick();
         }
-      }  // end of for
-      *nums = provider_nums;
+      }
     }
   }
 
+  // 服务分组已在可选集合中处理
   if (provider_nums == 0) {
-    printf("--------------query provider_nums=%d  !!!\n", provider_nums);
+    gpr_log(GPR_DEBUG, "query providers of service %s, provider_nums=0",
+            service_name);
     *nums = provider_nums;
     GRPC_PROVIDERS_LIST_LOCK_END
     return providers;
-  } else {
-    // 进行服务分组的校验
-    if (is_group) {
-      providers = orientsec_grpc_consumer_control_group_filter(
-          providers, &provider_nums);
-      // 重新赋值nums
-      *nums = provider_nums;
-    }
   }
-
-  // 服务分组后再检查provider number
-  if (provider_nums == 0) {
-    printf("after grouping query provider_nums=%d  !!!\n", provider_nums);
-    GRPC_PROVIDERS_LIST_LOCK_END
-    return providers;
-  } 
-  printf("Resolved valid provider_num = %d\n", provider_nums);
+  gpr_log(GPR_DEBUG, "Resolved valid provider_num = %d", provider_nums);
 
   if (is_req) {  // request 情况下
     // 如果0或1个provider, 不考虑算法
@@ -1287,19 +1284,13 @@ provider_t* consumer_query_providers(const char* service_name, int* nums,
       std::map<std::string, std::string>::iterator lbIter =
           g_consumer_lbstragry.find(service_name);
 
-      int prov_index = 0;
       if (lbIter != g_consumer_lbstragry.end()) {
         strLbStragry = lbIter->second;
       }
       //第一次如果是hash，就走一次算法，将hash算法选出来的provider放在第一个
-      if (0 == strcmp(strLbStragry.c_str(), ORIENTSEC_GRPC_LB_TYPE_CH)) {
-        //进入相应的负载均衡算法中进行计算
-        // std::string hash_arg;
-        prov_index =
-            chLB->choose_subchannel(service_name, providers, nums, hasharg);
-        // 假设provider index 已经选出
-        if (prov_index != 0)
-          providers = sort_hash_to_first(providers, provider_nums, prov_index);
+      if (is_consistent_hash_stragry(strLbStragry.c_str())) {
+        if (hash_index != 0)
+          providers = sort_hash_to_first(providers, provider_nums, hash_index);
       }
     }
     GRPC_PROVIDERS_LIST_LOCK_END
@@ -1308,17 +1299,17 @@ provider_t* consumer_query_providers(const char* service_name, int* nums,
   } else {  // for connection mode
     // 过滤掉服务版本校验失败的provider
 
-    int index = get_index_from_lb_aglorithm(
-        service_name, providers, nums, hasharg,
-        strLbStragry.c_str());  // provider为一个列表
-    // addbylm
-    for (i = 0, j = 0; i < cache_providers_num; i++) {
-      if (!strcmp(providers[j].host, provider_lst_iter->second[i].host) &&
-          providers[j].port == provider_lst_iter->second[i].port) {
-        provider_lst_iter->second[i].curr_weight = providers[j].curr_weight;
-        j++;
-        if (j > *nums - 1) break;
-      }
+    int index = 0;
+    if (is_consistent_hash_stragry(strLbStragry.c_str())) {
+      index = hash_index;
+    } else if (0 == strcmp(strLbStragry.c_str(), ORIENTSEC_GRPC_LB_TYPE_P2C) ||
+               0 == strcmp(strLbStragry.c_str(), ORIENTSEC_GRPC_LB_TYPE_WRR)) {
+      // 加权轮询的位置保存在快照的调度表中，不再回写provider列表
+      index = conn_index;
+    } else {
+      index = get_index_from_lb_aglorithm(
+          service_name, providers, nums, hasharg,
+          strLbStragry.c_str());  // provider为一个列表
     }
     if (*nums == 1) {
       GRPC_PROVIDERS_LIST_LOCK_END
@@ -1343,11 +1334,59 @@ provider_t* consumer_query_providers_all(const char* service_name, int* nums) {
   return NULL;
 }
 
+// 解析快照中的url串并交给订阅函数，与收到注册中心通知的处理相同
+static void replay_registry_snapshot(const std::vector<std::string>& strs,
+                                     registry_notify_f notify) {
+  if (strs.empty()) {
+    return;
+  }
+  url_t* urls = (url_t*)gpr_zalloc(strs.size() * sizeof(url_t));
+  int url_num = 0;
+  for (size_t i = 0; i < strs.size(); i++) {
+    url_init(&urls[url_num]);
+    if (0 == url_parse_v2((char*)strs[i].c_str(), &urls[url_num]) &&
+        urls[url_num].protocol != NULL && urls[url_num].host != NULL) {
+      url_num++;
+    } else {
+      url_free(&urls[url_num]);
+    }
+  }
+  if (url_num > 0) {
+    notify(urls, url_num);
+  }
+  for (int i = 0; i < url_num; i++) {
+    url_free(&urls[i]);
+  }
+  gpr_free(urls);
+}
+
+// 订阅前从本地快照恢复服务的providers、routers、configurators，
+// 订阅收到的全量列表随后替换恢复的内容；注册中心不可用时继续使用快照
+static void restore_registry_snapshot(const char* service_name) {
+  std::vector<std::string> urls[REGISTRY_SNAPSHOT_CATEGORY_NUM];
+  if (!g_registry_snapshots.load(service_name, urls)) {
+    return;
+  }
+  gpr_log(GPR_INFO,
+          "restore %s from registry snapshot: %d providers, %d routers, "
+          "%d configurators",
+          service_name, (int)urls[REGISTRY_SNAPSHOT_PROVIDERS].size(),
+          (int)urls[REGISTRY_SNAPSHOT_ROUTERS].size(),
+          (int)urls[REGISTRY_SNAPSHOT_CONFIGURATORS].size());
+  replay_registry_snapshot(urls[REGISTRY_SNAPSHOT_PROVIDERS],
+                           consumer_providers_callback);
+  replay_registry_snapshot(urls[REGISTRY_SNAPSHOT_ROUTERS],
+                           consumer_routers_callback);
+  replay_registry_snapshot(urls[REGISTRY_SNAPSHOT_CONFIGURATORS],
+                           consumer_configurators_callback);
+}
+
 // consumer注册。
 // 1、解析fullmethod 获取conf文件配置信息、拼接consumer
 // url串，调用接口写入向zk写入url串、
 // 记录已经注册的url串，以便consumer停止时调用zk接口注销url串。
-// 2、注册监听器
+// 2、从本地快照恢复上次的providers、routers、configurators
+// 3、注册监听器
 //  a.消费者订阅providers目录
 //  b.消费者订阅routers目录
 //  c.消费者订阅configurators目录
@@ -1400,10 +1439,13 @@ char* orientsec_grpc_consumer_register(const char* fullmethod) {
     // g_method_lbalgorithem.insert(std::pair<std::string,
     // std::string>("CreateBook", ORIENTSEC_GRPC_LB_TYPE_PF));
   }
+  restore_registry_snapshot(url->path);
+
   //消费者订阅providers目录
   url_update_parameter(url, (char*)ORIENTSEC_GRPC_CATEGORY_KEY,
                        (char*)ORIENTSEC_GRPC_PROVIDERS_CATEGORY);
-  subscribe(url, consumer_providers_callback);
+  subscribe_delta(url, consumer_providers_callback,
+                  consumer_providers_delta_callback);
 
   //消费者订阅routers目录
   url_update_parameter(url, (char*)ORIENTSEC_GRPC_CATEGORY_KEY,
@@ -1471,9 +1513,22 @@ int orientsec_grpc_consumer_unregister(char* reginfo) {
       return 0;
 }
 
-void record_provider_failure(char* clientId, char* providerId,char* methods) {
+void* consumer_failover_create(const char* clientId) {
+  if (!clientId) {
+    return NULL;
+  }
+  return new failover_consumer(clientId);
+}
+
+void consumer_failover_destroy(void* failover) {
+  delete (failover_consumer*)failover;
+}
+
+void record_provider_failure(void* failover, void* provider, char* providerId,
+                             char* methods) {
   g_failover_utils.record_provider_failure(
-      clientId, providerId,methods);  //使用实例对象调用静态方法
+      (failover_consumer*)failover, provider, providerId,
+      methods);  //使用实例对象调用静态方法
 }
 
 int get_max_backoff_time() {
@@ -1486,33 +1541,41 @@ int get_max_backoff_time() {
 
 // provider active/standby check
 int provider_num_active_check(char* service_name) {
-  int count = 0;
-  std::map<std::string, provider_t*>::iterator provider_lst_iter =
-      g_cache_providers.find(service_name);
-  if (provider_lst_iter != g_cache_providers.end()) {
-    //首先统计合法的provider个数
-    for (int i = 0; i < orientsec_grpc_cache_provider_count_get(); i++) {
-      provider_t* provider = &provider_lst_iter->second[i];
-      if (!ORIENTSEC_GRPC_CHECK_BIT(provider->flag_in_blklist,
-                                    ORIENTSEC_GRPC_PROVIDER_FLAG_IN_BLKLIST) &&
-          provider->flag_invalid == 0 && provider->flag_call_failover == 0) {
-        // active/standby check
-        if (provider->is_master) count++;
-      }
-    }
-  }
-  return count;
+  provider_snapshot_guard guard(g_provider_snapshots);
+  const provider_snapshot* snapshot = guard.get(service_name);
+  return snapshot == NULL ? 0 : snapshot->active_count();
 }
 
 // provider online property reset
 // call when no active provider
+// 每次调用都会检查，只有online属性确实变化时才加锁并发布快照
 void provider_active_standby_setting(char* service_name, bool have_active) {
-  std::map<std::string, provider_t*>::iterator provider_lst_iter =
+  bool need_update = false;
+  {
+    provider_snapshot_guard guard(g_provider_snapshots);
+    const provider_snapshot* snapshot = guard.get(service_name);
+    if (snapshot == NULL) {
+      return;
+    }
+    const provider_t* providers = snapshot->providers();
+    for (int i = 0; i < snapshot->size(); i++) {
+      bool online = providers[i].is_master ? have_active : !have_active;
+      if (online != providers[i].online) {
+        need_update = true;
+        break;
+      }
+    }
+  }
+  if (!need_update) {
+    return;
+  }
+  GRPC_PROVIDERS_LIST_LOCK_START
+  std::map<std::string, provider_list*>::iterator provider_lst_iter =
       g_cache_providers.find(service_name);
   if (provider_lst_iter != g_cache_providers.end()) {
     // traverse global provider list
-    for (int i = 0; i < orientsec_grpc_cache_provider_count_get(); i++) {
-      provider_t* provider = &provider_lst_iter->second[i];
+    for (int i = 0; i < provider_lst_iter->second->size(); i++) {
+      provider_t* provider = &provider_lst_iter->second->at(i);
       if (provider->is_master) {
         provider->online = (have_active ? 1 : 0);
       } else {
@@ -1521,103 +1584,59 @@ void provider_active_standby_setting(char* service_name, bool have_active) {
       }
 
     }
+    publish_providers_snapshot_locked(service_name);
   }
-  return;
+  GRPC_PROVIDERS_LIST_LOCK_END
 }
 
 // service version check
 int provider_num_after_service_check(char* service_name) {
-  int count = 0;
-  std::map<std::string, provider_t*>::iterator provider_lst_iter =
-      g_cache_providers.find(service_name);
-  if (provider_lst_iter != g_cache_providers.end()) {
-    //首先统计合法的provider个数
-    for (int i = 0; i < orientsec_grpc_cache_provider_count_get(); i++) {
-      provider_t* provider = &provider_lst_iter->second[i];
-      if (!ORIENTSEC_GRPC_CHECK_BIT(provider->flag_in_blklist,
-                                    ORIENTSEC_GRPC_PROVIDER_FLAG_IN_BLKLIST) &&
-          provider->flag_invalid == 0 && provider->flag_call_failover == 0) {
-        // service version check
-        if (orientsec_grpc_consumer_control_version_match(
-                service_name, provider->version) == true)
-          count++;
-      }
-    }
-  }
-  return count;
+  provider_snapshot_guard guard(g_provider_snapshots);
+  const provider_snapshot* snapshot = guard.get(service_name);
+  return snapshot == NULL ? 0 : snapshot->version_matched_count();
 }
 
 //获取经过黑白名单处理之后用于负载均衡的provider数量
 int get_consumer_lb_providers_acount(char* service_name) {
-  int count = 0;
-  std::map<std::string, provider_t*>::iterator providerMapIter =
-      g_cache_providers.find(service_name);
-  if (providerMapIter != g_cache_providers.end()) {
-    for (size_t i = 0; i < orientsec_grpc_cache_provider_count_get(); i++) {
-      if (!is_provider_invalid(&providerMapIter->second[i])) {
-        count++;
-      }
-    }
+  provider_snapshot_guard guard(g_provider_snapshots);
+  const provider_snapshot* snapshot = guard.get(service_name);
+  return snapshot == NULL ? 0 : snapshot->callable_count();
+}
+
+// 一次读取快照中的全部治理状态
+void consumer_governance_state_get(const char* service_name,
+                                   orientsec_grpc_governance_state* state) {
+  memset(state, 0, sizeof(orientsec_grpc_governance_state));
+  provider_snapshot_guard guard(g_provider_snapshots);
+  const provider_snapshot* snapshot = guard.get(service_name);
+  if (snapshot == NULL) {
+    return;
   }
-  return count;
+  state->providers = snapshot->size();
+  state->lb_providers = snapshot->callable_count();
+  state->version_matched = snapshot->version_matched_count();
+  state->active = snapshot->active_count();
 }
 
 //获取可以调用的provider数量，用于容错切换
 int get_valid_providers_acount(char* service_name, char* method_name) {
-  int provider_nums = 0;
-  int cache_providers_num = orientsec_grpc_cache_provider_count_get();
-  bool is_method_level = false;
-    // 计算负载均衡算法
-  std::string strLbStragry = ORIENTSEC_GRPC_DEFAULT_LB_TYPE;
-  auto meth_iter = g_method_lbalgorithem.find(method_name);
-  if (meth_iter != g_method_lbalgorithem.end()) {
-    strLbStragry = meth_iter->second;
-    is_method_level = true;
-  }
-
-  std::map<std::string, provider_t*>::iterator providerMapIter =
-      g_cache_providers.find(service_name);
-  if (providerMapIter != g_cache_providers.end()) {
-    //首先统计合法的provider个数
-    for (int i = 0; i < cache_providers_num; i++) {
-      provider_t* provider = &providerMapIter->second[i];
-      if (!ORIENTSEC_GRPC_CHECK_BIT(provider->flag_in_blklist,
-                                    ORIENTSEC_GRPC_PROVIDER_FLAG_IN_BLKLIST) &&
-          provider->flag_invalid == 0 && provider->flag_call_failover == 0 &&
-          provider->online) {
-        if (!is_method_level) {
-            if (orientsec_grpc_consumer_control_version_match(
-                    service_name, provider->version) == true)
-              provider_nums++;       
-        } else {  // 方法级别的判断
-          if (method_check(provider, method_name, cache_providers_num)) {
-
-              if (orientsec_grpc_consumer_control_version_match(
-                      service_name, provider->version) == true) {
-                provider_nums++;
-              }
-          }
-        }
-      }
-    }
+  bool is_method_level =
+      g_method_lbalgorithem.find(method_name) != g_method_lbalgorithem.end();
+  provider_snapshot_guard guard(g_provider_snapshots);
+  const provider_snapshot* snapshot = guard.get(service_name);
+  if (snapshot == NULL) {
+    return 0;
   }
-    return provider_nums;
+  return snapshot->pick_set(is_method_level ? method_name : NULL, true)
+      ->size();
 }
 
 //获取zk上某服务的provider数量
 int get_consumer_providers_acount(char* service_name) {
-  int count = 0;
-  std::map<std::string, provider_t*>::iterator providerMapIter =
-      g_cache_providers.find(service_name);
-  if (providerMapIter == g_cache_providers.end()) {
-    return 0;
-  }
-  for (int i = 0; i < orientsec_grpc_cache_provider_count_get(); i++) {
-    if (providerMapIter->second[i].flag_invalid == 0) {
-      count++;
-    }
-  }
-  return count;
+  provider_snapshot_guard guard(g_provider_snapshots);
+  const provider_snapshot* snapshot = guard.get(service_name);
+  // 快照中只保存有效(flag_invalid == 0)的provider
+  return snapshot == NULL ? 0 : snapshot->size();
 }
 
 //设置某个provider 调用失败标记,isSet == 1表示设置标记位，否则为清除标记位
@@ -1627,38 +1646,39 @@ void set_or_clr_provider_failover_flag_inner(char* service_name,
 
   bool is_req = is_request_loadbalance();
   std::string provider = providerId;
-  size_t pos = provider.find_first_of(':');
+  // 端口在最后一个:之后，ipv6地址形如[host]:port
+  size_t pos = provider.find_last_of(':');
   if (pos == std::string::npos) {
     gpr_log(GPR_ERROR,
             "invalid providerId,[%s],should split by : ", providerId);
     return;
   }
   std::string provider_host = provider.substr(0, pos);
+  if (provider_host.size() >= 2 && provider_host[0] == '[' &&
+      provider_host[provider_host.size() - 1] == ']') {
+    provider_host = provider_host.substr(1, provider_host.size() - 2);
+  }
   int provider_port = 0;
   provider_port = atoi(provider.substr(pos + 1).c_str());
 
   GRPC_PROVIDERS_LIST_LOCK_START
-  std::map<std::string, provider_t*>::iterator providerMapIter =
+  std::map<std::string, provider_list*>::iterator providerMapIter =
       g_cache_providers.find(service_name);
   if (providerMapIter != g_cache_providers.end()) {
-    for (size_t i = 0; i < orientsec_grpc_cache_provider_count_get(); i++) {
-      if (0 == strcmp(providerMapIter->second[i].host, provider_host.c_str()) &&
-          providerMapIter->second[i].port == provider_port &&
-          providerMapIter->second[i].flag_invalid == 0) {
-        if (isSet) {
-          ORIENTSEC_GRPC_SET_BIT(providerMapIter->second[i].flag_call_failover,
-                                 1);
-        } else {
-          ORIENTSEC_GRPC_SET_BIT(providerMapIter->second[i].flag_call_failover,
-                                 0);
-        }
-        break;
+    provider_t* cached =
+        providerMapIter->second->find(provider_host.c_str(), provider_port);
+    if (cached != NULL) {
+      if (isSet) {
+        ORIENTSEC_GRPC_SET_BIT(cached->flag_call_failover, 1);
+      } else {
+        ORIENTSEC_GRPC_SET_BIT(cached->flag_call_failover, 0);
       }
     }
   }
-  if (!is_req) //连接方式需要重新解析
-    g_need_resolve = true;
+  publish_providers_snapshot_locked(service_name);
   GRPC_PROVIDERS_LIST_LOCK_END
+  if (!is_req) //连接方式需要重新解析
+    governance_changed(service_name);
 }
 
 void set_provider_failover_flag(char* service_name, char* providerId) {
@@ -1675,18 +1695,108 @@ void set_consmuer_flow_control_threshold(char* service_name, long max_request) {
     return;
   }
   g_request_controller_utils.SetMaxRequestMap(service_name, max_request);
+  // 与配置回调相同，生效值交给调用路径上的令牌桶
+  orientsec_grpc_consumer_update_maxrequest(
+      service_name, g_request_controller_utils.GetMaxRequest(service_name));
 }
 
-bool check_consumer_flow_control(char* service_name) {
-  if (!service_name) {
-    return true;
+void* consumer_provider_load_find(const char* provider_addr) {
+  return provider_load_stats_find_addr(provider_addr);
+}
+
+void consumer_provider_load_call_started(void* load) {
+  if (load) {
+    static_cast<provider_load_stats*>(load)->call_started();
   }
-  return g_request_controller_utils.CheckRequest(service_name);
 }
 
-void decrease_consumer_request_count(char* service_name) {
-  if (!service_name) {
+// 对所有服务做一次离群检测，按已发布的快照读取provider及其负载统计，
+// 不持有provider锁。摘除状态按host:port在服务间共享，每个状态每周期只推进
+// 一次，检测完所有服务后重新发布摘除状态与当前不一致的快照
+static void outlier_detection_sweep(int64_t now_us) {
+  std::vector<std::string> stale;
+  std::vector<provider_outlier_state*> states;
+  std::vector<std::string> names;
+  std::vector<const char*> name_ptrs;
+  std::unordered_set<provider_outlier_state*> advanced;
+  char port_str[16];
+  {
+    provider_snapshot_guard guard(g_provider_snapshots);
+    const provider_snapshot_table& table = guard.table();
+    for (provider_snapshot_table::const_iterator iter = table.begin();
+         iter != table.end(); ++iter) {
+      const provider_snapshot* snapshot = iter->second.get();
+      for (int i = 0; i < snapshot->size(); i++) {
+        provider_load_stats* load = snapshot->loads()[i];
+        if (load == NULL || !advanced.insert(load->outlier()).second) {
+          continue;
+        }
+        const provider_t& p = snapshot->providers()[i];
+        snprintf(port_str, sizeof(port_str), ":%d", p.port);
+        outlier_detector::advance(g_outlier_config, load->outlier(),
+                                  (std::string(p.host) + port_str).c_str(),
+                                  now_us);
+      }
+    }
+    for (provider_snapshot_table::const_iterator iter = table.begin();
+         iter != table.end(); ++iter) {
+      const provider_snapshot* snapshot = iter->second.get();
+      if (snapshot->size() == 0) {
+        continue;
+      }
+      states.clear();
+      names.clear();
+      name_ptrs.clear();
+      for (int i = 0; i < snapshot->size(); i++) {
+        const provider_t& p = snapshot->providers()[i];
+        provider_load_stats* load = snapshot->loads()[i];
+        states.push_back(load ? load->outlier() : NULL);
+        snprintf(port_str, sizeof(port_str), ":%d", p.port);
+        names.push_back(std::string(p.host) + port_str);
+      }
+      for (size_t i = 0; i < names.size(); i++) {
+        name_ptrs.push_back(names[i].c_str());
+      }
+      outlier_detector::sweep(g_outlier_config, snapshot->service_name(),
+                              &states[0], &name_ptrs[0], states.size(),
+                              now_us);
+    }
+    for (provider_snapshot_table::const_iterator iter = table.begin();
+         iter != table.end(); ++iter) {
+      if (iter->second->ejection_changed(now_us)) {
+        stale.push_back(iter->first);
+      }
+    }
+  }
+  if (stale.empty()) {
+    return;
+  }
+  GRPC_PROVIDERS_LIST_LOCK_START
+  for (size_t i = 0; i < stale.size(); i++) {
+    publish_providers_snapshot_locked(stale[i].c_str());
+  }
+  GRPC_PROVIDERS_LIST_LOCK_END
+  if (!is_request_loadbalance()) {  //连接方式需要重新解析
+    for (size_t i = 0; i < stale.size(); i++) {
+      governance_changed(stale[i].c_str());
+    }
+  }
+}
+
+// 离群检测线程，每个统计周期检测一次，不占用调用线程
+static void outlier_detection_loop(void* arg) {
+  for (;;) {
+    gpr_sleep_until(gpr_time_add(
+        gpr_now(GPR_CLOCK_MONOTONIC),
+        gpr_time_from_micros(ORIENTSEC_GRPC_OUTLIER_BUCKET_US, GPR_TIMESPAN)));
+    outlier_detection_sweep(provider_load_now_us());
+  }
+}
+
+void consumer_provider_load_call_finished(void* load, int64_t latency_us,
+                                          int status) {
+  if (!load) {
     return;
   }
-  g_request_controller_utils.DecreaseRequest(service_name);
+  static_cast<provider_load_stats*>(load)->call_finished(latency_us, status);
 }
@@ -25,11 +25,20 @@
 #ifndef ORIENTSEC_CONSUMER_INTF_H
 #define ORIENTSEC_CONSUMER_INTF_H
 
+#include <grpc/support/atm.h>
 #include "orientsec_types.h"
 
 //addbylm
 #include "src/core/ext/filters/client_channel/lb_policy_registry.h"
 
+// 某服务的治理状态，取自provider快照，只在注册中心变化时重新统计
+typedef struct _orientsec_grpc_governance_state {
+  int providers;        // zk上有效的provider数量
+  int lb_providers;     // 黑白名单、容错处理之后用于负载均衡的数量
+  int version_matched;  // 服务版本校验之后的数量
+  int active;           // 主服务数量
+} orientsec_grpc_governance_state;
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -37,10 +46,10 @@ extern "C" {
 //手动根据服务名查询provider，更新缓存
 void get_all_providers_by_name(const char*service_name);
 
-//根据服务名查询provider，返回provider_t数组（只返回一个有效服务）//addbylm
-provider_t* consumer_query_providers_write_point_policy(
+//请求负载均衡时选取provider，ip:port写入policy，返回可选provider数量//addbylm
+int consumer_pick_provider_write_point_policy(
     const char* service_name, grpc_core::LoadBalancingPolicy* lb_policy,
-    int* nums, char* method_name);
+    char* method_name);
 //provider_t* consumer_query_providers_write_point_policy(
 //    const char* service_name, grpc_core::LoadBalancingPolicy* lb_policy,
 //    int* nums, const char* method);
@@ -64,8 +73,16 @@ int orientsec_grpc_consumer_unregister(char * reginfo);
 //com.orientsec.grpc.hello.greeter
 char* orientsec_grpc_get_sn_from_target(char* target);
 
-//标记clientId(注册时填写的信息)调用providerId(provider_ip:provider_port)失败信息
-void record_provider_failure(char* clientId, char* providerId,char* methods);
+//为channel创建容错记录，clientId为注册时填写的信息，只在创建时解析一次
+void* consumer_failover_create(const char* clientId);
+
+//channel销毁时释放容错记录
+void consumer_failover_destroy(void* failover);
+
+//标记failover所属的consumer调用providerId(provider_ip:provider_port)失败信息
+//provider为调用上的负载统计对象(provider标识)，可为空
+void record_provider_failure(void* failover, void* provider, char* providerId,
+                             char* methods);
 
 //获取backoff算法参数
 int get_max_backoff_time() ;
@@ -88,39 +105,34 @@ int get_valid_providers_acount(char* service_name, char* method_name);
 //获取zk上某服务的provider数量
 int get_consumer_providers_acount(char* service_name);
 
+//一次获取某服务的全部治理状态，不加锁、不分配内存
+void consumer_governance_state_get(const char* service_name,
+                                   orientsec_grpc_governance_state* state);
+
 //设置某个provider 调用失败标记
 void set_provider_failover_flag(char* service_name, char *providerId);
 
 //清除某个provider 调用失败标记
 void clr_provider_failover_flag(char* service_name, char *providerId);
 
-//设置服务在单位时间内被访问的次数
+//设置服务在单位时间内被访问的次数，由一元调用路径上的令牌桶限流
 void set_consmuer_flow_control_threshold(char *service_name, long max_request);
 
-//检查客户端对某个服务的单位时间内的请求计数，如果超过最大值则返回false,否则增加计数并返回true
-bool check_consumer_flow_control(char *service_name);
-
-//检查对某个服务的请求计数
-void decrease_consumer_request_count(char *service_name);
-
- // 判断是否发生方法级的负载均衡改变
-bool orientsec_method_lb_changed();
-// reset method lb flag
-void orientset_method_lb_reset();
-// 判断是否主备切换，重新resolve
-bool orientsec_active_standby_changed();
-// reset active/standby flag
-void orientsec_active_standby_reset();
-
-// 判断是否group属性发生改变，重新resolve
-bool orientsec_group_grade_changed();
-// reset group/grade flag
-void orientsec_group_grade_reset();
-
-// 判断是否需要resolve
-bool orientsec_need_resolved();
-// reset need_resolve flag
-void orientsec_need_resolved_reset();
+//订阅某服务的治理变化(provider列表、路由、主备、分组、方法级负载均衡，
+//连接负载均衡模式下的服务版本和容错标记)，返回该服务的变化计数。
+//计数在进程内一直有效，channel记录已处理的计数，变化时在后台重新resolve
+const gpr_atm* consumer_governance_subscribe(const char* service_name);
+
+//按provider_addr(如ipv4:127.0.0.1:50051)查找provider的负载统计，
+//返回值在进程内一直有效，地址为空时返回NULL
+void* consumer_provider_load_find(const char* provider_addr);
+
+//call选中provider时计数，收到最终状态时释放，用于bounded load、p2c_ewma等按负载选取的算法
+//latency_us为本次调用的延迟，小于0时不计入延迟EWMA(如被取消、重试重新选取)
+//status为grpc状态码，-1表示调用未完成，开启离群检测时用于统计成功率
+void consumer_provider_load_call_started(void* load);
+void consumer_provider_load_call_finished(void* load, int64_t latency_us,
+                                          int status);
 
 #ifdef __cplusplus
 }
@@ -16,101 +16,139 @@
  */
 
 #include "orientsec_grpc_consumer_control_requests.h"
+#include <stdlib.h>
+#include <string.h>
+#include <atomic>
 #include <map>
 #include <string>
-#include <vector>
 #include "grpc/support/alloc.h"
 #include "grpc/support/sync.h"
-#include "grpc/support/log.h"
-#include "src/core/lib/gpr/spinlock.h"
+#include "grpc/support/time.h"
 #include "orientsec_grpc_utils.h"
 #include "orientsec_grpc_common_utils.h"
 
-//请求数更新锁
-static bool orientsec_grpc_consumer_request_lock_isinit = false;
-static gpr_mu g_consumer_requests_mu;
+namespace {
 
-//记录指定服务的请求数
-static std::map<std::string, orientsec_grpc_consumer_request_t*> g_consumer_requests;
+// 令牌桶，按GCRA实现：只记录下一个请求的理论到达时间(tat)，
+// 每秒补充rate个令牌，最多积攒rate个，取令牌只需一次CAS
+struct consumer_rate_limiter {
+	gpr_atm rate;    // 每秒允许的请求数，<=0表示不限制
+	// 理论到达时间，单调时钟。纳秒值超出32位平台gpr_atm的范围，使用64位原子变量
+	std::atomic<int64_t> tat_ns;
+};
 
-//存储哪些服务需要进行最大请求数控制
-static std::map<std::string,long> g_consumer_maxrequests;
+typedef std::map<std::string, consumer_rate_limiter*> consumer_limiter_map;
 
-//最大请求数控制锁初始化
-void orientsec_grpc_consumer_request_mu_init() {
-	if (!orientsec_grpc_consumer_request_lock_isinit) {
-		orientsec_grpc_consumer_request_lock_isinit = true;
-		//此处可以模拟测试。。
-		gpr_mu_init(&g_consumer_requests_mu);
+// 服务名 => 令牌桶。令牌桶只增不删，调用线程可以一直持有指针
+gpr_once g_limiters_once = GPR_ONCE_INIT;
+gpr_mu g_limiters_mu;
+consumer_limiter_map* g_limiters = NULL;
+// 新增限流服务时加一，使各线程缓存的查找结果失效
+gpr_atm g_limiters_generation = 0;
+
+// 线程内按方法缓存的令牌桶，调用路径上不加锁、不分配内存
+#define ORIENTSEC_GRPC_LIMITER_CACHE_SIZE 16
+struct consumer_limiter_cache_entry {
+	std::string fullmethod;
+	gpr_atm generation;
+	consumer_rate_limiter* limiter;  // NULL表示该服务未配置限流
+};
+thread_local consumer_limiter_cache_entry
+		t_limiter_cache[ORIENTSEC_GRPC_LIMITER_CACHE_SIZE];
+
+void consumer_limiters_init() {
+	gpr_mu_init(&g_limiters_mu);
+	g_limiters = new consumer_limiter_map();
+}
+
+int64_t consumer_limiter_now_ns() {
+	gpr_timespec now = gpr_now(GPR_CLOCK_MONOTONIC);
+	return (int64_t)now.tv_sec * GPR_NS_PER_SEC + now.tv_nsec;
+}
+
+consumer_rate_limiter* consumer_limiter_find(const char* servicename) {
+	gpr_once_init(&g_limiters_once, consumer_limiters_init);
+	gpr_mu_lock(&g_limiters_mu);
+	consumer_limiter_map::iterator iter = g_limiters->find(servicename);
+	consumer_rate_limiter* limiter = iter == g_limiters->end() ? NULL : iter->second;
+	gpr_mu_unlock(&g_limiters_mu);
+	return limiter;
+}
+
+// 线程缓存未命中时解析服务名并查找，只在每个线程首次调用某方法或配置变化后发生
+consumer_rate_limiter* consumer_limiter_resolve(const char* fullmethod) {
+	// 方法名一般是生成代码中的静态字符串，按地址选槽位，按内容确认
+	size_t slot = ((size_t)fullmethod >> 4) % ORIENTSEC_GRPC_LIMITER_CACHE_SIZE;
+	consumer_limiter_cache_entry& entry = t_limiter_cache[slot];
+	gpr_atm generation = gpr_atm_acq_load(&g_limiters_generation);
+	if (entry.generation == generation && entry.fullmethod == fullmethod) {
+		return entry.limiter;
+	}
+	char* servicename = NULL;
+	orientsec_grpc_getserveice_by_fullmethod(fullmethod, &servicename);
+	if (servicename == NULL) {
+		return NULL;
+	}
+	entry.limiter = consumer_limiter_find(servicename);
+	entry.fullmethod = fullmethod;
+	entry.generation = generation;
+	free(servicename);
+	return entry.limiter;
+}
+
+bool consumer_limiter_acquire(consumer_rate_limiter* limiter) {
+	int64_t rate = (int64_t)gpr_atm_no_barrier_load(&limiter->rate);
+	if (rate <= 0) {
+		return true;
+	}
+	int64_t interval = GPR_NS_PER_SEC / rate;
+	if (interval <= 0) {
+		return true;
+	}
+	int64_t now = consumer_limiter_now_ns();
+	int64_t old_tat = limiter->tat_ns.load(std::memory_order_acquire);
+	for (;;) {
+		int64_t tat = old_tat > now ? old_tat : now;
+		// 积攒的令牌超过一秒的配额时拒绝
+		if (tat + interval - now > GPR_NS_PER_SEC) {
+			return false;
+		}
+		// 失败时old_tat更新为当前值后重试
+		if (limiter->tat_ns.compare_exchange_weak(old_tat, tat + interval)) {
+			return true;
+		}
 	}
 }
 
-//调用本方法更新最大请求数
+}  // namespace
+
+//调用本方法更新最大请求数，<=0表示取消限流
 void orientsec_grpc_consumer_update_maxrequest(char * servicename, long requestnum) {
-	if (requestnum >= 0) {
-		g_consumer_maxrequests.insert(std::pair<std::string, long >(servicename, requestnum));
+	if (servicename == NULL) {
+		return;
+	}
+	gpr_once_init(&g_limiters_once, consumer_limiters_init);
+	gpr_mu_lock(&g_limiters_mu);
+	consumer_rate_limiter*& limiter = (*g_limiters)[servicename];
+	if (limiter == NULL) {
+		limiter = new consumer_rate_limiter();
+		limiter->tat_ns.store(0, std::memory_order_relaxed);
+		gpr_atm_no_barrier_store(&limiter->rate, (gpr_atm)requestnum);
+		gpr_atm_full_fetch_add(&g_limiters_generation, 1);
+	} else {
+		gpr_atm_no_barrier_store(&limiter->rate, (gpr_atm)requestnum);
 	}
+	gpr_mu_unlock(&g_limiters_mu);
 }
 
 //校验制定服务是否需要进行请求数控制
 int orientsec_grpc_consumer_control_requests(const char * fullmethod) {
-	//根据fullname提取服务名
-	char * servicename = NULL;
-    orientsec_grpc_getserveice_by_fullmethod(fullmethod, &servicename);
-	orientsec_grpc_consumer_request_mu_init();
-
-	//根据fullname获取服务名
-	std::map<std::string, long>::iterator maxrequest = g_consumer_maxrequests.find(servicename);
-	long requestnum = 0;
-	if (maxrequest == g_consumer_maxrequests.end()) {
-		free(servicename);
-		servicename = NULL;
+	if (fullmethod == NULL) {
 		return 0;
 	}
-	else { 
-		//回去允许最大请求数
-		requestnum = maxrequest->second;
-		if (requestnum<=0) {
-			free(servicename);
-			servicename = NULL;
-			return 0;
-		}
-	}
-
-	uint64_t currentime = orientsec_get_timestamp_in_mills();
-	orientsec_grpc_consumer_request_t* requestinfo = (orientsec_grpc_consumer_request_t*)gpr_malloc(sizeof(orientsec_grpc_consumer_request_t));
-
-	//此处开始加锁
-	gpr_mu_lock(&g_consumer_requests_mu);
-	std::map<std::string, orientsec_grpc_consumer_request_t*>::iterator request = g_consumer_requests.find(servicename);
-	if (request != g_consumer_requests.end()) {
-		long currentrequests = request->second->currentrequests;
-		uint64_t timestamp = request->second->timestamp;		
-		//重新开始计数（计数周期进入下一秒，重新开始计数）
-		if ((currentime-timestamp) > 1000) {
-			request->second->currentrequests = 0;
-			request->second->timestamp = currentime;
-        }
-		else {  //在同一周期内做数量加一操作。
-			++currentrequests;
-			//requestnum > 0 表示需要进行请求数控制， currentrequests > requestnum 表示当前请求数大于允许请求数
-			if (currentrequests > requestnum && requestnum > 0) {
-				free(servicename);
-				servicename = NULL;
-                gpr_mu_unlock(&g_consumer_requests_mu);
-				return -1;
-			}
-			request->second->currentrequests = currentrequests;
-		}	   
+	consumer_rate_limiter* limiter = consumer_limiter_resolve(fullmethod);
+	if (limiter == NULL || consumer_limiter_acquire(limiter)) {
+		return 0;
 	}
-	else {
-		requestinfo->currentrequests = 0;
-		requestinfo->timestamp = currentime;
-		g_consumer_requests.insert(std::pair<std::string, orientsec_grpc_consumer_request_t* >(servicename, requestinfo));
-	} 
-	free(servicename);
-	servicename = NULL;
-	gpr_mu_unlock(&g_consumer_requests_mu);
-	return 0;
-	//此处进行解锁
+	return -1;
 }
@@ -29,18 +29,11 @@
 extern "C" {
 #endif
 
-	//请求数控制结构体
-	typedef struct _orientsec_grpc_consumer_request {
-		long currentrequests;
-		int64_t timestamp;
-	} orientsec_grpc_consumer_request_t;
-
-	//最大请求数控制锁初始化
-	void orientsec_grpc_consumer_request_mu_init();
-
+	//更新服务每秒允许的最大请求数，<=0表示不限制
 	void orientsec_grpc_consumer_update_maxrequest(char * servicename, long requestnum);
 
-	//校验制定服务是否需要进行请求数控制
+	//校验制定服务是否需要进行请求数控制，超出限制时返回-1
+	//按服务的令牌桶限流，调用路径上不加锁、不分配内存
 	int orientsec_grpc_consumer_control_requests(const char * fullmethod);
 
 #ifdef __cplusplus
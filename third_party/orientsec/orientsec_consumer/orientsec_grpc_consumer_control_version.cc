@@ -27,8 +27,6 @@ static std::map<std::string, std::string> g_consumer_service_version;
 
 static bool grpc_service_version_isinit = false; // 只做一次初始化
 
-static bool grpc_version_change_when_conn = false;
-
 //字符串拆分
 std::vector<std::string> orientsec_grpc_common_split(const std::string &s, const std::string &seperator) {
   std::vector<std::string> result;
@@ -131,8 +129,6 @@ void orientsec_grpc_consumer_control_version_update(char *service_name,char *ser
   else {
     g_consumer_service_version.insert(std::pair<std::string, std::string>(service_name, service_version));
   }
-  if (!is_request_loadbalance())
-    grpc_version_change_when_conn = true;
 
   //for (std::map<std::string, std::string>::iterator ii =
   //         g_consumer_service_version.begin();
@@ -141,13 +137,6 @@ void orientsec_grpc_consumer_control_version_update(char *service_name,char *ser
   //            << std::endl;
 }
 
-//校验服务版本是否变动
-bool orientsec_grpc_version_changed_conn() { return grpc_version_change_when_conn; }
-//重置服务版本是否变动标记
-void orientsec_reset_grpc_version_changed_conn() {
-  grpc_version_change_when_conn = false;
-}
-
 //校验服务版本是否匹配
 bool orientsec_grpc_consumer_control_version_match(const char *servername,char* version) {
   if (servername == NULL) {
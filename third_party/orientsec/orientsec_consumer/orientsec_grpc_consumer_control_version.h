@@ -47,10 +47,6 @@ extern "C" {
   //校验服务版本是否匹配
   bool orientsec_grpc_consumer_control_version_match(const char *servername, char* version);
 
-  //校验服务版本是否变动
-  bool orientsec_grpc_version_changed_conn();
-  //重置服务版本是否变动标记
-  void orientsec_reset_grpc_version_changed_conn();
         	
   //判断是否是请求负载均衡，否则是连接负载均衡
   bool is_request_loadbalance();
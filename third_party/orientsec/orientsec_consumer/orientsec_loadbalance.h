@@ -25,6 +25,7 @@
 #ifndef ORIENTSEC_LOADBALANCE_H
 #define ORIENTSEC_LOADBALANCE_H
 #include "orientsec_types.h"
+#include "provider_list.h"
 #include<map>
 #include<vector>
 #include<string>
@@ -46,7 +47,7 @@ public:
     //addbylm
     virtual int choose_subchannel(const char* sn,provider_t *provider, const int*nums) = 0;
 
-	virtual void set_providers(std::map<std::string, provider_t*> *_providers) = 0;
+	virtual void set_providers(std::map<std::string, provider_list*> *_providers) = 0;
 
 	virtual	void reset_cursor(const char* sn) = 0;
 };
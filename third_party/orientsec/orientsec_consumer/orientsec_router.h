@@ -40,7 +40,8 @@ class router
 {
 public:
 	//virtual int route(std::vector<provider_t*> &providers, url_t *url_param) = 0;
-	virtual int route(provider_t* providers, url_t *url_param) = 0;
+	// providers[0..num)为某服务当前在线的provider
+	virtual int route(provider_t* providers, int num, url_t *url_param) = 0;
 };
 
 #ifdef __cplusplus
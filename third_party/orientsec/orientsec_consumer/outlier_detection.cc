@@ -0,0 +1,308 @@
+/*
+ * Copyright 2019 Orient Securities Co., Ltd.
+ * Copyright 2019 BoCloud Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ *    2026/10/16
+ *    version 1.0
+ *    consumer端离群provider检测实现
+ */
+
+#include "outlier_detection.h"
+
+#include <math.h>
+#include <string.h>
+#include <algorithm>
+#include <vector>
+
+#include <grpc/impl/codegen/status.h>
+#include <grpc/support/log.h>
+
+namespace {
+
+int latency_bin(int64_t latency_us) {
+  int bin = 0;
+  while (latency_us > 1 && bin < ORIENTSEC_GRPC_OUTLIER_LATENCY_BINS - 1) {
+    latency_us >>= 1;
+    bin++;
+  }
+  return bin;
+}
+
+int64_t bucket_epoch(int64_t now_us) {
+  return now_us / ORIENTSEC_GRPC_OUTLIER_BUCKET_US;
+}
+
+struct outlier_candidate {
+  size_t index;
+  double success_rate;
+  int64_t p99;
+};
+
+bool lower_success_rate(const outlier_candidate& a,
+                        const outlier_candidate& b) {
+  return a.success_rate < b.success_rate;
+}
+
+bool higher_p99(const outlier_candidate& a, const outlier_candidate& b) {
+  return a.p99 > b.p99;
+}
+
+}  // namespace
+
+outlier_detection_config::outlier_detection_config()
+    : enabled(false),
+      base_ejection_us(30 * 1000 * 1000),
+      max_ejection_us(300 * 1000 * 1000),
+      max_ejection_percent(50),
+      min_requests(20),
+      min_hosts(3),
+      stdev_factor(1.9),
+      latency_factor(3.0) {}
+
+double outlier_window_stats::success_rate() const {
+  int64_t total = requests();
+  return total > 0 ? (double)success / (double)total : 1.0;
+}
+
+int64_t outlier_window_stats::latency_percentile(double q) const {
+  if (latency_samples <= 0) {
+    return 0;
+  }
+  int64_t rank = (int64_t)ceil(q * (double)latency_samples);
+  if (rank < 1) {
+    rank = 1;
+  }
+  int64_t seen = 0;
+  for (int i = 0; i < ORIENTSEC_GRPC_OUTLIER_LATENCY_BINS; i++) {
+    seen += latency[i];
+    if (seen >= rank) {
+      return ((int64_t)1 << (i + 1)) - 1;
+    }
+  }
+  return ((int64_t)1 << ORIENTSEC_GRPC_OUTLIER_LATENCY_BINS) - 1;
+}
+
+provider_outlier_state::provider_outlier_state()
+    : ejected_until_us_(0),
+      ejection_count_(0),
+      returning_(false),
+      stable_since_us_(0) {
+  for (int i = 0; i < ORIENTSEC_GRPC_OUTLIER_BUCKETS; i++) {
+    bucket& b = buckets_[i];
+    gpr_atm_no_barrier_store(&b.epoch, -1);
+    gpr_atm_no_barrier_store(&b.success, 0);
+    gpr_atm_no_barrier_store(&b.failure, 0);
+    for (int n = 0; n < ORIENTSEC_GRPC_OUTLIER_LATENCY_BINS; n++) {
+      gpr_atm_no_barrier_store(&b.latency[n], 0);
+    }
+  }
+}
+
+provider_outlier_state::bucket* provider_outlier_state::current_bucket(
+    int64_t now_us) {
+  int64_t epoch = bucket_epoch(now_us);
+  bucket& b = buckets_[epoch % ORIENTSEC_GRPC_OUTLIER_BUCKETS];
+  gpr_atm seen = gpr_atm_acq_load(&b.epoch);
+  if ((int64_t)seen < epoch && gpr_atm_full_cas(&b.epoch, seen, epoch)) {
+    gpr_atm_no_barrier_store(&b.success, 0);
+    gpr_atm_no_barrier_store(&b.failure, 0);
+    for (int n = 0; n < ORIENTSEC_GRPC_OUTLIER_LATENCY_BINS; n++) {
+      gpr_atm_no_barrier_store(&b.latency[n], 0);
+    }
+  }
+  return &b;
+}
+
+void provider_outlier_state::record(int64_t now_us, int64_t latency_us,
+                                    outlier_outcome outcome) {
+  if (outcome == OUTLIER_OUTCOME_NONE && latency_us < 0) {
+    return;
+  }
+  bucket* b = current_bucket(now_us);
+  if (outcome == OUTLIER_OUTCOME_SUCCESS) {
+    gpr_atm_no_barrier_fetch_add(&b->success, 1);
+  } else if (outcome == OUTLIER_OUTCOME_FAILURE) {
+    gpr_atm_no_barrier_fetch_add(&b->failure, 1);
+  }
+  if (latency_us >= 0) {
+    gpr_atm_no_barrier_fetch_add(&b->latency[latency_bin(latency_us)], 1);
+  }
+}
+
+void provider_outlier_state::summarize(int64_t now_us,
+                                       outlier_window_stats* stats) const {
+  memset(stats, 0, sizeof(*stats));
+  int64_t oldest = bucket_epoch(now_us) - ORIENTSEC_GRPC_OUTLIER_BUCKETS;
+  for (int i = 0; i < ORIENTSEC_GRPC_OUTLIER_BUCKETS; i++) {
+    const bucket& b = buckets_[i];
+    if ((int64_t)gpr_atm_acq_load(&b.epoch) <= oldest) {
+      continue;
+    }
+    stats->success += gpr_atm_no_barrier_load(&b.success);
+    stats->failure += gpr_atm_no_barrier_load(&b.failure);
+    for (int n = 0; n < ORIENTSEC_GRPC_OUTLIER_LATENCY_BINS; n++) {
+      int64_t count = gpr_atm_no_barrier_load(&b.latency[n]);
+      stats->latency[n] += count;
+      stats->latency_samples += count;
+    }
+  }
+}
+
+void outlier_detector::eject(const outlier_detection_config& config,
+                             provider_outlier_state* state, int64_t now_us) {
+  // 摘除时间 = base * 2^(次数-1)，不超过上限
+  int64_t duration = config.base_ejection_us;
+  for (int i = 0;
+       i < state->ejection_count_ && duration < config.max_ejection_us; i++) {
+    duration *= 2;
+  }
+  if (duration > config.max_ejection_us) {
+    duration = config.max_ejection_us;
+  }
+  state->ejection_count_++;
+  state->returning_ = true;
+  state->ejected_until_us_.store(now_us + duration, std::memory_order_release);
+}
+
+void outlier_detector::advance(const outlier_detection_config& config,
+                               provider_outlier_state* state, const char* name,
+                               int64_t now_us) {
+  if (state->ejected(now_us)) {
+    return;
+  }
+  if (state->returning_) {
+    // 摘除到期，快照由调用方比较摘除状态后重新发布
+    state->returning_ = false;
+    state->stable_since_us_ = now_us;
+    gpr_log(GPR_INFO, "outlier provider %s returned", name);
+  } else if (state->ejection_count_ > 0 &&
+             now_us - state->stable_since_us_ >= config.base_ejection_us) {
+    // 恢复后持续正常，逐步降低下次摘除时间
+    state->ejection_count_--;
+    state->stable_since_us_ = now_us;
+  }
+}
+
+void outlier_detector::sweep(const outlier_detection_config& config,
+                             const char* service_name,
+                             provider_outlier_state* const* states,
+                             const char* const* names, size_t num,
+                             int64_t now_us) {
+  size_t tracked = 0;
+  size_t ejected = 0;
+  std::vector<outlier_candidate> candidates;
+  for (size_t i = 0; i < num; i++) {
+    provider_outlier_state* state = states[i];
+    if (state == NULL) {
+      continue;
+    }
+    tracked++;
+    if (state->ejected(now_us)) {
+      ejected++;
+      continue;
+    }
+    outlier_window_stats stats;
+    state->summarize(now_us, &stats);
+    if (stats.requests() < config.min_requests) {
+      continue;
+    }
+    outlier_candidate candidate;
+    candidate.index = i;
+    candidate.success_rate = stats.success_rate();
+    candidate.p99 = stats.latency_samples >= config.min_requests
+                        ? stats.latency_percentile(0.99)
+                        : 0;
+    candidates.push_back(candidate);
+  }
+
+  size_t max_ejected = tracked * config.max_ejection_percent / 100;
+  if (candidates.size() < (size_t)config.min_hosts || ejected >= max_ejected) {
+    return;
+  }
+
+  // 成功率：低于 均值-stdev_factor*标准差
+  double sum = 0;
+  for (size_t i = 0; i < candidates.size(); i++) {
+    sum += candidates[i].success_rate;
+  }
+  double mean = sum / candidates.size();
+  double variance = 0;
+  for (size_t i = 0; i < candidates.size(); i++) {
+    double diff = candidates[i].success_rate - mean;
+    variance += diff * diff;
+  }
+  double threshold =
+      mean - config.stdev_factor * sqrt(variance / candidates.size());
+  std::vector<outlier_candidate> outliers;
+  for (size_t i = 0; i < candidates.size(); i++) {
+    if (candidates[i].success_rate < threshold) {
+      outliers.push_back(candidates[i]);
+    }
+  }
+  std::sort(outliers.begin(), outliers.end(), lower_success_rate);
+  size_t failing = outliers.size();
+
+  // 延迟：p99高于各provider p99中位数的latency_factor倍
+  std::vector<int64_t> p99s;
+  for (size_t i = 0; i < candidates.size(); i++) {
+    if (candidates[i].p99 > 0) {
+      p99s.push_back(candidates[i].p99);
+    }
+  }
+  if (p99s.size() >= (size_t)config.min_hosts) {
+    std::nth_element(p99s.begin(), p99s.begin() + p99s.size() / 2, p99s.end());
+    double limit = (double)p99s[p99s.size() / 2] * config.latency_factor;
+    for (size_t i = 0; i < candidates.size(); i++) {
+      const outlier_candidate& c = candidates[i];
+      if (c.success_rate >= threshold && c.p99 > limit &&
+          c.p99 >= ORIENTSEC_GRPC_OUTLIER_LATENCY_FLOOR_US) {
+        outliers.push_back(c);
+      }
+    }
+    std::sort(outliers.begin() + failing, outliers.end(), higher_p99);
+  }
+
+  // 失败的provider优先，其次是最慢的，摘除数量受max_ejection_percent限制
+  for (size_t i = 0; i < outliers.size() && ejected < max_ejected; i++) {
+    const outlier_candidate& c = outliers[i];
+    eject(config, states[c.index], now_us);
+    ejected++;
+    gpr_log(GPR_INFO,
+            "outlier provider %s of %s ejected: success rate %.3f, p99 %lldus, "
+            "ejection count %d",
+            names[c.index], service_name, c.success_rate, (long long)c.p99,
+            states[c.index]->ejection_count_);
+  }
+}
+
+outlier_outcome outlier_call_outcome(int status) {
+  switch (status) {
+    case -1:
+    // 调用方主动取消，与provider无关
+    case GRPC_STATUS_CANCELLED:
+      return OUTLIER_OUTCOME_NONE;
+    case GRPC_STATUS_UNKNOWN:
+    case GRPC_STATUS_DEADLINE_EXCEEDED:
+    case GRPC_STATUS_RESOURCE_EXHAUSTED:
+    case GRPC_STATUS_INTERNAL:
+    case GRPC_STATUS_UNAVAILABLE:
+    case GRPC_STATUS_DATA_LOSS:
+      return OUTLIER_OUTCOME_FAILURE;
+    default:
+      return OUTLIER_OUTCOME_SUCCESS;
+  }
+}
@@ -0,0 +1,149 @@
+/*
+ * Copyright 2019 Orient Securities Co., Ltd.
+ * Copyright 2019 BoCloud Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ *    2026/10/16
+ *    version 1.0
+ *    consumer端离群provider检测
+ *    按provider统计滑动窗口内的成功率和延迟分位数，成功率明显偏低或
+ *    p99明显偏高的provider被暂时摘除，摘除时间随次数指数增长
+ */
+
+#ifndef ORIENTSEC_OUTLIER_DETECTION_H
+#define ORIENTSEC_OUTLIER_DETECTION_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <atomic>
+
+#include <grpc/support/atm.h>
+
+// 滑动窗口：10个1秒的桶
+#define ORIENTSEC_GRPC_OUTLIER_BUCKETS 10
+#define ORIENTSEC_GRPC_OUTLIER_BUCKET_US (1000 * 1000)
+// 延迟直方图按2的幂分档，第i档为[2^i, 2^(i+1))微秒
+#define ORIENTSEC_GRPC_OUTLIER_LATENCY_BINS 32
+
+// p99低于此值的provider不按延迟摘除，避免1ms与3ms这类差异触发摘除
+#define ORIENTSEC_GRPC_OUTLIER_LATENCY_FLOOR_US (10 * 1000)
+
+// 检测参数，对应consumer.outlier.*配置
+struct outlier_detection_config {
+  bool enabled;
+  int64_t base_ejection_us;  // 首次摘除时间，之后每次翻倍
+  int64_t max_ejection_us;   // 单次摘除时间上限
+  int max_ejection_percent;  // 同一服务最多摘除的provider比例
+  int64_t min_requests;      // 窗口内样本少于此值的provider不参与检测
+  int min_hosts;             // 参与检测的provider少于此值时不检测
+  double stdev_factor;       // 成功率低于 均值-stdev_factor*标准差 时摘除
+  double latency_factor;     // p99高于 中位数*latency_factor 时摘除
+
+  outlier_detection_config();
+};
+
+// 窗口内样本的汇总
+struct outlier_window_stats {
+  int64_t success;
+  int64_t failure;
+  int64_t latency_samples;
+  int64_t latency[ORIENTSEC_GRPC_OUTLIER_LATENCY_BINS];
+
+  int64_t requests() const { return success + failure; }
+  double success_rate() const;
+  // upper bound of the bin holding quantile q (0 < q <= 1), 0 without samples
+  int64_t latency_percentile(double q) const;
+};
+
+// outcome of a finished call, see outlier_call_outcome()
+enum outlier_outcome {
+  OUTLIER_OUTCOME_NONE = 0,
+  OUTLIER_OUTCOME_SUCCESS,
+  OUTLIER_OUTCOME_FAILURE
+};
+
+// Detection state of one provider, shared by all channels like
+// provider_load_stats. Samples are recorded with atomics only; a bucket that
+// rolls over is reset by whoever wins the CAS on its epoch, samples racing
+// with the reset may be lost, which only blurs the window edge.
+class provider_outlier_state {
+ public:
+  provider_outlier_state();
+
+  void record(int64_t now_us, int64_t latency_us, outlier_outcome outcome);
+  void summarize(int64_t now_us, outlier_window_stats* stats) const;
+
+  bool ejected(int64_t now_us) const {
+    return now_us < ejected_until_us_.load(std::memory_order_acquire);
+  }
+
+ private:
+  friend class outlier_detector;
+
+  provider_outlier_state(const provider_outlier_state&);
+  provider_outlier_state& operator=(const provider_outlier_state&);
+
+  struct bucket {
+    gpr_atm epoch;  // 桶对应的秒数，-1为未使用
+    gpr_atm success;
+    gpr_atm failure;
+    gpr_atm latency[ORIENTSEC_GRPC_OUTLIER_LATENCY_BINS];
+  };
+
+  bucket* current_bucket(int64_t now_us);
+
+  bucket buckets_[ORIENTSEC_GRPC_OUTLIER_BUCKETS];
+  // 微秒时间超出32位平台gpr_atm的范围，使用64位原子变量
+  std::atomic<int64_t> ejected_until_us_;
+  // 以下只在检测线程中修改
+  int ejection_count_;      // 连续摘除次数，决定下次摘除时间
+  bool returning_;          // 摘除到期后尚未检测过
+  int64_t stable_since_us_;  // 最近一次恢复或摘除次数衰减的时间
+};
+
+// Evaluates the providers of one service. Sweeps only run on the consumer's
+// outlier detection thread. The state is keyed by host:port and shared by
+// every service on that address, so after sweeping all services the caller
+// republishes each snapshot whose ejections no longer match (see
+// provider_snapshot::ejection_changed).
+class outlier_detector {
+ public:
+  // ends an expired ejection and decays the ejection count. Called once per
+  // distinct state per tick before the services are swept, so a provider
+  // exporting several services does not recover faster
+  static void advance(const outlier_detection_config& config,
+                      provider_outlier_state* state, const char* name,
+                      int64_t now_us);
+
+  // compares the providers of one service with each other and ejects the
+  // outliers. states[i] may be NULL for providers without load stats,
+  // names[i] is the host:port used in the log
+  static void sweep(const outlier_detection_config& config,
+                    const char* service_name,
+                    provider_outlier_state* const* states,
+                    const char* const* names, size_t num, int64_t now_us);
+
+ private:
+  static void eject(const outlier_detection_config& config,
+                    provider_outlier_state* state, int64_t now_us);
+};
+
+// maps a grpc status code (-1 when the call did not finish) to the outcome
+// counted for the provider. Application errors such as NOT_FOUND are answers
+// of a healthy provider and count as success.
+outlier_outcome outlier_call_outcome(int status);
+
+#endif  // !ORIENTSEC_OUTLIER_DETECTION_H
@@ -0,0 +1,104 @@
+/*
+ * Copyright 2019 Orient Securities Co., Ltd.
+ * Copyright 2019 BoCloud Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ *    2026/10/16
+ *    version 1.0
+ *    p2c_ewma 负载均衡处理类方法定义
+ */
+
+#include "p2c_ewma_lb.h"
+
+#include <vector>
+
+#include <grpc/support/time.h>
+
+namespace {
+
+// xorshift，每个线程独立的随机序列，选取时不加锁
+uint32_t p2c_random() {
+	static thread_local uint32_t state = 0;
+	if (state == 0) {
+		gpr_timespec now = gpr_now(GPR_CLOCK_MONOTONIC);
+		state = (uint32_t)now.tv_nsec ^ (uint32_t)(uintptr_t)&state;
+		if (state == 0) {
+			state = 2463534242u;
+		}
+	}
+	state ^= state << 13;
+	state ^= state >> 17;
+	state ^= state << 5;
+	return state;
+}
+
+}  // namespace
+
+p2c_ewma_lb::p2c_ewma_lb()
+	: providers(NULL)
+{
+}
+
+p2c_ewma_lb::~p2c_ewma_lb()
+{
+}
+
+void p2c_ewma_lb::set_providers(std::map<std::string, provider_list*>* _providers)
+{
+	this->providers = _providers;
+}
+
+void p2c_ewma_lb::reset_cursor(const char * sn)
+{
+}
+
+int p2c_ewma_lb::choose_subchannel(const char* sn, provider_t *provider, const int*nums)
+{
+	if (!sn) {
+		return 0;
+	}
+	if (provider == NULL || *nums == 0) {
+		return 0;
+	}
+	std::vector<provider_load_stats*> loads(*nums);
+	for (int i = 0; i < *nums; i++) {
+		loads[i] = provider_load_stats_get(provider[i].host, provider[i].port);
+	}
+	return choose_subchannel(&loads[0], *nums);
+}
+
+int p2c_ewma_lb::choose_subchannel(provider_load_stats* const* loads, int nums)
+{
+	if (loads == NULL || nums <= 1) {
+		return 0;
+	}
+	// 两个不同的随机下标
+	int a = (int)(p2c_random() % (uint32_t)nums);
+	int b = (int)(p2c_random() % (uint32_t)(nums - 1));
+	if (b >= a) {
+		b++;
+	}
+	if (loads[a] == NULL || loads[b] == NULL) {
+		return loads[a] == NULL ? b : a;
+	}
+	int64_t now = provider_load_now_us();
+	return loads[a]->cost(now) <= loads[b]->cost(now) ? a : b;
+}
+
+provider_t * p2c_ewma_lb::choose_provider(const char * sn, int step)
+{
+	return NULL;
+}
@@ -0,0 +1,62 @@
+/*
+ * Copyright 2019 Orient Securities Co., Ltd.
+ * Copyright 2019 BoCloud Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ *    2026/10/16
+ *    version 1.0
+ *    p2c_ewma 负载均衡处理类声明
+ *    随机取两个provider，选延迟EWMA乘以(在途请求数+1)较小的一个
+ */
+
+#ifndef ORIENTSEC_GRPC_P2C_EWMA_H
+#define ORIENTSEC_GRPC_P2C_EWMA_H
+
+#include "orientsec_loadbalance.h"
+#include "provider_load_stats.h"
+#include<map>
+#include<string>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+	class p2c_ewma_lb :
+		public orientsec_grpc_loadbalance
+	{
+	public:
+		p2c_ewma_lb();
+		~p2c_ewma_lb();
+
+		void set_providers(std::map<std::string, provider_list*> *_providers);
+		void reset_cursor(const char* sn);
+
+		// 按host:port查找负载统计后选取，快照中的可选集合应使用其自带的统计
+		int choose_subchannel(const char* sn, provider_t *provider, const int*nums);
+
+		// loads[i]为provider[i]的负载统计
+		static int choose_subchannel(provider_load_stats* const* loads, int nums);
+
+		provider_t* choose_provider(const char* sn, int step = 0);
+	private:
+		std::map<std::string, provider_list*> *providers;
+	};
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // !ORIENTSEC_GRPC_P2C_EWMA_H
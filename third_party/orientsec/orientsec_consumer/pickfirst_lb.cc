@@ -47,12 +47,15 @@ provider_t* pickfirst_lb::choose_provider(const char* sn, int step) {
   {
 	  return NULL;
   }
-  std::map<std::string, provider_t*>::iterator provider_lst_iter = providers->find(sn);
+  std::map<std::string, provider_list*>::iterator provider_lst_iter = providers->find(sn);
   if (provider_lst_iter == providers->end())
   {
 	  return NULL;
   }
-  int size = orientsec_grpc_cache_provider_count_get();
+  int size = provider_lst_iter->second->size();
+  if (size == 0) {
+    return NULL;
+  }
   srand(time(NULL));//设置随机数种子。
 
   int index = rand() % size;
@@ -63,10 +66,10 @@ provider_t* pickfirst_lb::choose_provider(const char* sn, int step) {
   int index_valid = -1;
   while (do_while)
   {
-    is_invalid = is_provider_invalid(&provider_lst_iter->second[index]);
+    is_invalid = is_provider_invalid(&provider_lst_iter->second->at(index));
     if (is_invalid == false) { //查找到未禁用的服务
       //根据服务名和版本号校验是否匹配
-      if (orientsec_grpc_consumer_control_version_match(provider_lst_iter->second[index].sInterface, provider_lst_iter->second[index].version) == true) {
+      if (orientsec_grpc_consumer_control_version_match(provider_lst_iter->second->at(index).sInterface, provider_lst_iter->second->at(index).version) == true) {
 	index_valid = index;
 	break;              //找到未禁用，并且版本匹配的服务
       }
@@ -85,11 +88,11 @@ provider_t* pickfirst_lb::choose_provider(const char* sn, int step) {
       }
     }
   }
-  return clone_provider(&provider_lst_iter->second[index_valid]);
+  return clone_provider(&provider_lst_iter->second->at(index_valid));
 }
 
 
-void pickfirst_lb::set_providers(std::map<std::string, provider_t*> *_providers) {
+void pickfirst_lb::set_providers(std::map<std::string, provider_list*> *_providers) {
   this->providers = _providers;
 }
 
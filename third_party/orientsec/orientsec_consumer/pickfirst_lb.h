@@ -43,14 +43,14 @@ extern "C" {
 		~pickfirst_lb();
 
 		//void setProviders(std::map<std::string, std::vector<provider_t*> > *_providers);
-		void set_providers(std::map<std::string, provider_t*> *_providers);
+		void set_providers(std::map<std::string, provider_list*> *_providers);
 
 		int choose_subchannel(const char* sn, provider_t *provider, const int*nums);
 
 		provider_t* choose_provider(const char* sn, int step = 0);
 		void reset_cursor(const char* sn);
 	private:
-		std::map<std::string, provider_t*> *providers;
+		std::map<std::string, provider_list*> *providers;
 	};
 
 #ifdef __cplusplus
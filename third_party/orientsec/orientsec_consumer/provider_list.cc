@@ -0,0 +1,87 @@
+/*
+ * Copyright 2019 Orient Securities Co., Ltd.
+ * Copyright 2019 BoCloud Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ *    2026/10/16
+ *    version 1.0
+ *    consumer端某服务的provider缓存实现
+ */
+
+#include "provider_list.h"
+
+#include <stdio.h>
+
+#include "registry_utils.h"
+
+provider_list::~provider_list() { clear(); }
+
+std::string provider_list::key(const char* host, int port) {
+  char port_str[16];
+  snprintf(port_str, sizeof(port_str), ":%d", port);
+  return std::string(host ? host : "") + port_str;
+}
+
+provider_t* provider_list::find(const char* host, int port) {
+  std::unordered_map<std::string, int>::iterator iter =
+      index_.find(key(host, port));
+  return iter == index_.end() ? NULL : &providers_[iter->second];
+}
+
+provider_t* provider_list::upsert(const provider_t& provider) {
+  std::pair<std::unordered_map<std::string, int>::iterator, bool> ret =
+      index_.insert(
+          std::make_pair(key(provider.host, provider.port), size()));
+  if (ret.second) {
+    providers_.push_back(provider);
+    return &providers_.back();
+  }
+  provider_t& slot = providers_[ret.first->second];
+  free_provider_v2_ex(&slot);
+  slot = provider;
+  return &slot;
+}
+
+void provider_list::remove_at(int index) {
+  if (index < 0 || index >= size()) {
+    return;
+  }
+  provider_t& slot = providers_[index];
+  index_.erase(key(slot.host, slot.port));
+  free_provider_v2_ex(&slot);
+  int last = size() - 1;
+  if (index != last) {
+    slot = providers_[last];
+    index_[key(slot.host, slot.port)] = index;
+  }
+  providers_.pop_back();
+}
+
+void provider_list::remove(const char* host, int port) {
+  std::unordered_map<std::string, int>::iterator iter =
+      index_.find(key(host, port));
+  if (iter != index_.end()) {
+    remove_at(iter->second);
+  }
+}
+
+void provider_list::clear() {
+  for (size_t i = 0; i < providers_.size(); i++) {
+    free_provider_v2_ex(&providers_[i]);
+  }
+  providers_.clear();
+  index_.clear();
+}
@@ -0,0 +1,71 @@
+/*
+ * Copyright 2019 Orient Securities Co., Ltd.
+ * Copyright 2019 BoCloud Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ *    2026/10/16
+ *    version 1.0
+ *    consumer端某服务的provider缓存
+ *    只保存在线的provider，按host:port索引，连续存放，大小随provider数量变化
+ */
+
+#ifndef ORIENTSEC_PROVIDER_LIST_H
+#define ORIENTSEC_PROVIDER_LIST_H
+
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "orientsec_types.h"
+
+// Providers of one service, owned by the list: strings and ext_data of the
+// entries are released with free_provider_v2_ex when they are replaced or
+// removed. Removal swaps the last entry into the hole, so indexes are only
+// stable until the next upsert or remove. Not thread safe, callers hold the
+// providers list lock.
+class provider_list {
+ public:
+  provider_list() {}
+  ~provider_list();
+
+  // NULL when empty
+  provider_t* data() { return providers_.empty() ? NULL : &providers_[0]; }
+  int size() const { return (int)providers_.size(); }
+  provider_t& at(int index) { return providers_[index]; }
+
+  provider_t* find(const char* host, int port);
+
+  // stores provider, replacing (and releasing) an entry with the same
+  // host:port. takes over the pointers held by provider.
+  provider_t* upsert(const provider_t& provider);
+
+  void remove_at(int index);
+  // no-op when host:port is not cached
+  void remove(const char* host, int port);
+  void clear();
+
+  static std::string key(const char* host, int port);
+
+ private:
+  provider_list(const provider_list&);
+  provider_list& operator=(const provider_list&);
+
+  std::vector<provider_t> providers_;
+  // host:port => index in providers_
+  std::unordered_map<std::string, int> index_;
+};
+
+#endif  // !ORIENTSEC_PROVIDER_LIST_H
@@ -0,0 +1,148 @@
+/*
+ * Copyright 2019 Orient Securities Co., Ltd.
+ * Copyright 2019 BoCloud Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ *    2026/10/16
+ *    version 1.0
+ *    consumer端provider负载统计实现
+ */
+
+#include "provider_load_stats.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+#include <map>
+#include <string>
+
+#include <grpc/support/sync.h>
+#include <grpc/support/time.h>
+
+namespace {
+
+typedef std::map<std::string, provider_load_stats*> provider_load_map;
+
+gpr_once g_load_once = GPR_ONCE_INIT;
+gpr_mu g_load_mu;
+provider_load_map* g_loads = NULL;
+
+void provider_load_init() {
+  gpr_mu_init(&g_load_mu);
+  g_loads = new provider_load_map();
+}
+
+provider_load_stats* provider_load_stats_get_key(const std::string& key) {
+  gpr_once_init(&g_load_once, provider_load_init);
+  gpr_mu_lock(&g_load_mu);
+  provider_load_stats*& stats = (*g_loads)[key];
+  if (stats == NULL) {
+    stats = new provider_load_stats();
+  }
+  provider_load_stats* ret = stats;
+  gpr_mu_unlock(&g_load_mu);
+  return ret;
+}
+
+// 按距上次样本的时间衰减
+double decay_weight(int64_t elapsed_us) {
+  if (elapsed_us <= 0) {
+    return 1.0;
+  }
+  return exp(-(double)elapsed_us / ORIENTSEC_GRPC_EWMA_DECAY_US);
+}
+
+}  // namespace
+
+int64_t provider_load_now_us() {
+  gpr_timespec now = gpr_now(GPR_CLOCK_MONOTONIC);
+  return (int64_t)now.tv_sec * GPR_US_PER_SEC + now.tv_nsec / GPR_NS_PER_US;
+}
+
+provider_load_stats::provider_load_stats() : ewma_us_(0), stamp_us_(0) {
+  gpr_atm_no_barrier_store(&outstanding_, 0);
+}
+
+void provider_load_stats::call_finished(int64_t latency_us, int status) {
+  gpr_atm_no_barrier_fetch_add(&outstanding_, -1);
+  outlier_outcome outcome = outlier_call_outcome(status);
+  if (latency_us < 0 && outcome == OUTLIER_OUTCOME_NONE) {
+    return;
+  }
+  int64_t now = provider_load_now_us();
+  outlier_.record(now, latency_us, outcome);
+  if (latency_us < 0) {
+    return;
+  }
+  int64_t stamp = stamp_us_.exchange(now, std::memory_order_relaxed);
+  double w = decay_weight(now - stamp);
+  // 并发完成的样本各自重试，丢失的只是衰减时间的精度
+  int64_t old_ewma = ewma_us_.load(std::memory_order_relaxed);
+  for (;;) {
+    int64_t new_ewma =
+        latency_us > old_ewma
+            ? latency_us
+            : (int64_t)(old_ewma * w + (double)latency_us * (1.0 - w));
+    if (ewma_us_.compare_exchange_weak(old_ewma, new_ewma,
+                                       std::memory_order_relaxed)) {
+      break;
+    }
+  }
+}
+
+int64_t provider_load_stats::latency_ewma(int64_t now_us) const {
+  int64_t ewma = ewma_us_.load(std::memory_order_relaxed);
+  int64_t stamp = stamp_us_.load(std::memory_order_relaxed);
+  // 长时间没有样本(如GC停顿后不再被选中)时逐渐恢复
+  return (int64_t)(ewma * decay_weight(now_us - stamp));
+}
+
+double provider_load_stats::cost(int64_t now_us) const {
+  int64_t latency = latency_ewma(now_us);
+  gpr_atm pending = outstanding();
+  if (pending < 0) {
+    pending = 0;
+  }
+  // 没有样本的provider按1us计，只比较在途请求数
+  return (double)(latency > 0 ? latency : 1) * (double)(pending + 1);
+}
+
+provider_load_stats* provider_load_stats_get(const char* host, int port) {
+  if (host == NULL) {
+    return NULL;
+  }
+  char port_str[16];
+  snprintf(port_str, sizeof(port_str), ":%d", port);
+  return provider_load_stats_get_key(std::string(host) + port_str);
+}
+
+provider_load_stats* provider_load_stats_find_addr(const char* provider_addr) {
+  if (provider_addr == NULL || provider_addr[0] == '\0') {
+    return NULL;
+  }
+  // 去掉ipv4:/ipv6:前缀及ipv6地址的方括号，与provider的host:port一致
+  const char* addr = provider_addr;
+  if (strncmp(addr, "ipv4:", 5) == 0 || strncmp(addr, "ipv6:", 5) == 0) {
+    addr += 5;
+  }
+  std::string key;
+  for (; *addr; addr++) {
+    if (*addr != '[' && *addr != ']') {
+      key.push_back(*addr);
+    }
+  }
+  return provider_load_stats_get_key(key);
+}
@@ -0,0 +1,86 @@
+/*
+ * Copyright 2019 Orient Securities Co., Ltd.
+ * Copyright 2019 BoCloud Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ *    2026/10/16
+ *    version 1.0
+ *    consumer端provider负载统计
+ *    call选中provider时计数，收到最终状态时释放并记录延迟，所有channel共享
+ */
+
+#ifndef ORIENTSEC_PROVIDER_LOAD_STATS_H
+#define ORIENTSEC_PROVIDER_LOAD_STATS_H
+
+#include <stdint.h>
+#include <atomic>
+
+#include <grpc/support/atm.h>
+
+#include "outlier_detection.h"
+
+// 延迟EWMA的衰减时间，没有新样本时按此时间常数衰减
+#define ORIENTSEC_GRPC_EWMA_DECAY_US (10 * 1000 * 1000)
+
+// load of one provider, updated with atomics only
+class provider_load_stats {
+ public:
+  provider_load_stats();
+
+  // 已发出、尚未收到最终状态的请求数
+  gpr_atm outstanding() const { return gpr_atm_no_barrier_load(&outstanding_); }
+
+  void call_started() { gpr_atm_no_barrier_fetch_add(&outstanding_, 1); }
+  // latency_us < 0 means the call did not produce a latency sample,
+  // status is the grpc status code or -1 when the call never finished
+  void call_finished(int64_t latency_us = -1, int status = -1);
+
+  // peak EWMA of the call latency in microseconds: a slower sample takes
+  // effect at once, faster samples and idle time decay it with
+  // ORIENTSEC_GRPC_EWMA_DECAY_US. 0 until the first sample.
+  int64_t latency_ewma(int64_t now_us) const;
+
+  // p2c_ewma的选取代价：延迟EWMA乘以(在途请求数+1)
+  double cost(int64_t now_us) const;
+
+  // 离群检测的滑动窗口及摘除状态
+  provider_outlier_state* outlier() { return &outlier_; }
+  const provider_outlier_state* outlier() const { return &outlier_; }
+
+ private:
+  provider_load_stats(const provider_load_stats&);
+  provider_load_stats& operator=(const provider_load_stats&);
+
+  gpr_atm outstanding_;
+  // 微秒时间和延迟超出32位平台gpr_atm的范围，使用64位原子变量
+  std::atomic<int64_t> ewma_us_;
+  std::atomic<int64_t> stamp_us_;  // 最近一次样本的时间
+  provider_outlier_state outlier_;
+};
+
+// monotonic clock used for the latency samples
+int64_t provider_load_now_us();
+
+// Entries are keyed by host:port and never removed, so the returned pointer
+// stays valid for the life of the process and can be cached in snapshots
+// and calls. Lookups take a mutex, callers resolve once and keep the pointer.
+provider_load_stats* provider_load_stats_get(const char* host, int port);
+
+// provider_addr as written by the lb policy, e.g. ipv4:127.0.0.1:50051.
+// returns NULL for an empty address.
+provider_load_stats* provider_load_stats_find_addr(const char* provider_addr);
+
+#endif  // !ORIENTSEC_PROVIDER_LOAD_STATS_H
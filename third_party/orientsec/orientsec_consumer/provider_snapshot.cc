@@ -0,0 +1,423 @@
+/*
+ * Copyright 2019 Orient Securities Co., Ltd.
+ * Copyright 2019 BoCloud Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ *    2026/10/16
+ *    version 1.0
+ *    consumer端provider列表只读快照实现
+ */
+
+#include "provider_snapshot.h"
+
+#include <set>
+
+#include "orientsec_grpc_common_init.h"
+#include "orientsec_grpc_consumer_control_version.h"
+#include "orientsec_grpc_string_op.h"
+#include "url.h"
+
+namespace {
+
+// last table seen by the current thread
+struct provider_snapshot_tls {
+  const provider_snapshot_registry* owner;
+  gpr_atm generation;
+  int depth;
+  std::shared_ptr<const provider_snapshot_table> table;
+};
+
+thread_local provider_snapshot_tls t_snapshot = {NULL, -1, 0, nullptr};
+
+// provider不在任何分组中
+const int kNoGrade = -1;
+
+// consumer端分组配置编译后的结果：分组名 => 优先级(0最高)
+gpr_once g_group_grades_once = GPR_ONCE_INIT;
+std::map<std::string, int>* g_group_grades = NULL;
+
+// 分组配置如"g1,g2;g3"，分号分隔优先级，逗号分隔同级分组。
+// 配置只在启动时从配置文件读取，编译一次
+void compile_group_grades() {
+  g_group_grades = new std::map<std::string, int>();
+  char* group_conf = orientsec_grpc_consumer_service_group_get();
+  if (group_conf == NULL || strlen(group_conf) == 0) {
+    return;
+  }
+  std::vector<std::string> grade_info;
+  orientsec_grpc_split_to_vec(std::string(group_conf), grade_info, ";");
+  for (size_t i = 0; i < grade_info.size(); i++) {
+    std::vector<std::string> groups;
+    orientsec_grpc_split_to_vec(grade_info[i], groups, ",");
+    for (size_t n = 0; n < groups.size(); n++) {
+      // 重复出现的分组按最高优先级
+      g_group_grades->insert(std::make_pair(groups[n], (int)i));
+    }
+  }
+}
+
+// empty when the consumer does not grade groups
+const std::map<std::string, int>& group_grades() {
+  gpr_once_init(&g_group_grades_once, compile_group_grades);
+  return *g_group_grades;
+}
+
+int provider_group_grade(const std::map<std::string, int>& grades,
+                         const char* group) {
+  std::map<std::string, int>::const_iterator iter = grades.find(group);
+  return iter == grades.end() ? kNoGrade : iter->second;
+}
+
+// 黑名单、容错、主备状态
+bool provider_callable(const provider_t& provider) {
+  return !ORIENTSEC_GRPC_CHECK_BIT(provider.flag_in_blklist,
+                                   ORIENTSEC_GRPC_PROVIDER_FLAG_IN_BLKLIST) &&
+         provider.flag_call_failover == 0 && provider.online;
+}
+
+}  // namespace
+
+provider_pick_set::provider_pick_set() {
+  gpr_atm_no_barrier_store(&wrr_, 0);
+  gpr_atm_no_barrier_store(&hash_ring_, 0);
+}
+
+provider_pick_set::~provider_pick_set() {
+  delete (wrr_schedule*)gpr_atm_no_barrier_load(&wrr_);
+  delete (consistent_hash_ring*)gpr_atm_no_barrier_load(&hash_ring_);
+}
+
+const wrr_schedule* provider_pick_set::wrr() const {
+  wrr_schedule* schedule = (wrr_schedule*)gpr_atm_acq_load(&wrr_);
+  if (schedule != NULL) {
+    return schedule;
+  }
+  // 与hash_ring相同，并发首次选取时只保留先发布的一个
+  schedule = new wrr_schedule(providers(), size());
+  if (!gpr_atm_full_cas(&wrr_, 0, (gpr_atm)schedule)) {
+    delete schedule;
+    schedule = (wrr_schedule*)gpr_atm_acq_load(&wrr_);
+  }
+  return schedule;
+}
+
+const consistent_hash_ring* provider_pick_set::hash_ring() const {
+  consistent_hash_ring* ring =
+      (consistent_hash_ring*)gpr_atm_acq_load(&hash_ring_);
+  if (ring != NULL) {
+    return ring;
+  }
+  // 并发首次选取时各自建环，只保留先发布的一个
+  ring = new consistent_hash_ring(providers(), size());
+  if (!gpr_atm_full_cas(&hash_ring_, 0, (gpr_atm)ring)) {
+    delete ring;
+    ring = (consistent_hash_ring*)gpr_atm_acq_load(&hash_ring_);
+  }
+  return ring;
+}
+
+void provider_pick_set::inherit(const provider_pick_set& previous) {
+  const wrr_schedule* schedule =
+      (const wrr_schedule*)gpr_atm_acq_load(&previous.wrr_);
+  if (schedule != NULL) {
+    gpr_atm_rel_store(&wrr_,
+                      (gpr_atm) new wrr_schedule(providers(), size(), schedule));
+  }
+  const consistent_hash_ring* ring =
+      (const consistent_hash_ring*)gpr_atm_acq_load(&previous.hash_ring_);
+  if (ring != NULL) {
+    gpr_atm_rel_store(
+        &hash_ring_,
+        (gpr_atm) new consistent_hash_ring(providers(), size(), ring));
+  }
+}
+
+provider_snapshot::provider_snapshot(const char* service_name,
+                                     const provider_t* providers, int num,
+                                     const provider_snapshot* previous)
+    : service_name_(service_name),
+      grouped_(false),
+      callable_count_(0),
+      version_matched_count_(0),
+      active_count_(0) {
+  for (int i = 0; i < num; i++) {
+    if (providers[i].flag_invalid != 0) {
+      continue;
+    }
+    providers_.push_back(providers[i]);
+    methods_.push_back(providers[i].methods ? providers[i].methods : "");
+  }
+  // methods_ does not grow any more, pointers into it stay valid
+  method_bits_.resize(providers_.size());
+  const std::map<std::string, int>& grades = group_grades();
+  grouped_ = !grades.empty();
+  group_grades_.resize(providers_.size(), kNoGrade);
+  ejected_.resize(providers_.size(), false);
+  loads_.resize(providers_.size(), NULL);
+  int64_t now_us = provider_load_now_us();
+  std::vector<std::string> provider_methods;
+  for (size_t i = 0; i < providers_.size(); i++) {
+    provider_t& p = providers_[i];
+    p.username = NULL;
+    p.password = NULL;
+    p.token = NULL;
+    p.owner = NULL;
+    p.application = NULL;
+    p.application_version = NULL;
+    p.organization = NULL;
+    p.environment = NULL;
+    p.module = NULL;
+    p.module_version = NULL;
+    p.grpc = NULL;
+    p.dubbo = NULL;
+    p.ext_data = NULL;
+    p.project = NULL;
+    p.comm_owner = NULL;
+    p.methods = (char*)methods_[i].c_str();
+    p.sInterface = (char*)service_name_.c_str();
+    if (grouped_) {
+      group_grades_[i] = provider_group_grade(grades, p.group);
+    }
+    loads_[i] = provider_load_stats_get(p.host, p.port);
+    ejected_[i] = loads_[i] != NULL && loads_[i]->outlier()->ejected(now_us);
+    // 方法名只在建快照时比较一次，之后按ID位测试
+    provider_methods.clear();
+    orientsec_grpc_split_to_vec(methods_[i], provider_methods, ",");
+    for (size_t m = 0; m < provider_methods.size(); m++) {
+      size_t id = method_ids_
+                      .insert(std::make_pair(provider_methods[m],
+                                             method_ids_.size()))
+                      .first->second;
+      method_bits_[i].set(id);
+    }
+
+    if (ORIENTSEC_GRPC_CHECK_BIT(p.flag_in_blklist,
+                                 ORIENTSEC_GRPC_PROVIDER_FLAG_IN_BLKLIST) ||
+        p.flag_call_failover != 0) {
+      continue;
+    }
+    if (!ORIENTSEC_GRPC_CHECK_BIT(p.flag_subchannel_close,
+                                  ORIENTSEC_GRPC_PROVIDER_FLAG_SUB_CLOSED)) {
+      callable_count_++;
+    }
+    if (orientsec_grpc_consumer_control_version_match(service_name_.c_str(),
+                                                      p.version)) {
+      version_matched_count_++;
+    }
+    if (p.is_master) {
+      active_count_++;
+    }
+  }
+
+  std::vector<bool> all(providers_.size(), true);
+  build_pick_sets(&service_sets_, all);
+
+  // 通常所有provider提供相同的方法，提供者相同的方法共用一份可选集合
+  std::map<std::vector<bool>, const pick_sets*> shared;
+  shared.insert(std::make_pair(all, &service_sets_));
+  for (std::map<std::string, size_t>::const_iterator iter =
+           method_ids_.begin();
+       iter != method_ids_.end(); ++iter) {
+    std::vector<bool> offered(providers_.size());
+    for (size_t i = 0; i < providers_.size(); i++) {
+      offered[i] = method_bits_[i].test(iter->second);
+    }
+    const pick_sets*& sets = shared[offered];
+    if (sets == NULL) {
+      pick_sets* built = new pick_sets();
+      build_pick_sets(built, offered);
+      owned_sets_.push_back(built);
+      sets = built;
+    }
+    method_sets_.insert(std::make_pair(iter->first.c_str(), sets));
+  }
+  inherit_pick_sets(previous);
+}
+
+// 发布时按上一快照已建好的调度表和哈希环重建，不留到选取时全量重建
+void provider_snapshot::inherit_pick_sets(const provider_snapshot* previous) {
+  if (previous == NULL) {
+    return;
+  }
+  std::set<const pick_sets*> done;
+  done.insert(&service_sets_);
+  for (int k = 0; k < 2; k++) {
+    service_sets_.sets[k].inherit(*previous->pick_set(NULL, k == 1));
+  }
+  for (pick_set_map::const_iterator iter = method_sets_.begin();
+       iter != method_sets_.end(); ++iter) {
+    if (!done.insert(iter->second).second) {
+      continue;
+    }
+    // 值指向本快照的owned_sets_
+    pick_sets* sets = const_cast<pick_sets*>(iter->second);
+    for (int k = 0; k < 2; k++) {
+      sets->sets[k].inherit(*previous->pick_set(iter->first, k == 1));
+    }
+  }
+}
+
+provider_snapshot::~provider_snapshot() {
+  for (size_t i = 0; i < owned_sets_.size(); i++) {
+    delete owned_sets_[i];
+  }
+}
+
+void provider_snapshot::build_pick_sets(pick_sets* sets,
+                                        const std::vector<bool>& offered) {
+  std::vector<int> candidates[2];
+  // 离群摘除的provider不可选；全部被摘除时忽略摘除，避免方法无provider可用
+  bool skip_ejected = false;
+  for (size_t i = 0; i < providers_.size(); i++) {
+    if (offered[i] && !ejected_[i] && provider_callable(providers_[i])) {
+      skip_ejected = true;
+      break;
+    }
+  }
+  for (size_t i = 0; i < providers_.size(); i++) {
+    const provider_t& provider = providers_[i];
+    if (!offered[i] || !provider_callable(provider) ||
+        (skip_ejected && ejected_[i])) {
+      continue;
+    }
+    candidates[0].push_back((int)i);
+    if (orientsec_grpc_consumer_control_version_match(
+            service_name_.c_str(), (char*)provider.version)) {
+      candidates[1].push_back((int)i);
+    }
+  }
+
+  for (int k = 0; k < 2; k++) {
+    std::vector<provider_t>& picked = sets->sets[k].providers_;
+    std::vector<provider_load_stats*>& loads = sets->sets[k].loads_;
+    if (!grouped_) {
+      for (size_t i = 0; i < candidates[k].size(); i++) {
+        picked.push_back(providers_[candidates[k][i]]);
+        loads.push_back(loads_[candidates[k][i]]);
+      }
+      continue;
+    }
+    // 只保留优先级最高且有provider的分组，都没有时集合为空
+    int top = kNoGrade;
+    for (size_t i = 0; i < candidates[k].size(); i++) {
+      int grade = group_grades_[candidates[k][i]];
+      if (grade != kNoGrade && (top == kNoGrade || grade < top)) {
+        top = grade;
+      }
+    }
+    if (top == kNoGrade) {
+      continue;
+    }
+    for (size_t i = 0; i < candidates[k].size(); i++) {
+      if (group_grades_[candidates[k][i]] == top) {
+        picked.push_back(providers_[candidates[k][i]]);
+        loads.push_back(loads_[candidates[k][i]]);
+      }
+    }
+  }
+}
+
+bool provider_snapshot::ejection_changed(int64_t now_us) const {
+  for (size_t i = 0; i < providers_.size(); i++) {
+    bool ejected = loads_[i] != NULL && loads_[i]->outlier()->ejected(now_us);
+    if (ejected != ejected_[i]) {
+      return true;
+    }
+  }
+  return false;
+}
+
+const provider_pick_set* provider_snapshot::pick_set(const char* method_name,
+                                                     bool check_version) const {
+  const pick_sets* sets = &service_sets_;
+  if (method_name != NULL) {
+    pick_set_map::const_iterator iter = method_sets_.find(method_name);
+    sets = (iter == method_sets_.end()) ? &empty_sets_ : iter->second;
+  }
+  return &sets->sets[check_version ? 1 : 0];
+}
+
+provider_snapshot_registry::provider_snapshot_registry()
+    : table_(std::make_shared<provider_snapshot_table>()) {
+  gpr_mu_init(&mu_);
+  gpr_atm_no_barrier_store(&generation_, 0);
+}
+
+provider_snapshot_registry::~provider_snapshot_registry() {
+  gpr_mu_destroy(&mu_);
+}
+
+void provider_snapshot_registry::swap_table_locked(
+    std::shared_ptr<const provider_snapshot_table> table) {
+  table_ = table;
+  gpr_atm_rel_store(&generation_, gpr_atm_no_barrier_load(&generation_) + 1);
+}
+
+void provider_snapshot_registry::publish(const char* service_name,
+                                         const provider_t* providers,
+                                         int num) {
+  if (!service_name) {
+    return;
+  }
+  provider_snapshot_ptr previous;
+  gpr_mu_lock(&mu_);
+  provider_snapshot_table::const_iterator iter = table_->find(service_name);
+  if (iter != table_->end()) {
+    previous = iter->second;
+  }
+  gpr_mu_unlock(&mu_);
+  // build outside of mu_, readers only wait for the pointer swap
+  provider_snapshot_ptr snapshot = std::make_shared<provider_snapshot>(
+      service_name, providers, num, previous.get());
+  gpr_mu_lock(&mu_);
+  std::shared_ptr<provider_snapshot_table> table =
+      std::make_shared<provider_snapshot_table>(*table_);
+  table->erase(service_name);
+  table->insert(std::make_pair(snapshot->service_name(), snapshot));
+  swap_table_locked(table);
+  gpr_mu_unlock(&mu_);
+}
+
+void provider_snapshot_registry::remove(const char* service_name) {
+  if (!service_name) {
+    return;
+  }
+  gpr_mu_lock(&mu_);
+  if (table_->find(service_name) != table_->end()) {
+    std::shared_ptr<provider_snapshot_table> table =
+        std::make_shared<provider_snapshot_table>(*table_);
+    table->erase(service_name);
+    swap_table_locked(table);
+  }
+  gpr_mu_unlock(&mu_);
+}
+
+const provider_snapshot_table* provider_snapshot_registry::pin() const {
+  provider_snapshot_tls& tls = t_snapshot;
+  if (tls.depth == 0 &&
+      (tls.owner != this ||
+       tls.generation != gpr_atm_acq_load(&generation_))) {
+    gpr_mu_lock(&mu_);
+    tls.owner = this;
+    tls.table = table_;
+    tls.generation = gpr_atm_no_barrier_load(&generation_);
+    gpr_mu_unlock(&mu_);
+  }
+  tls.depth++;
+  return tls.table.get();
+}
+
+void provider_snapshot_registry::unpin() const { t_snapshot.depth--; }
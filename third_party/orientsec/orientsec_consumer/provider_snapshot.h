@@ -0,0 +1,251 @@
+/*
+ * Copyright 2019 Orient Securities Co., Ltd.
+ * Copyright 2019 BoCloud Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ *    2026/10/16
+ *    version 1.0
+ *    consumer端provider列表只读快照
+ *    zookeeper回调在持有provider锁时发布新快照，选取provider时无锁读取
+ *    发布时按(方法, 是否校验版本)预先计算可选provider集合，
+ *    方法名在快照内编号，provider提供的方法按位图记录
+ */
+
+#ifndef ORIENTSEC_PROVIDER_SNAPSHOT_H
+#define ORIENTSEC_PROVIDER_SNAPSHOT_H
+
+#include <stdint.h>
+#include <string.h>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <grpc/support/atm.h>
+#include <grpc/support/sync.h>
+#include "consistent_hash.h"
+#include "orientsec_types.h"
+#include "provider_load_stats.h"
+#include "weight_round_robin_lb.h"
+
+struct provider_snapshot_key_less {
+  bool operator()(const char* a, const char* b) const {
+    return strcmp(a, b) < 0;
+  }
+};
+
+// providers of one service that a pick may choose from: not blacklisted,
+// not in failover, online, offering the method (method level lb only),
+// version matched (optional) and in the highest priority group that has any.
+// The array is contiguous so it can be handed to the lb algorithms as is.
+class provider_pick_set {
+ public:
+  provider_pick_set();
+  ~provider_pick_set();
+
+  // the lb algorithms take a non const array, none of them modifies it
+  provider_t* providers() const {
+    return providers_.empty() ? NULL
+                              : const_cast<provider_t*>(&providers_[0]);
+  }
+  int size() const { return (int)providers_.size(); }
+
+  // weight_round_robin schedule over providers(), built on the first
+  // weighted pick. Once built, later snapshots build theirs when they are
+  // published, reusing the previous sequence if the weights are unchanged.
+  const wrr_schedule* wrr() const;
+
+  // consistent hash ring over providers(), built on the first consistent
+  // hash pick and then shared read only like the set itself. Once built,
+  // later snapshots update it incrementally when they are published, so
+  // picks do not rebuild it after membership changes.
+  const consistent_hash_ring* hash_ring() const;
+
+  // load stats parallel to providers(), resolved when the set is built
+  provider_load_stats* const* loads() const {
+    return loads_.empty() ? NULL : &loads_[0];
+  }
+
+ private:
+  friend class provider_snapshot;
+  provider_pick_set(const provider_pick_set&);
+  provider_pick_set& operator=(const provider_pick_set&);
+
+  // builds the lb state the previous snapshot's set had already built
+  void inherit(const provider_pick_set& previous);
+
+  std::vector<provider_t> providers_;
+  std::vector<provider_load_stats*> loads_;
+  mutable gpr_atm wrr_;        // wrr_schedule*
+  mutable gpr_atm hash_ring_;  // consistent_hash_ring*
+};
+
+// set of method ids, one bit per method interned by the snapshot
+class provider_method_bits {
+ public:
+  void set(size_t id) {
+    if (words_.size() <= id / 64) {
+      words_.resize(id / 64 + 1, 0);
+    }
+    words_[id / 64] |= (uint64_t)1 << (id % 64);
+  }
+  bool test(size_t id) const {
+    return id / 64 < words_.size() && ((words_[id / 64] >> (id % 64)) & 1);
+  }
+
+ private:
+  std::vector<uint64_t> words_;
+};
+
+// immutable copy of the live (flag_invalid == 0) providers of one service.
+// pointer members of the copied provider_t are cleared, except methods and
+// sInterface which point into strings owned by the snapshot.
+class provider_snapshot {
+ public:
+  // previous is the snapshot being replaced, or NULL
+  provider_snapshot(const char* service_name, const provider_t* providers,
+                    int num, const provider_snapshot* previous);
+  ~provider_snapshot();
+
+  const char* service_name() const { return service_name_.c_str(); }
+  const provider_t* providers() const {
+    return providers_.empty() ? NULL : &providers_[0];
+  }
+  int size() const { return (int)providers_.size(); }
+  // load stats parallel to providers(), resolved when the snapshot is built
+  provider_load_stats* const* loads() const {
+    return loads_.empty() ? NULL : &loads_[0];
+  }
+
+  // true when a provider was ejected or returned after the snapshot was
+  // built, the snapshot then has to be republished
+  bool ejection_changed(int64_t now_us) const;
+
+  // method_name == NULL selects the service level set. Never returns NULL,
+  // a method no provider offers gets an empty set.
+  const provider_pick_set* pick_set(const char* method_name,
+                                    bool check_version) const;
+
+  // 服务治理状态，发布时统计
+  // not blacklisted, not in failover and subchannel not closed
+  int callable_count() const { return callable_count_; }
+  // not blacklisted, not in failover and version matched
+  int version_matched_count() const { return version_matched_count_; }
+  // not blacklisted, not in failover and master
+  int active_count() const { return active_count_; }
+
+ private:
+  provider_snapshot(const provider_snapshot&);
+  provider_snapshot& operator=(const provider_snapshot&);
+
+  // [0] without, [1] with service version check
+  struct pick_sets {
+    provider_pick_set sets[2];
+  };
+  // methods offering the same providers share one pick_sets, values point
+  // either to service_sets_ or into owned_sets_
+  typedef std::map<const char*, const pick_sets*, provider_snapshot_key_less>
+      pick_set_map;
+
+  // offered[i] marks whether providers_[i] offers the method
+  void build_pick_sets(pick_sets* sets, const std::vector<bool>& offered);
+  void inherit_pick_sets(const provider_snapshot* previous);
+
+  std::string service_name_;
+  std::vector<provider_t> providers_;
+  std::vector<provider_load_stats*> loads_;
+  std::vector<std::string> methods_;
+  // 方法名 => 方法ID，快照内有效
+  std::map<std::string, size_t> method_ids_;
+  std::vector<provider_method_bits> method_bits_;  // parallel to providers_
+  // 分组优先级，parallel to providers_，不在配置分组中的为-1
+  std::vector<int> group_grades_;
+  bool grouped_;
+  // 发布时处于离群摘除中，parallel to providers_
+  std::vector<bool> ejected_;
+  pick_sets service_sets_;
+  pick_set_map method_sets_;
+  std::vector<pick_sets*> owned_sets_;
+  pick_sets empty_sets_;
+  int callable_count_;
+  int version_matched_count_;
+  int active_count_;
+};
+
+typedef std::shared_ptr<const provider_snapshot> provider_snapshot_ptr;
+
+// service name => snapshot, keys point into the snapshot's own service name
+typedef std::map<const char*, provider_snapshot_ptr, provider_snapshot_key_less>
+    provider_snapshot_table;
+
+// RCU style holder of all service snapshots.
+// Writers serialize on the providers list lock of the caller, build a new
+// table and bump the generation. Readers keep a thread local reference to the
+// last table they saw and only take the (short) publish mutex when the
+// generation moved, so picks never contend with each other.
+class provider_snapshot_registry {
+ public:
+  provider_snapshot_registry();
+  ~provider_snapshot_registry();
+
+  // replace the snapshot of service_name with a copy of providers[0..num)
+  void publish(const char* service_name, const provider_t* providers, int num);
+  void remove(const char* service_name);
+
+  gpr_atm generation() const { return gpr_atm_acq_load(&generation_); }
+
+ private:
+  friend class provider_snapshot_guard;
+
+  // refreshes the thread local table unless an outer guard pinned it
+  const provider_snapshot_table* pin() const;
+  void unpin() const;
+  void swap_table_locked(std::shared_ptr<const provider_snapshot_table> table);
+
+  mutable gpr_mu mu_;
+  std::shared_ptr<const provider_snapshot_table> table_;
+  mutable gpr_atm generation_;
+};
+
+// pins the calling thread's view of the registry. Snapshots returned by get()
+// stay valid until the outermost guard of the thread goes out of scope, no
+// reference counts are touched on the read path.
+class provider_snapshot_guard {
+ public:
+  explicit provider_snapshot_guard(const provider_snapshot_registry& registry)
+      : registry_(registry), table_(registry.pin()) {}
+  ~provider_snapshot_guard() { registry_.unpin(); }
+
+  // returns NULL if the service has no snapshot yet
+  const provider_snapshot* get(const char* service_name) const {
+    if (!service_name) {
+      return NULL;
+    }
+    provider_snapshot_table::const_iterator iter = table_->find(service_name);
+    return iter == table_->end() ? NULL : iter->second.get();
+  }
+
+  const provider_snapshot_table& table() const { return *table_; }
+
+ private:
+  provider_snapshot_guard(const provider_snapshot_guard&);
+  provider_snapshot_guard& operator=(const provider_snapshot_guard&);
+
+  const provider_snapshot_registry& registry_;
+  const provider_snapshot_table* table_;
+};
+
+#endif  // !ORIENTSEC_PROVIDER_SNAPSHOT_H
@@ -0,0 +1,355 @@
+/*
+ * Copyright 2019 Orient Securities Co., Ltd.
+ * Copyright 2019 BoCloud Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ *    2026/10/16
+ *    version 1.0
+ *    consumer端注册中心本地快照实现
+ */
+
+#include "registry_snapshot_file.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#include <grpc/support/log.h>
+#include "orientsec_grpc_utils.h"
+#include "registry_contants.h"
+
+#if (defined WIN64) || (defined WIN32)
+#include <direct.h>
+#include <io.h>
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+const uint64_t kFnvOffset = 14695981039346656037ULL;
+const uint64_t kFnvPrime = 1099511628211ULL;
+
+uint64_t fnv1a(uint64_t hash, const void* data, size_t len) {
+  const unsigned char* p = (const unsigned char*)data;
+  for (size_t i = 0; i < len; i++) {
+    hash ^= p[i];
+    hash *= kFnvPrime;
+  }
+  return hash;
+}
+
+uint64_t snapshot_checksum(const registry_snapshot_header* header,
+                           const char* body) {
+  uint64_t hash = fnv1a(kFnvOffset, header->counts, sizeof(header->counts));
+  return fnv1a(hash, body, (size_t)header->body_len);
+}
+
+// 子节点解析时保留了原始串，优先使用
+std::string url_snapshot_string(url_t* url) {
+  if (url->href != NULL) {
+    return url->href;
+  }
+  char buf[ORIENTSEC_GRPC_URL_MAX_LEN] = {0};
+  if (url_to_string_buf(url, buf, ORIENTSEC_GRPC_URL_MAX_LEN) != 0) {
+    return std::string();
+  }
+  return buf;
+}
+
+bool is_empty_url(const url_t* url) {
+  return url->protocol != NULL &&
+         0 == strcmp(url->protocol, ORIENTSEC_GRPC_EMPTY_PROTOCOL);
+}
+
+// 只读映射整个文件，失败返回NULL
+class mapped_file {
+ public:
+  explicit mapped_file(const char* path) : data_(NULL), len_(0) {
+#if (defined WIN64) || (defined WIN32)
+    file_ = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, NULL,
+                        OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    mapping_ = NULL;
+    if (file_ == INVALID_HANDLE_VALUE) {
+      return;
+    }
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(file_, &size) || size.QuadPart == 0) {
+      return;
+    }
+    mapping_ = CreateFileMappingA(file_, NULL, PAGE_READONLY, 0, 0, NULL);
+    if (mapping_ == NULL) {
+      return;
+    }
+    data_ = (const char*)MapViewOfFile(mapping_, FILE_MAP_READ, 0, 0, 0);
+    if (data_ != NULL) {
+      len_ = (size_t)size.QuadPart;
+    }
+#else
+    fd_ = open(path, O_RDONLY);
+    if (fd_ < 0) {
+      return;
+    }
+    struct stat st;
+    if (fstat(fd_, &st) != 0 || st.st_size == 0) {
+      return;
+    }
+    void* p = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd_, 0);
+    if (p != MAP_FAILED) {
+      data_ = (const char*)p;
+      len_ = (size_t)st.st_size;
+    }
+#endif
+  }
+
+  ~mapped_file() {
+#if (defined WIN64) || (defined WIN32)
+    if (data_ != NULL) UnmapViewOfFile(data_);
+    if (mapping_ != NULL) CloseHandle(mapping_);
+    if (file_ != INVALID_HANDLE_VALUE) CloseHandle(file_);
+#else
+    if (data_ != NULL) munmap((void*)data_, len_);
+    if (fd_ >= 0) close(fd_);
+#endif
+  }
+
+  const char* data() const { return data_; }
+  size_t size() const { return len_; }
+
+ private:
+  mapped_file(const mapped_file&);
+  mapped_file& operator=(const mapped_file&);
+
+  const char* data_;
+  size_t len_;
+#if (defined WIN64) || (defined WIN32)
+  HANDLE file_;
+  HANDLE mapping_;
+#else
+  int fd_;
+#endif
+};
+
+// 写入临时文件并刷盘后改名，读到的要么是旧快照要么是完整的新快照
+bool write_file_atomic(const std::string& path, const std::string& content) {
+  char suffix[32];
+  snprintf(suffix, sizeof(suffix), ".tmp.%d", grpc_getpid());
+  std::string tmp_path = path + suffix;
+  FILE* fp = fopen(tmp_path.c_str(), "wb");
+  if (fp == NULL) {
+    return false;
+  }
+  bool ok = fwrite(content.data(), 1, content.size(), fp) == content.size() &&
+            fflush(fp) == 0;
+#if (defined WIN64) || (defined WIN32)
+  ok = ok && _commit(_fileno(fp)) == 0;
+#else
+  ok = ok && fsync(fileno(fp)) == 0;
+#endif
+  ok = (fclose(fp) == 0) && ok;
+#if (defined WIN64) || (defined WIN32)
+  ok = ok && MoveFileExA(tmp_path.c_str(), path.c_str(),
+                         MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH);
+#else
+  ok = ok && rename(tmp_path.c_str(), path.c_str()) == 0;
+#endif
+  if (!ok) {
+    remove(tmp_path.c_str());
+  }
+  return ok;
+}
+
+}  // namespace
+
+registry_snapshot_store::registry_snapshot_store() { gpr_mu_init(&mu_); }
+
+registry_snapshot_store::~registry_snapshot_store() { gpr_mu_destroy(&mu_); }
+
+void registry_snapshot_store::set_dir(const char* dir) {
+  gpr_mu_lock(&mu_);
+  dir_ = dir == NULL ? "" : dir;
+  while (dir_.size() > 1 && (dir_[dir_.size() - 1] == '/' ||
+                             dir_[dir_.size() - 1] == '\\')) {
+    dir_.erase(dir_.size() - 1);
+  }
+  if (!dir_.empty()) {
+#if (defined WIN64) || (defined WIN32)
+    _mkdir(dir_.c_str());
+#else
+    mkdir(dir_.c_str(), 0755);
+#endif
+  }
+  gpr_mu_unlock(&mu_);
+}
+
+bool registry_snapshot_store::enabled() {
+  gpr_mu_lock(&mu_);
+  bool ret = !dir_.empty();
+  gpr_mu_unlock(&mu_);
+  return ret;
+}
+
+std::string registry_snapshot_store::file_path(
+    const std::string& service_name) const {
+  std::string name = service_name;
+  for (size_t i = 0; i < name.size(); i++) {
+    if (name[i] == '/' || name[i] == '\\' || name[i] == ':') {
+      name[i] = '_';
+    }
+  }
+  return dir_ + PATH_SEPRATOR + name + REGISTRY_SNAPSHOT_SUFFIX;
+}
+
+void registry_snapshot_store::update(int category, url_t* urls, int url_num) {
+  if (category < 0 || category >= REGISTRY_SNAPSHOT_CATEGORY_NUM ||
+      urls == NULL || url_num <= 0 || urls[0].path == NULL) {
+    return;
+  }
+  url_set next;
+  if (!is_empty_url(&urls[0])) {
+    for (int i = 0; i < url_num; i++) {
+      std::string s = url_snapshot_string(&urls[i]);
+      if (!s.empty()) {
+        next.insert(s);
+      }
+    }
+  }
+  gpr_mu_lock(&mu_);
+  if (!dir_.empty()) {
+    service_state& state = services_[urls[0].path];
+    if (state.urls[category] != next) {
+      state.urls[category].swap(next);
+      write_locked(urls[0].path, state);
+    }
+  }
+  gpr_mu_unlock(&mu_);
+}
+
+void registry_snapshot_store::update_delta(int category, url_t* added,
+                                           int added_num, url_t* removed,
+                                           int removed_num) {
+  if (category < 0 || category >= REGISTRY_SNAPSHOT_CATEGORY_NUM) {
+    return;
+  }
+  url_t* any = added_num > 0 ? added : (removed_num > 0 ? removed : NULL);
+  if (any == NULL || any->path == NULL) {
+    return;
+  }
+  bool changed = false;
+  gpr_mu_lock(&mu_);
+  if (!dir_.empty()) {
+    url_set& urls = services_[any->path].urls[category];
+    for (int i = 0; i < removed_num; i++) {
+      changed |= urls.erase(url_snapshot_string(&removed[i])) > 0;
+    }
+    for (int i = 0; i < added_num; i++) {
+      std::string s = url_snapshot_string(&added[i]);
+      changed |= !s.empty() && urls.insert(s).second;
+    }
+    if (changed) {
+      write_locked(any->path, services_[any->path]);
+    }
+  }
+  gpr_mu_unlock(&mu_);
+}
+
+void registry_snapshot_store::write_locked(const std::string& service_name,
+                                           const service_state& state) {
+  registry_snapshot_header header;
+  memset(&header, 0, sizeof(header));
+  memcpy(header.magic, REGISTRY_SNAPSHOT_MAGIC, sizeof(header.magic));
+  header.version = REGISTRY_SNAPSHOT_VERSION;
+  std::string body;
+  for (int c = 0; c < REGISTRY_SNAPSHOT_CATEGORY_NUM; c++) {
+    header.counts[c] = (uint32_t)state.urls[c].size();
+    for (url_set::const_iterator it = state.urls[c].begin();
+         it != state.urls[c].end(); ++it) {
+      body.append(it->c_str(), it->size() + 1);
+    }
+  }
+  header.body_len = body.size();
+  header.checksum = snapshot_checksum(&header, body.data());
+  std::string content((const char*)&header, sizeof(header));
+  content.append(body);
+  std::string path = file_path(service_name);
+  if (!write_file_atomic(path, content)) {
+    gpr_log(GPR_ERROR, "write registry snapshot %s failed", path.c_str());
+  }
+}
+
+bool registry_snapshot_store::load(
+    const char* service_name,
+    std::vector<std::string> urls[REGISTRY_SNAPSHOT_CATEGORY_NUM]) {
+  if (service_name == NULL) {
+    return false;
+  }
+  gpr_mu_lock(&mu_);
+  if (dir_.empty()) {
+    gpr_mu_unlock(&mu_);
+    return false;
+  }
+  std::string path = file_path(service_name);
+  mapped_file file(path.c_str());
+  const char* data = file.data();
+  registry_snapshot_header header;
+  bool ok = data != NULL && file.size() >= sizeof(header);
+  if (ok) {
+    memcpy(&header, data, sizeof(header));
+    ok = 0 == memcmp(header.magic, REGISTRY_SNAPSHOT_MAGIC,
+                     sizeof(header.magic)) &&
+         header.version == REGISTRY_SNAPSHOT_VERSION &&
+         header.body_len == file.size() - sizeof(header) &&
+         header.checksum == snapshot_checksum(&header, data + sizeof(header));
+  }
+  if (!ok) {
+    if (data != NULL) {
+      gpr_log(GPR_ERROR, "registry snapshot %s is corrupted, ignored",
+              path.c_str());
+    }
+    gpr_mu_unlock(&mu_);
+    return false;
+  }
+  // 校验通过后body以'\0'结尾，逐个取出url串
+  const char* p = data + sizeof(header);
+  const char* end = p + header.body_len;
+  service_state state;
+  for (int c = 0; c < REGISTRY_SNAPSHOT_CATEGORY_NUM && ok; c++) {
+    for (uint32_t i = 0; i < header.counts[c]; i++) {
+      const char* next = (const char*)memchr(p, '\0', end - p);
+      if (next == NULL) {
+        ok = false;
+        break;
+      }
+      urls[c].push_back(std::string(p, next - p));
+      state.urls[c].insert(urls[c].back());
+      p = next + 1;
+    }
+  }
+  if (ok) {
+    services_[service_name] = state;
+  } else {
+    for (int c = 0; c < REGISTRY_SNAPSHOT_CATEGORY_NUM; c++) {
+      urls[c].clear();
+    }
+    gpr_log(GPR_ERROR, "registry snapshot %s is corrupted, ignored",
+            path.c_str());
+  }
+  gpr_mu_unlock(&mu_);
+  return ok;
+}
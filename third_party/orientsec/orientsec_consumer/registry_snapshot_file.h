@@ -0,0 +1,99 @@
+/*
+ * Copyright 2019 Orient Securities Co., Ltd.
+ * Copyright 2019 BoCloud Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ *    2026/10/16
+ *    version 1.0
+ *    consumer端注册中心本地快照
+ *    每个服务一个文件，保存最近一次收到的providers、routers、configurators
+ *    url串。启动时在订阅前恢复，注册中心不可用时继续使用快照中的内容。
+ *    文件格式：定长头部之后依次为各目录下以'\0'结尾的url串，可直接mmap读取
+ */
+
+#ifndef ORIENTSEC_REGISTRY_SNAPSHOT_FILE_H
+#define ORIENTSEC_REGISTRY_SNAPSHOT_FILE_H
+
+#include <stdint.h>
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+
+#include <grpc/support/sync.h>
+#include "url.h"
+
+#define REGISTRY_SNAPSHOT_MAGIC "OSGRSNAP"
+#define REGISTRY_SNAPSHOT_VERSION 1
+#define REGISTRY_SNAPSHOT_SUFFIX ".snapshot"
+
+enum registry_snapshot_category {
+  REGISTRY_SNAPSHOT_PROVIDERS = 0,
+  REGISTRY_SNAPSHOT_ROUTERS,
+  REGISTRY_SNAPSHOT_CONFIGURATORS,
+  REGISTRY_SNAPSHOT_CATEGORY_NUM
+};
+
+// file header, all fields in host byte order: the snapshot is only read
+// back by the process that wrote it or its successor on the same host
+struct registry_snapshot_header {
+  char magic[8];
+  uint32_t version;
+  uint32_t counts[REGISTRY_SNAPSHOT_CATEGORY_NUM];  // 各目录下的url个数
+  uint64_t body_len;
+  uint64_t checksum;  // FNV-1a 64，覆盖counts及body
+};
+
+class registry_snapshot_store {
+ public:
+  registry_snapshot_store();
+  ~registry_snapshot_store();
+
+  // 快照目录，为空时不读写快照，目录不存在时创建
+  void set_dir(const char* dir);
+  bool enabled();
+
+  // 全量替换某服务一个目录下的url，empty协议的url表示该目录已清空。
+  // 内容有变化时重写快照文件
+  void update(int category, url_t* urls, int url_num);
+  // 按增量更新providers等目录
+  void update_delta(int category, url_t* added, int added_num, url_t* removed,
+                    int removed_num);
+
+  // 读取并校验服务的快照文件，成功时返回各目录下的url串，
+  // 并以文件内容作为之后增量更新的基础
+  bool load(const char* service_name,
+            std::vector<std::string> urls[REGISTRY_SNAPSHOT_CATEGORY_NUM]);
+
+ private:
+  registry_snapshot_store(const registry_snapshot_store&);
+  registry_snapshot_store& operator=(const registry_snapshot_store&);
+
+  typedef std::set<std::string> url_set;
+  struct service_state {
+    url_set urls[REGISTRY_SNAPSHOT_CATEGORY_NUM];
+  };
+
+  std::string file_path(const std::string& service_name) const;
+  void write_locked(const std::string& service_name,
+                    const service_state& state);
+
+  gpr_mu mu_;
+  std::string dir_;
+  std::map<std::string, service_state> services_;
+};
+
+#endif  // !ORIENTSEC_REGISTRY_SNAPSHOT_FILE_H
@@ -16,136 +16,65 @@
  */
 
 #include "requests_controller_utils.h"
-#include "grpc/impl/codegen/atm.h"
 #include "orientsec_grpc_utils.h"
 
-void requests_controller_utils::SetMaxRequestMap(std::string service_name, long maxRequest) {
+requests_controller_utils::requests_controller_utils() {
+	gpr_mu_init(&mu_);
+}
+
+requests_controller_utils::~requests_controller_utils() {
+	gpr_mu_destroy(&mu_);
+}
+
+void requests_controller_utils::SetMaxRequest(const std::string& service_name, bool local_ip, long maxRequest) {
 	if (service_name.empty())
 	{
 		return;
 	}
-	std::string sn_localip_key = service_name + std::string(get_local_ip());
-	std::map<std::string, long>::iterator max_request_iter = max_request_vec_.find(sn_localip_key);
-	if (max_request_iter != max_request_vec_.end())
+	if (maxRequest < 0)
 	{
-		if (maxRequest == 0)
-		{
-			max_request_vec_.erase(max_request_iter);
-		}
-		else {
-			gpr_atm_rel_store((gpr_atm*)&max_request_iter->second, maxRequest);
-		}
+		maxRequest = 0;
 	}
-	else {
-		if (maxRequest > 0)
-		{
-			max_request_vec_.insert(std::pair<std::string, long>(sn_localip_key, maxRequest));
-		}
+	gpr_mu_lock(&mu_);
+	std::map<std::string, requests_limit_rule>::iterator iter = rules_.find(service_name);
+	if (iter == rules_.end())
+	{
+		requests_limit_rule rule;
+		rule.local_ip_limit = 0;
+		rule.any_limit = 0;
+		iter = rules_.insert(std::make_pair(service_name, rule)).first;
 	}
-
-	max_request_iter = max_request_vec_.find(service_name);
-	if (max_request_iter != max_request_vec_.end())
+	if (local_ip)
 	{
-		if (maxRequest == 0)
-		{
-			max_request_vec_.erase(max_request_iter);
-		}
-		else {
-			gpr_atm_rel_store((gpr_atm*)&max_request_iter->second, maxRequest);
-		}
+		iter->second.local_ip_limit = maxRequest;
 	}
 	else {
-		if (maxRequest > 0)
-		{
-			max_request_vec_.insert(std::pair<std::string, long>(service_name, maxRequest));
-		}
+		iter->second.any_limit = maxRequest;
 	}
-
-}
-
-bool requests_controller_utils::CheckRequestInner(std::map<std::string, long>::iterator max_request_iter,
-	std::string service_name, uint64_t current_time) {
-	if (max_request_iter != max_request_vec_.end())
+	//两种规则都已删除
+	if (iter->second.effective() <= 0)
 	{
-		long max_request = gpr_atm_acq_load((gpr_atm*)&max_request_iter->second);
-		if (max_request <= 0)
-		{
-			return true;;
-		}
-		std::map<std::string, long>::iterator request_num_iter = request_num_counters_vec_.find(service_name);
-		long current_request_num = 0;
-		if (request_num_iter != request_num_counters_vec_.end())
-		{
-			current_request_num = request_num_iter->second;
-			uint64_t last_time = 0;
-			std::map<std::string, uint64_t>::iterator last_invoke_time_iter = last_invoke_time_vec_.find(service_name);
-			if (last_invoke_time_iter != last_invoke_time_vec_.end())
-			{
-				last_time = last_invoke_time_iter->second;
-			}
-			if (current_time - last_time > 1000)//已经 超过1s，重置计数
-			{
-				if (last_invoke_time_iter != last_invoke_time_vec_.end())
-				{
-					last_invoke_time_vec_.erase(last_invoke_time_iter);
-				}
-				last_invoke_time_vec_.insert(std::pair<std::string, uint64_t>(service_name, current_time));
-				gpr_atm_rel_store((gpr_atm*)&request_num_iter->second, 0);
-			}
-		}
-		else {
-			request_num_counters_vec_.insert(std::pair<std::string, uint64_t>(service_name, 0));
-			request_num_iter = request_num_counters_vec_.find(service_name);
-		}
-		if (gpr_atm_acq_load((gpr_atm*)&request_num_iter->second) <
-			gpr_atm_acq_load((gpr_atm*)&max_request_iter->second))
-		{
-			gpr_atm_full_fetch_add((gpr_atm*)&request_num_iter->second, 1);
-			return true;
-		}
-		else {
-			return false;
-		}
-
+		rules_.erase(iter);
 	}
-	return true;
+	gpr_mu_unlock(&mu_);
 }
 
-bool requests_controller_utils::CheckRequest(std::string service_name) {
-	if (service_name.empty())
-	{
-		return true;
-	}
-	std::string sn_localip_key = service_name + std::string(get_local_ip());
-	uint64_t current_time = orientsec_get_timestamp_in_mills();
-	////首先检查是否检查确定IP的流量控制
-	std::map<std::string, long>::iterator max_request_iter = max_request_vec_.find(sn_localip_key);
-	if (max_request_iter != max_request_vec_.end())
-	{
-		return CheckRequestInner(max_request_iter, service_name, current_time);
-	}
-
-	//检查有0.0.0.0通用IP指定的规则
-	max_request_iter = max_request_vec_.find(service_name);
-	if (max_request_iter != max_request_vec_.end())
-	{
-		return CheckRequestInner(max_request_iter, service_name, current_time);
-	}
-	return true;
+void requests_controller_utils::SetMaxRequestMap(std::string service_name, long maxRequest) {
+	SetMaxRequest(service_name, false, maxRequest);
 }
 
-void requests_controller_utils::DecreaseRequest(std::string service_name) {
-	if (service_name.empty())
+long requests_controller_utils::GetMaxRequest(const char* service_name) const {
+	if (service_name == NULL)
 	{
-		return;
+		return 0;
 	}
-	std::map<std::string, long>::iterator request_num_iter = request_num_counters_vec_.find(service_name);
-	if (request_num_iter != request_num_counters_vec_.end())
+	long max_request = 0;
+	gpr_mu_lock(&mu_);
+	std::map<std::string, requests_limit_rule>::const_iterator iter = rules_.find(service_name);
+	if (iter != rules_.end())
 	{
-		gpr_atm_full_fetch_add((gpr_atm*)&request_num_iter->second, -1);
-		if (gpr_atm_acq_load((gpr_atm*)&request_num_iter->second) < 0)
-		{
-			gpr_atm_rel_store((gpr_atm*)&request_num_iter->second, 0);
-		}
+		max_request = iter->second.effective();
 	}
+	gpr_mu_unlock(&mu_);
+	return max_request;
 }
@@ -22,27 +22,44 @@
 #include<map>
 #include<string>
 
+#include <grpc/support/sync.h>
+
 #ifdef __cplusplus
 extern "C" {
 #endif
 
+	// 某服务的限流规则，<=0表示没有该规则
+	struct requests_limit_rule {
+		long local_ip_limit;  // 针对本机IP的规则，优先
+		long any_limit;       // 0.0.0.0通用规则
+
+		long effective() const { return local_ip_limit > 0 ? local_ip_limit : any_limit; }
+	};
+
+	// 服务请求数规则。
+	// 只在配置回调中按本机IP规则优先的原则计算生效值，限流本身由
+	// orientsec_grpc_consumer_control_requests的令牌桶执行，调用路径不读取本表
 	class requests_controller_utils
 	{
 
 	public:
-		requests_controller_utils() {};
-		~requests_controller_utils() {};
+		requests_controller_utils();
+		~requests_controller_utils();
+
+		// local_ip为true时是针对本机IP的规则，否则为0.0.0.0通用规则，maxRequest<=0删除规则
+		void SetMaxRequest(const std::string& service_name, bool local_ip, long maxRequest);
+		// 兼容原接口，设置通用规则
 		void SetMaxRequestMap(std::string service_name, long maxRequest);
-		//检查某服务的单位时间内的请求数是否小于最大请求数，满足条件返回true，否则返回false
-		bool CheckRequest(std::string service_name);
-		void DecreaseRequest(std::string service_name);
+		// 本机生效的最大请求数，没有规则时返回0
+		long GetMaxRequest(const char* service_name) const;
 
 	private:
-		bool CheckRequestInner(std::map<std::string, long>::iterator max_request_iter, std::string service_name, uint64_t current_time);
+		requests_controller_utils(const requests_controller_utils&);
+		requests_controller_utils& operator=(const requests_controller_utils&);
+
 	private:
-		std::map<std::string, long> max_request_vec_;
-		std::map<std::string, uint64_t> last_invoke_time_vec_;
-		std::map<std::string, long> request_num_counters_vec_;
+		mutable gpr_mu mu_;
+		std::map<std::string, requests_limit_rule> rules_;
 	};
 
 #ifdef __cplusplus
@@ -50,5 +67,3 @@ extern "C" {
 #endif
 
 #endif
-
-
@@ -35,7 +35,7 @@
 
 round_robin_lb::round_robin_lb()
 {
-	subchannlecursors = 0;
+	gpr_atm_no_barrier_store(&subchannlecursors, 0);
 }
 
 
@@ -44,7 +44,7 @@ round_robin_lb::~round_robin_lb()
 	cursors.clear();
 }
 
-void round_robin_lb::set_providers(std::map<std::string, provider_t* > *_providers) {
+void round_robin_lb::set_providers(std::map<std::string, provider_list*> *_providers) {
 	this->providers = _providers;
 }
 
@@ -64,12 +64,12 @@ provider_t* round_robin_lb::choose_provider(const char* sn, int step) {
 	}
 	int index = -1, index_org = -1;
 	int size = 0;
-	std::map<std::string, provider_t* >::iterator provider_iter = providers->find(sn);
+	std::map<std::string, provider_list*>::iterator provider_iter = providers->find(sn);
 	if (provider_iter == providers->end())
 	{
 		return NULL;
 	}
-	size = orientsec_grpc_cache_provider_count_get();
+	size = provider_iter->second->size();
 	if (size == 0) {
 		return NULL;
 	}
@@ -91,10 +91,10 @@ provider_t* round_robin_lb::choose_provider(const char* sn, int step) {
 	//找出从index开始第一个不在黑名单中的provider,并且版本匹配的服务
 	while (do_while)
 	{
-		is_invalid = is_provider_invalid(&provider_iter->second[index]);
+		is_invalid = is_provider_invalid(&provider_iter->second->at(index));
 		if (is_invalid == false) { //查找到未禁用的服务
 			//根据服务名和版本号校验是否匹配
-			if (orientsec_grpc_consumer_control_version_match(provider_iter->second[index].sInterface, provider_iter->second[index].version) == true) {
+			if (orientsec_grpc_consumer_control_version_match(provider_iter->second->at(index).sInterface, provider_iter->second->at(index).version) == true) {
 				index_valid = index;
 				break;   //找到未禁用，并且版本匹配的服务
 			}
@@ -114,7 +114,7 @@ provider_t* round_robin_lb::choose_provider(const char* sn, int step) {
 		}
 	}
 	curIter->second = index_valid;
-	return clone_provider(&provider_iter->second[index_valid]);
+	return clone_provider(&provider_iter->second->at(index_valid));
 }
 
 int round_robin_lb::choose_subchannel(const char* sn, provider_t *provider, const int*nums) {//sn="service_name"
@@ -124,12 +124,7 @@ int round_robin_lb::choose_subchannel(const char* sn, provider_t *provider, cons
   if (provider == NULL || *nums == 0) {
     return 0;
   }
-  int index = -1;
-  int size = *nums;
-  index = subchannlecursors;
-  index = (index + 1) % size;
-  subchannlecursors++;
-  if (subchannlecursors > *nums - 1)
-    subchannlecursors = 0;
-  return  index;
+  size_t size = (size_t)*nums;
+  size_t cursor = (size_t)gpr_atm_no_barrier_fetch_add(&subchannlecursors, 1);
+  return (int)((cursor + 1) % size);
 }
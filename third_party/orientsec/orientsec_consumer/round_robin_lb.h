@@ -26,6 +26,7 @@
 #define ORIENTSEC_GRPC_ROUNDROBIN_H
 
 #include "orientsec_loadbalance.h"
+#include <grpc/support/atm.h>
 #include<map>
 #include<vector>
 
@@ -41,7 +42,7 @@ extern "C" {
 		~round_robin_lb();
 
 		//void setProviders(std::map<std::string, std::vector<provider_t*> > *_providers);
-		void set_providers(std::map<std::string, provider_t*> *_providers);
+		void set_providers(std::map<std::string, provider_list*> *_providers);
 		void reset_cursor(const char* sn);
 
 		int choose_subchannel(const char* sn, provider_t *provider, const int*nums);
@@ -49,11 +50,11 @@ extern "C" {
 		provider_t* choose_provider(const char* sn, int step = 0);
 	private:
 		//std::map<std::string, std::vector<provider_t*> > *providers;
-		std::map<std::string, provider_t*> *providers;
+		std::map<std::string, provider_list*> *providers;
 		//某服务的选择的provider位置
 		std::map<std::string, int> cursors;
-		//某服务的选择的subchannle位置
-		int subchannlecursors;
+		//某服务的选择的subchannle位置,选取时不持有全局锁,使用原子操作
+		gpr_atm subchannlecursors;
 	};
 
 #ifdef __cplusplus
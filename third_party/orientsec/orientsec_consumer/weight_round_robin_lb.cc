@@ -31,6 +31,94 @@
 //addbylm
 #include "src/core/ext/filters/client_channel/lb_policy_registry.h"
 
+namespace {
+
+int wrr_gcd(int a, int b) {
+	while (b != 0) {
+		int t = a % b;
+		a = b;
+		b = t;
+	}
+	return a;
+}
+
+}  // namespace
+
+wrr_schedule::wrr_schedule(const provider_t* providers, int num)
+{
+	build(providers, num, NULL);
+}
+
+wrr_schedule::wrr_schedule(const provider_t* providers, int num, const wrr_schedule* previous)
+{
+	build(providers, num, previous);
+}
+
+void wrr_schedule::build(const provider_t* providers, int num, const wrr_schedule* previous)
+{
+	gpr_atm_no_barrier_store(&cursor_, 0);
+	if (providers == NULL || num <= 0) {
+		return;
+	}
+	//权重小于0按0处理，全为0时等权
+	std::vector<int>& weights = weights_;
+	weights.resize(num);
+	int divisor = 0;
+	for (int i = 0; i < num; i++) {
+		weights[i] = providers[i].weight > 0 ? providers[i].weight : 0;
+		divisor = wrr_gcd(weights[i], divisor);
+	}
+	if (divisor == 0) {
+		weights.assign(num, 1);
+		divisor = 1;
+	}
+	long long total = 0;
+	for (int i = 0; i < num; i++) {
+		weights[i] /= divisor;
+		total += weights[i];
+	}
+	if (total > ORIENTSEC_GRPC_WRR_MAX_SEQUENCE) {
+		long long scaled = 0;
+		for (int i = 0; i < num; i++) {
+			if (weights[i] > 0) {
+				long long w = (long long)weights[i] * ORIENTSEC_GRPC_WRR_MAX_SEQUENCE / total;
+				weights[i] = w > 0 ? (int)w : 1;
+			}
+			scaled += weights[i];
+		}
+		total = scaled;
+	}
+	//权重未变化时序列相同，直接复制，并从原游标继续，避免每次发布都回到序列开头
+	if (previous != NULL && previous->weights_ == weights) {
+		sequence_ = previous->sequence_;
+		gpr_atm_no_barrier_store(&cursor_, gpr_atm_no_barrier_load(&previous->cursor_));
+		return;
+	}
+	//与原curr_weight算法相同，一个周期内每个provider恰好被选中weight次且分布平滑
+	std::vector<long long> curr_weight(num, 0);
+	sequence_.reserve((size_t)total);
+	for (long long n = 0; n < total; n++) {
+		int index = -1;
+		for (int i = 0; i < num; i++) {
+			curr_weight[i] += weights[i];
+			if (index == -1 || curr_weight[index] < curr_weight[i]) {
+				index = i;
+			}
+		}
+		curr_weight[index] -= total;
+		sequence_.push_back(index);
+	}
+}
+
+int wrr_schedule::pick() const
+{
+	if (sequence_.empty()) {
+		return 0;
+	}
+	size_t cursor = (size_t)gpr_atm_no_barrier_fetch_add(&cursor_, 1);
+	return sequence_[cursor % sequence_.size()];
+}
+
 weight_round_robin_lb::weight_round_robin_lb()
 {
 }
@@ -40,7 +128,7 @@ weight_round_robin_lb::~weight_round_robin_lb()
 	cursors.clear();
 }
 
-void weight_round_robin_lb::set_providers(std::map<std::string, provider_t*> *_providers) {
+void weight_round_robin_lb::set_providers(std::map<std::string, provider_list*> *_providers) {
 	this->providers = _providers;
 }
 void weight_round_robin_lb::reset_cursor(const char* sn) {
@@ -59,12 +147,15 @@ provider_t* weight_round_robin_lb::choose_provider(const char* sn, int step) {
 	}
 	int index = -1, index_org = -1;
 	int size = 0;
-	std::map<std::string, provider_t*>::iterator provider_iter = providers->find(sn);
+	std::map<std::string, provider_list*>::iterator provider_iter = providers->find(sn);
 	if (provider_iter == providers->end())
 	{
 		return NULL;
 	}
-	size = orientsec_grpc_cache_provider_count_get();
+	size = provider_iter->second->size();
+	if (size == 0) {
+		return NULL;
+	}
 	std::map<std::string, int>::iterator curIter = cursors.find(sn);
 	if (curIter == cursors.end())
 	{
@@ -82,10 +173,10 @@ provider_t* weight_round_robin_lb::choose_provider(const char* sn, int step) {
 	//找出从index开始第一个不在黑名单中的provider,并且版本匹配的服务
 	while (do_while)
 	{
-		is_invalid = is_provider_invalid(&provider_iter->second[index]);
+		is_invalid = is_provider_invalid(&provider_iter->second->at(index));
 		if (is_invalid == false) { //查找到未禁用的服务
 								   //根据服务名和版本号校验是否匹配
-			if (orientsec_grpc_consumer_control_version_match(provider_iter->second[index].sInterface, provider_iter->second[index].version) == true) {
+			if (orientsec_grpc_consumer_control_version_match(provider_iter->second->at(index).sInterface, provider_iter->second->at(index).version) == true) {
 				index_valid = index;
 				break;   //找到未禁用，并且版本匹配的服务
 			}
@@ -105,7 +196,7 @@ provider_t* weight_round_robin_lb::choose_provider(const char* sn, int step) {
 		}
 	}
 	curIter->second = index_valid;
-	return clone_provider(&provider_iter->second[index_valid]);
+	return clone_provider(&provider_iter->second->at(index_valid));
 }
 
 int weight_round_robin_lb::choose_subchannel(const char* sn, provider_t *provider, const int*nums) {
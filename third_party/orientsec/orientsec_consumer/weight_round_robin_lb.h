@@ -26,12 +26,43 @@
 #define ORIENTSEC_GRPC_WEIGHT_ROUNDROBIN_H
 
 #include "orientsec_loadbalance.h"
+#include <grpc/support/atm.h>
 #include<map>
 #include<vector>
 
 //addbylm
 #include "src/core/ext/filters/client_channel/lb_policy_registry.h"
 
+//平滑加权轮询序列的最大长度，权重约分后总和超过时按比例缩小
+#define ORIENTSEC_GRPC_WRR_MAX_SEQUENCE 4096
+
+//平滑加权轮询(smooth weighted round robin)调度表
+//构造时按权重预先算出一个完整周期的选取序列，之后只读；
+//选取为原子计数取模查表，O(1)且多线程无锁，不修改provider_t
+class wrr_schedule {
+public:
+	wrr_schedule(const provider_t* providers, int num);
+	//发布新快照时使用：约分后的权重与上一调度表相同则直接复用其序列，不重新计算
+	wrr_schedule(const provider_t* providers, int num, const wrr_schedule* previous);
+
+	//返回provider下标，没有provider时返回0
+	int pick() const;
+
+	//一个周期的长度
+	int size() const { return (int)sequence_.size(); }
+
+private:
+	wrr_schedule(const wrr_schedule&);
+	wrr_schedule& operator=(const wrr_schedule&);
+
+	void build(const provider_t* providers, int num, const wrr_schedule* previous);
+
+	//约分、缩放后的权重，用于判断能否复用
+	std::vector<int> weights_;
+	std::vector<int> sequence_;
+	mutable gpr_atm cursor_;
+};
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -42,14 +73,16 @@ extern "C" {
 	public:
 		weight_round_robin_lb();
 		~weight_round_robin_lb();
-		void set_providers(std::map<std::string, provider_t*> *_providers);
+		void set_providers(std::map<std::string, provider_list*> *_providers);
 		//addbylm
+		//按provider_t的curr_weight计算，会修改传入的数组，只用于调用方自己的拷贝；
+		//快照中的可选集合使用其自带的wrr_schedule
 		int choose_subchannel(const char* sn, provider_t *provider, const int*nums);
 
 		void reset_cursor(const char* sn);
 		provider_t* choose_provider(const char* sn, int step = 0);
 	private:
-		std::map<std::string, provider_t*> *providers;
+		std::map<std::string, provider_list*> *providers;
 		//某服务的选择的provider位置
 		std::map<std::string, int> cursors;
 	};
@@ -23,6 +23,8 @@
  */
 
 #include "orientsec_provider_intf.h"
+#include "provider_concurrency_limiter.h"
+#include "orientsec_grpc_properties_constants.h"
 #include "orientsec_grpc_utils.h"
 #include "orientsec_grpc_registy_intf.h"
 #include "orientsec_grpc_properties_tools.h"
@@ -31,6 +33,7 @@
 #include <grpc/support/log.h>
 #include <grpc/support/alloc.h>
 #include <grpc/support/sync.h>
+#include <grpc/support/time.h>
 #include <src/core/lib/gpr/spinlock.h>
 #include <stdio.h>
 #include <stdlib.h>
@@ -47,6 +50,7 @@ typedef struct _provider_lst {
   uint64_t last_log_time; //最后一次打印日志时间
   gpr_mu conns_mu;
   gpr_mu reqs_mu;
+  provider_concurrency_limiter limiter;  //自适应模式下的并发上限，由reqs_mu保护
 }provider_lst;
 
 static provider_lst provider_list_head = { .provider = NULL,
@@ -58,6 +62,24 @@ static provider_lst provider_list_head = { .provider = NULL,
 static provider_lst *p_provider_list_head = &provider_list_head;
 static bool provider_lst_inited = false;
 
+//并发请求控制是否为自适应模式，启动时从配置文件读取
+static gpr_once g_requests_limit_once = GPR_ONCE_INIT;
+static bool g_requests_limit_adaptive = false;
+
+static void requests_limit_mode_init() {
+  char buf[ORIENTSEC_GRPC_PROPERTY_KEY_MAX_LEN] = {0};
+  if (0 == orientsec_grpc_properties_get_value(
+               ORIENTSEC_GRPC_PROPERTIES_P_REQUESTS_LIMIT_MODE, NULL, buf)) {
+    g_requests_limit_adaptive =
+        0 == strcmp(buf, ORIENTSEC_GRPC_PROVIDER_REQUESTS_LIMIT_ADAPTIVE);
+  }
+}
+
+static bool requests_limit_adaptive() {
+  gpr_once_init(&g_requests_limit_once, requests_limit_mode_init);
+  return g_requests_limit_adaptive;
+}
+
 void cache_provider_node(provider_t *provider) {
   provider_lst *pl = (provider_lst*)gpr_zalloc(sizeof(provider_lst));
   if (pl)
@@ -68,6 +90,7 @@ void cache_provider_node(provider_t *provider) {
     pl->last_log_time = 0;
     gpr_mu_init(&pl->conns_mu);
     gpr_mu_init(&pl->reqs_mu);
+    provider_concurrency_limiter_init(&pl->limiter);
     pl->next = p_provider_list_head->next;
     p_provider_list_head->next = pl;
   }
@@ -446,6 +469,14 @@ bool check_provider_request(const char *intf) {
   }
   if (provider_node && provider_node->provider)
   {
+    //自适应模式下default_requests只作为上限
+    if (requests_limit_adaptive()) {
+      gpr_mu_lock(&provider_node->reqs_mu);
+      ret = provider_concurrency_limiter_acquire(
+          &provider_node->limiter, provider_node->provider->default_requests);
+      gpr_mu_unlock(&provider_node->reqs_mu);
+      return ret;
+    }
     //不做请求数控制时不需要加锁
     if (0 == provider_node->provider->default_requests) {
       provider_node->current_reqs = 0;  //不计算请求数
@@ -468,6 +499,10 @@ bool check_provider_request(const char *intf) {
 }
 //减少provider 并发请求数
 void decrease_provider_request(const char *intf) {
+  finish_provider_request(intf, -1);
+}
+
+void finish_provider_request(const char *intf, int64_t latency_us) {
   provider_lst *provider_node = p_provider_list_head->next;
   bool ret = true;
   for (; provider_node != NULL; provider_node = provider_node->next)
@@ -483,6 +518,16 @@ void decrease_provider_request(const char *intf) {
   }
   if (provider_node && provider_node->provider)
   {
+    if (requests_limit_adaptive()) {
+      gpr_timespec now = gpr_now(GPR_CLOCK_MONOTONIC);
+      gpr_mu_lock(&provider_node->reqs_mu);
+      provider_concurrency_limiter_release(
+          &provider_node->limiter, latency_us,
+          (int64_t)now.tv_sec * GPR_US_PER_SEC + now.tv_nsec / GPR_NS_PER_US,
+          provider_node->provider->default_requests);
+      gpr_mu_unlock(&provider_node->reqs_mu);
+      return;
+    }
     //首先判读是否进行请求数控制。
     if (0 == provider_node->provider->default_requests) {
       return;
@@ -25,6 +25,7 @@
 #define ORIENTSEC_PROVIDER_INTF_H
 
 #include<stdbool.h>
+#include<stdint.h>
 #include "../orientsec_common/orientsec_types.h"
 //#include "orientsec_types.h"
 
@@ -54,6 +55,10 @@ bool check_provider_request(const char *intf);
 //减少provider的当前并发请求计数
 void decrease_provider_request(const char *intf);
 
+//请求结束，减少并发请求计数。latency_us为请求延迟，小于0时不作为样本，
+//自适应模式下按延迟调整并发上限
+void finish_provider_request(const char *intf, int64_t latency_us);
+
 //检查服务是否过期修改为在call时调用
 //bool check_provider_deprecated(const char *intf);
 
@@ -0,0 +1,126 @@
+/*
+ * Copyright 2019 Orient Securities Co., Ltd.
+ * Copyright 2019 BoCloud Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ *    2026/10/16
+ *    version 1.0
+ *    provider端自适应并发限制实现
+ */
+
+#include "provider_concurrency_limiter.h"
+
+#include <string.h>
+
+//延迟超过无排队延迟的1.5倍才认为在排队
+#define ORIENTSEC_GRPC_LIMITER_RTT_TOLERANCE 1.5
+//每个窗口允许的排队请求数，上限增长的步长
+#define ORIENTSEC_GRPC_LIMITER_QUEUE_SIZE 4
+#define ORIENTSEC_GRPC_LIMITER_SMOOTHING 0.2
+//每600个窗口(约1分钟)min_rtt最多上升10%
+#define ORIENTSEC_GRPC_LIMITER_MIN_RTT_WINDOWS 600
+#define ORIENTSEC_GRPC_LIMITER_MIN_RTT_RISE 1.1
+
+static double limiter_max(int max_limit) {
+  return max_limit > 0 ? (double)max_limit
+                       : (double)ORIENTSEC_GRPC_LIMITER_MAX_LIMIT;
+}
+
+void provider_concurrency_limiter_init(provider_concurrency_limiter *limiter) {
+  memset(limiter, 0, sizeof(*limiter));
+  limiter->limit = ORIENTSEC_GRPC_LIMITER_INITIAL_LIMIT;
+}
+
+bool provider_concurrency_limiter_acquire(provider_concurrency_limiter *limiter,
+                                          int max_limit) {
+  double limit = limiter->limit;
+  if (limit > limiter_max(max_limit)) {
+    limit = limiter_max(max_limit);
+  }
+  if (limiter->inflight >= (int)limit) {
+    return false;
+  }
+  limiter->inflight++;
+  if (limiter->inflight > limiter->window_max_inflight) {
+    limiter->window_max_inflight = limiter->inflight;
+  }
+  return true;
+}
+
+//一个窗口结束，按窗口内平均延迟与无排队延迟的比值调整上限
+static void limiter_update(provider_concurrency_limiter *limiter,
+                           int max_limit) {
+  double short_rtt =
+      (double)limiter->window_rtt_sum_us / limiter->window_samples;
+  if (short_rtt < 1) {
+    short_rtt = 1;
+  }
+  if (limiter->min_rtt_us <= 0 || short_rtt < limiter->min_rtt_us) {
+    limiter->min_rtt_us = short_rtt;
+    limiter->windows = 0;
+  } else if (++limiter->windows >= ORIENTSEC_GRPC_LIMITER_MIN_RTT_WINDOWS) {
+    double raised = limiter->min_rtt_us * ORIENTSEC_GRPC_LIMITER_MIN_RTT_RISE;
+    limiter->min_rtt_us = short_rtt < raised ? short_rtt : raised;
+    limiter->windows = 0;
+  }
+  double gradient =
+      ORIENTSEC_GRPC_LIMITER_RTT_TOLERANCE * limiter->min_rtt_us / short_rtt;
+  if (gradient > 1.0) {
+    gradient = 1.0;
+  } else if (gradient < 0.5) {
+    gradient = 0.5;
+  }
+  double new_limit =
+      limiter->limit * gradient + ORIENTSEC_GRPC_LIMITER_QUEUE_SIZE;
+  new_limit = limiter->limit * (1 - ORIENTSEC_GRPC_LIMITER_SMOOTHING) +
+              new_limit * ORIENTSEC_GRPC_LIMITER_SMOOTHING;
+  //并发数不到上限的一半时说明上限不是瓶颈，只允许因延迟升高而降低，不再增加
+  if (limiter->window_max_inflight < limiter->limit / 2 &&
+      new_limit > limiter->limit) {
+    new_limit = limiter->limit;
+  }
+  if (new_limit < ORIENTSEC_GRPC_LIMITER_MIN_LIMIT) {
+    new_limit = ORIENTSEC_GRPC_LIMITER_MIN_LIMIT;
+  }
+  if (new_limit > limiter_max(max_limit)) {
+    new_limit = limiter_max(max_limit);
+  }
+  limiter->limit = new_limit;
+}
+
+void provider_concurrency_limiter_release(provider_concurrency_limiter *limiter,
+                                          int64_t rtt_us, int64_t now_us,
+                                          int max_limit) {
+  if (limiter->inflight > 0) {
+    limiter->inflight--;
+  }
+  if (rtt_us < 0) {
+    return;
+  }
+  if (limiter->window_samples == 0) {
+    limiter->window_start_us = now_us;
+  }
+  limiter->window_rtt_sum_us += rtt_us;
+  limiter->window_samples++;
+  if (limiter->window_samples < ORIENTSEC_GRPC_LIMITER_WINDOW_SAMPLES ||
+      now_us - limiter->window_start_us < ORIENTSEC_GRPC_LIMITER_WINDOW_US) {
+    return;
+  }
+  limiter_update(limiter, max_limit);
+  limiter->window_rtt_sum_us = 0;
+  limiter->window_samples = 0;
+  limiter->window_max_inflight = limiter->inflight;
+}
@@ -0,0 +1,73 @@
+/*
+ * Copyright 2019 Orient Securities Co., Ltd.
+ * Copyright 2019 BoCloud Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ *    2026/10/16
+ *    version 1.0
+ *    provider端自适应并发限制
+ *    按观测到的调用延迟调整并发上限(gradient算法)：延迟接近无排队时的
+ *    延迟时缓慢增加上限，排队导致延迟升高时按比例降低上限。
+ *    无排队时的延迟取窗口平均延迟的最小值，每分钟左右允许上升10%，
+ *    以适应服务本身变慢(如数据量增长)，又不会被持续过载抬高
+ */
+
+#ifndef ORIENTSEC_PROVIDER_CONCURRENCY_LIMITER_H
+#define ORIENTSEC_PROVIDER_CONCURRENCY_LIMITER_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define ORIENTSEC_GRPC_LIMITER_INITIAL_LIMIT 20
+#define ORIENTSEC_GRPC_LIMITER_MIN_LIMIT 4
+#define ORIENTSEC_GRPC_LIMITER_MAX_LIMIT 1000
+// 每个采样窗口至少持续100ms且包含10个样本
+#define ORIENTSEC_GRPC_LIMITER_WINDOW_US (100 * 1000)
+#define ORIENTSEC_GRPC_LIMITER_WINDOW_SAMPLES 10
+
+typedef struct _provider_concurrency_limiter {
+  double limit;        //当前并发上限
+  double min_rtt_us;   //各窗口平均延迟的最小值，近似无排队时的延迟
+  int windows;         //距上次允许min_rtt_us上升经过的窗口数
+  int inflight;        //当前并发请求数
+  int64_t window_start_us;
+  int64_t window_rtt_sum_us;
+  int window_samples;
+  int window_max_inflight;
+} provider_concurrency_limiter;
+
+//以下函数不加锁，调用方需保证同一limiter串行访问
+
+void provider_concurrency_limiter_init(provider_concurrency_limiter *limiter);
+
+//并发数未达到上限时计数加一并返回true。max_limit > 0时上限不超过max_limit
+bool provider_concurrency_limiter_acquire(provider_concurrency_limiter *limiter,
+                                          int max_limit);
+
+//请求结束，rtt_us < 0表示没有延迟样本(如被调用方取消)
+void provider_concurrency_limiter_release(provider_concurrency_limiter *limiter,
+                                          int64_t rtt_us, int64_t now_us,
+                                          int max_limit);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  // !ORIENTSEC_PROVIDER_CONCURRENCY_LIMITER_H
@@ -100,6 +100,18 @@ void subscribe(url_t *url, registry_notify_f notify_f) {
 	g_zk_registry_service->subscribe(&args, url, notify_f);
 }
 
+void subscribe_delta(url_t *url, registry_notify_f notify_f, registry_delta_notify_f delta_f) {
+	orientsec_grpc_registry_zk_intf_init();
+	if (!g_zk_registry_service)
+	{
+		gpr_log(GPR_ERROR, "call subscribe_delta failed for intf init failed");
+		return;
+	}
+	registry_service_args_t args;
+	args.param = g_zk_registry_service;
+	g_zk_registry_service->subscribe_delta(&args, url, notify_f, delta_f);
+}
+
 void unsubscribe(url_t *url, registry_notify_f notify_f) {
 	orientsec_grpc_registry_zk_intf_init();
 	if (!g_zk_registry_service)
@@ -151,3 +163,7 @@ void shutdown_registry() {
 	g_zk_registry_service->destroy(&args);
 }
 
+void get_registry_notify_stats(registry_notify_stats *stats) {
+	registry_notify_executor_get_stats(stats);
+}
+
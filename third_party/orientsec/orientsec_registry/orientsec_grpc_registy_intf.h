@@ -27,6 +27,7 @@
 
 #include "url.h"
 #include "registry_service.h"
+#include "registry_notify_executor.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -72,6 +73,17 @@ void unregistry(url_t *url);
 * @param listener 变更事件监听器，不允许为空
 */
 void subscribe(url_t *url, registry_notify_f notify_f);
+
+/**
+* 增量订阅，订阅契约同subscribe.
+* 首次订阅以notify_f回调全量数据，此后子节点变化时只以delta_f回调新增和删除的数据，
+* 未变化的子节点不会重复解析和通知。
+*
+* @param url      订阅条件，不允许为空
+* @param notify_f 全量监听器，取消订阅时以此为准，不允许为空
+* @param delta_f  增量监听器，不允许为空
+*/
+void subscribe_delta(url_t *url, registry_notify_f notify_f, registry_delta_notify_f delta_f);
 /**
 * 取消订阅.
 * 取消订阅需处理契约：<br>
@@ -107,6 +119,12 @@ char* getData(const char *path);
 **/
 void shutdown_registry();
 
+/**
+* 读取注册中心通知执行器的统计信息，包括事件数、合并数、等待数及通知耗时分布
+* @param stats 输出参数，不允许为空
+**/
+void get_registry_notify_stats(registry_notify_stats *stats);
+
 
 void consumer_providers_callback(url_t *urls, int url_num);
 
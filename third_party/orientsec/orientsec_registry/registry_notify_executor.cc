@@ -0,0 +1,265 @@
+/*
+ * Copyright 2019 Orient Securities Co., Ltd.
+ * Copyright 2019 BoCloud Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ *    2026/10/16
+ *    version 1.0
+ *    注册中心通知执行器实现
+ */
+
+#include "registry_notify_executor.h"
+
+#include <string.h>
+#include <deque>
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <grpc/support/atm.h>
+#include <grpc/support/log.h>
+#include <grpc/support/sync.h>
+#include <grpc/support/time.h>
+
+#include "src/core/lib/gprpp/thd.h"
+
+namespace {
+
+typedef std::pair<void*, std::string> notify_key;
+
+struct notify_entry {
+  registry_notify_task_f task;
+  notify_key key;
+  int64_t post_us;  //第一次登记的时间，合并的登记不更新
+  bool cancelled;
+};
+
+gpr_once g_executor_once = GPR_ONCE_INIT;
+gpr_mu g_executor_mu;
+gpr_cv g_executor_cv;  //有新任务
+gpr_cv g_done_cv;      //任务执行结束
+grpc_core::Thread* g_executor_thd = NULL;
+gpr_atm g_executor_started = 0;
+
+// 以下由g_executor_mu保护
+// 定长环形队列，满时登记的任务按顺序进入overflow，出队后依次补入
+std::vector<notify_entry*>* g_ring = NULL;
+size_t g_ring_head = 0;
+size_t g_ring_count = 0;
+std::deque<notify_entry*>* g_overflow = NULL;
+// 尚未执行的任务，用于按路径合并
+std::map<notify_key, notify_entry*>* g_pending = NULL;
+// 正在执行的任务，执行期间entry不释放
+const notify_entry* g_running = NULL;
+
+gpr_atm g_posted = 0;
+gpr_atm g_coalesced = 0;
+gpr_atm g_dispatched = 0;
+gpr_atm g_overflowed = 0;
+gpr_atm g_last_latency_us = 0;
+gpr_atm g_max_latency_us = 0;
+gpr_atm g_total_latency_us = 0;
+gpr_atm g_latency_buckets[REGISTRY_NOTIFY_LATENCY_BUCKETS];
+
+int64_t notify_now_us() {
+  gpr_timespec now = gpr_now(GPR_CLOCK_MONOTONIC);
+  return (int64_t)now.tv_sec * GPR_US_PER_SEC + now.tv_nsec / GPR_NS_PER_US;
+}
+
+void record_latency(int64_t latency_us) {
+  int bucket = 0;
+  if (latency_us < 0) {
+    latency_us = 0;
+  }
+  while (bucket < REGISTRY_NOTIFY_LATENCY_BUCKETS - 1 &&
+         (latency_us >> bucket) > 0) {
+    bucket++;
+  }
+  gpr_atm_no_barrier_fetch_add(&g_latency_buckets[bucket], 1);
+  gpr_atm_no_barrier_fetch_add(&g_dispatched, 1);
+  gpr_atm_no_barrier_fetch_add(&g_total_latency_us, (gpr_atm)latency_us);
+  gpr_atm_no_barrier_store(&g_last_latency_us, (gpr_atm)latency_us);
+  for (;;) {
+    gpr_atm old_max = gpr_atm_no_barrier_load(&g_max_latency_us);
+    if ((int64_t)old_max >= latency_us ||
+        gpr_atm_no_barrier_cas(&g_max_latency_us, old_max,
+                               (gpr_atm)latency_us)) {
+      break;
+    }
+  }
+}
+
+//调用方需持有g_executor_mu
+notify_entry* pop_entry_locked() {
+  notify_entry* entry = NULL;
+  if (g_ring_count == 0) {
+    return NULL;
+  }
+  entry = (*g_ring)[g_ring_head];
+  g_ring_head = (g_ring_head + 1) % REGISTRY_NOTIFY_QUEUE_SIZE;
+  g_ring_count--;
+  if (!g_overflow->empty()) {
+    (*g_ring)[(g_ring_head + g_ring_count) % REGISTRY_NOTIFY_QUEUE_SIZE] =
+        g_overflow->front();
+    g_ring_count++;
+    g_overflow->pop_front();
+  }
+  return entry;
+}
+
+void executor_loop(void* arg) {
+  notify_entry* entry = NULL;
+  gpr_mu_lock(&g_executor_mu);
+  for (;;) {
+    while ((entry = pop_entry_locked()) == NULL) {
+      gpr_cv_wait(&g_executor_cv, &g_executor_mu,
+                  gpr_inf_future(GPR_CLOCK_MONOTONIC));
+    }
+    if (entry->cancelled) {
+      delete entry;
+      continue;
+    }
+    //先移出合并表，执行期间的登记会重新排队，不会丢失
+    g_pending->erase(entry->key);
+    g_running = entry;
+    gpr_mu_unlock(&g_executor_mu);
+
+    entry->task(entry->key.first, entry->key.second.c_str());
+    record_latency(notify_now_us() - entry->post_us);
+
+    gpr_mu_lock(&g_executor_mu);
+    g_running = NULL;
+    gpr_cv_broadcast(&g_done_cv);
+    delete entry;
+  }
+}
+
+void executor_init() {
+  gpr_mu_init(&g_executor_mu);
+  gpr_cv_init(&g_executor_cv);
+  gpr_cv_init(&g_done_cv);
+  g_ring = new std::vector<notify_entry*>(REGISTRY_NOTIFY_QUEUE_SIZE);
+  g_overflow = new std::deque<notify_entry*>();
+  g_pending = new std::map<notify_key, notify_entry*>();
+  bool success = false;
+  g_executor_thd = new grpc_core::Thread("registry_notify", executor_loop,
+                                         NULL, &success);
+  GPR_ASSERT(success);
+  g_executor_thd->Start();
+  gpr_atm_rel_store(&g_executor_started, 1);
+}
+
+}  // namespace
+
+void registry_notify_executor_post(registry_notify_task_f task, void* owner,
+                                   const char* path) {
+  if (task == NULL || path == NULL) {
+    return;
+  }
+  gpr_once_init(&g_executor_once, executor_init);
+  gpr_atm_no_barrier_fetch_add(&g_posted, 1);
+  gpr_mu_lock(&g_executor_mu);
+  notify_key key(owner, path);
+  std::map<notify_key, notify_entry*>::iterator it = g_pending->find(key);
+  if (it != g_pending->end()) {
+    gpr_atm_no_barrier_fetch_add(&g_coalesced, 1);
+    gpr_mu_unlock(&g_executor_mu);
+    return;
+  }
+  notify_entry* entry = new notify_entry();
+  entry->task = task;
+  entry->key = key;
+  entry->post_us = notify_now_us();
+  entry->cancelled = false;
+  (*g_pending)[key] = entry;
+  if (g_ring_count < REGISTRY_NOTIFY_QUEUE_SIZE) {
+    (*g_ring)[(g_ring_head + g_ring_count) % REGISTRY_NOTIFY_QUEUE_SIZE] =
+        entry;
+    g_ring_count++;
+  } else {
+    //溢出列表的长度受路径数限制：同一路径只会有一个未执行的任务
+    g_overflow->push_back(entry);
+    gpr_atm_no_barrier_fetch_add(&g_overflowed, 1);
+  }
+  gpr_cv_signal(&g_executor_cv);
+  gpr_mu_unlock(&g_executor_mu);
+}
+
+void registry_notify_executor_cancel(void* owner) {
+  if (!gpr_atm_acq_load(&g_executor_started)) {
+    return;
+  }
+  gpr_mu_lock(&g_executor_mu);
+  std::map<notify_key, notify_entry*>::iterator it = g_pending->begin();
+  while (it != g_pending->end()) {
+    if (it->first.first == owner) {
+      //仍在队列中，出队时释放
+      it->second->cancelled = true;
+      g_pending->erase(it++);
+    } else {
+      ++it;
+    }
+  }
+  while (g_running != NULL && g_running->key.first == owner) {
+    gpr_cv_wait(&g_done_cv, &g_executor_mu,
+                gpr_inf_future(GPR_CLOCK_MONOTONIC));
+  }
+  gpr_mu_unlock(&g_executor_mu);
+}
+
+void registry_notify_executor_cancel_path(void* owner, const char* path) {
+  if (path == NULL || !gpr_atm_acq_load(&g_executor_started)) {
+    return;
+  }
+  notify_key key(owner, path);
+  gpr_mu_lock(&g_executor_mu);
+  std::map<notify_key, notify_entry*>::iterator it = g_pending->find(key);
+  if (it != g_pending->end()) {
+    it->second->cancelled = true;
+    g_pending->erase(it);
+  }
+  while (g_running != NULL && g_running->key == key) {
+    gpr_cv_wait(&g_done_cv, &g_executor_mu,
+                gpr_inf_future(GPR_CLOCK_MONOTONIC));
+  }
+  gpr_mu_unlock(&g_executor_mu);
+}
+
+void registry_notify_executor_get_stats(registry_notify_stats* stats) {
+  int i = 0;
+  if (stats == NULL) {
+    return;
+  }
+  memset(stats, 0, sizeof(registry_notify_stats));
+  stats->posted = (int64_t)gpr_atm_no_barrier_load(&g_posted);
+  stats->coalesced = (int64_t)gpr_atm_no_barrier_load(&g_coalesced);
+  stats->dispatched = (int64_t)gpr_atm_no_barrier_load(&g_dispatched);
+  stats->overflowed = (int64_t)gpr_atm_no_barrier_load(&g_overflowed);
+  stats->last_latency_us = (int64_t)gpr_atm_no_barrier_load(&g_last_latency_us);
+  stats->max_latency_us = (int64_t)gpr_atm_no_barrier_load(&g_max_latency_us);
+  stats->total_latency_us =
+      (int64_t)gpr_atm_no_barrier_load(&g_total_latency_us);
+  for (i = 0; i < REGISTRY_NOTIFY_LATENCY_BUCKETS; i++) {
+    stats->latency_buckets[i] =
+        (int64_t)gpr_atm_no_barrier_load(&g_latency_buckets[i]);
+  }
+  if (gpr_atm_acq_load(&g_executor_started)) {
+    gpr_mu_lock(&g_executor_mu);
+    stats->pending = (int64_t)g_pending->size();
+    gpr_mu_unlock(&g_executor_mu);
+  }
+}
@@ -0,0 +1,75 @@
+/*
+ * Copyright 2019 Orient Securities Co., Ltd.
+ * Copyright 2019 BoCloud Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ *    2026/10/16
+ *    version 1.0
+ *    注册中心通知执行器
+ *    zk事件线程只登记发生变化的路径，由专用线程按路径合并后调用订阅函数
+ */
+
+#ifndef ORIENTSEC_REGISTRY_NOTIFY_EXECUTOR_H
+#define ORIENTSEC_REGISTRY_NOTIFY_EXECUTOR_H
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+//队列容量，队列满时新登记的路径暂存在溢出列表中，不阻塞也不丢弃
+#define REGISTRY_NOTIFY_QUEUE_SIZE 1024
+
+//延迟分布的桶数，第i个桶统计[2^(i-1), 2^i)微秒内完成的事件，最后一个桶不设上限
+#define REGISTRY_NOTIFY_LATENCY_BUCKETS 24
+
+//处理owner上path的变化，在执行线程中调用，应读取该路径的最新状态
+typedef void (*registry_notify_task_f)(void* owner, const char* path);
+
+typedef struct _registry_notify_stats {
+  int64_t posted;      //登记的事件数
+  int64_t coalesced;   //与尚未处理的同一路径合并的事件数
+  int64_t dispatched;  //执行的任务数
+  int64_t overflowed;  //队列满时进入溢出列表的路径数
+  int64_t pending;     //当前等待处理的路径数
+  //从路径第一次登记到任务执行完成的耗时，单位微秒
+  int64_t last_latency_us;
+  int64_t max_latency_us;
+  int64_t total_latency_us;  //除以dispatched为平均耗时
+  int64_t latency_buckets[REGISTRY_NOTIFY_LATENCY_BUCKETS];
+} registry_notify_stats;
+
+//登记owner上path的一次变化，第一次调用时启动执行线程。
+//同一(owner, path)在执行前重复登记只执行一次；执行期间再次登记会重新排队。
+void registry_notify_executor_post(registry_notify_task_f task, void* owner,
+                                   const char* path);
+
+//取消owner上尚未执行的任务，并等待正在执行的owner任务结束。
+//owner释放前调用，不能在任务中调用
+void registry_notify_executor_cancel(void* owner);
+
+//取消owner上path尚未执行的任务，并等待正在执行的该路径任务结束。
+//path对应的状态释放前调用，不能在该路径的任务中调用
+void registry_notify_executor_cancel_path(void* owner, const char* path);
+
+void registry_notify_executor_get_stats(registry_notify_stats* stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  // !ORIENTSEC_REGISTRY_NOTIFY_EXECUTOR_H
@@ -37,6 +37,12 @@ extern "C" {
 **/
 typedef void(*registry_notify_f)(url_t*, int);
 
+/**
+* 增量回调函数声明：added为新增的子节点url，removed为已删除的子节点url。
+* url由注册中心缓存持有，回调内只读，不得修改或释放。
+**/
+typedef void(*registry_delta_notify_f)(url_t*, int, url_t*, int);
+
 typedef struct _registry_service registry_service_t;
 
 //接口参数类型
@@ -54,6 +60,8 @@ typedef  struct _registry_service {
 	void (*unregiste)(registry_service_args_t*, url_t*);
 	//订阅path
 	void (*subscribe)(registry_service_args_t*, url_t*, registry_notify_f );
+	//订阅path，首次以全量回调notify，此后子节点变化只回调增量
+	void (*subscribe_delta)(registry_service_args_t*, url_t*, registry_notify_f, registry_delta_notify_f);
 	//取消订阅path
 	void (*unsubscribe)(registry_service_args_t*, url_t*, registry_notify_f );
 	//查找匹配某个Url的节点
@@ -66,9 +66,103 @@ void url_init(url_t *url) {
 		url->params_num = 0;
 		url->parameters = NULL;
 		url->flag = 0;
+		url->arena = NULL;
+		url->arena_len = 0;
+		url->indexed = false;
+		memset(url->slots, 0, sizeof(url->slots));
 	}
 }
 
+//常用参数名，下标与url_key_slot一致
+static const char *g_url_slot_keys[URL_KEY_SLOT_NUM] = {
+	ORIENTSEC_GRPC_REGISTRY_KEY_INTERFACE,
+	ORIENTSEC_GRPC_REGISTRY_KEY_METHODS,
+	ORIENTSEC_GRPC_REGISTRY_KEY_VERSION,
+	ORIENTSEC_GRPC_REGISTRY_KEY_GROUP,
+	ORIENTSEC_GRPC_REGISTRY_KEY_WEIGHT,
+	ORIENTSEC_GRPC_REGISTRY_KEY_DEFAULT_REQUESTS,
+	ORIENTSEC_GRPC_REGISTRY_KEY_DEFAULT_CONNECTIONS,
+	ORIENTSEC_GRPC_REGISTRY_KEY_DEFAULT_LOADBALANCE,
+	ORIENTSEC_GRPC_REGISTRY_KEY_TIMESTAMP,
+	ORIENTSEC_GRPC_REGISTRY_KEY_SIDE,
+	ORIENTSEC_GRPC_REGISTRY_KEY_APPLICATION,
+	ORIENTSEC_GRPC_CATEGORY_KEY,
+	ORIENTSEC_GRPC_REGISTRY_KEY_DYNAMIC
+};
+
+//返回参数名对应的槽位，不是常用参数时返回-1。按首字母分派，最多比较一次
+static int url_key_to_slot(const char *key, size_t len) {
+	int slot = -1;
+	switch (key[0])
+	{
+	case 'i': slot = URL_KEY_INTERFACE; break;
+	case 'm': slot = URL_KEY_METHODS; break;
+	case 'v': slot = URL_KEY_VERSION; break;
+	case 'g': slot = URL_KEY_GROUP; break;
+	case 'w': slot = URL_KEY_WEIGHT; break;
+	case 't': slot = URL_KEY_TIMESTAMP; break;
+	case 's': slot = URL_KEY_SIDE; break;
+	case 'a': slot = URL_KEY_APPLICATION; break;
+	case 'c': slot = URL_KEY_CATEGORY; break;
+	case 'd':
+		// default.xxx按点号后的首字母区分
+		if (len > 8 && key[8] == 'r') slot = URL_KEY_DEFAULT_REQUESTS;
+		else if (len > 8 && key[8] == 'c') slot = URL_KEY_DEFAULT_CONNECTIONS;
+		else if (len > 8 && key[8] == 'l') slot = URL_KEY_DEFAULT_LOADBALANCE;
+		else slot = URL_KEY_DYNAMIC;
+		break;
+	default:
+		return -1;
+	}
+	if (strlen(g_url_slot_keys[slot]) == len && 0 == memcmp(key, g_url_slot_keys[slot], len))
+	{
+		return slot;
+	}
+	return -1;
+}
+
+//记录参数的槽位，同名参数以第一个为准，与线性查找一致
+static void url_index_parameter(url_t *url, int index) {
+	int slot = 0;
+	char *key = url->parameters[index].key;
+	if (!url->indexed || !key)
+	{
+		return;
+	}
+	slot = url_key_to_slot(key, strlen(key));
+	if (slot >= 0 && url->slots[slot] == 0)
+	{
+		url->slots[slot] = index + 1;
+	}
+}
+
+//p是否位于url的缓冲区中，缓冲区中的数据随缓冲区一起释放，不能单独释放
+static bool url_in_arena(url_t *url, const void *p) {
+	return url->arena != NULL && p != NULL && (const char*)p >= url->arena &&
+		(const char*)p < url->arena + url->arena_len;
+}
+
+static void url_free_field(url_t *url, void *p) {
+	if (p && !url_in_arena(url, p))
+	{
+		free(p);
+	}
+}
+
+//复制字符串到缓冲区cursor处，并移动cursor
+static char *url_arena_copy(char **cursor, const char *str) {
+	char *ret = *cursor;
+	size_t len = 0;
+	if (!str)
+	{
+		return NULL;
+	}
+	len = strlen(str) + 1;
+	memcpy(ret, str, len);
+	*cursor += len;
+	return ret;
+}
+
 url_t *url_parse(char *url_data) {
 	url_t *url = (url_t*)malloc(sizeof(url_t));
 	if (!url)
@@ -87,72 +181,101 @@ url_t *url_parse(char *url_data) {
 }
 
 //解析串填充到url_t *pUrl中
+//缓冲区依次存放参数数组、href及解析用的副本，副本中的分隔符原地替换为'\0'，
+//各字段直接指向副本，整个url只分配一次内存
 int url_parse_v2(char *url_data, url_t *pUrl) {
-	char *tmp_url = NULL, *tmp_url_cache = NULL;
-	char *paramStart = NULL;
-	char *pHold = NULL;
-	char *pToken = NULL;
-	char cParamDelimiter = '&';
-	char cKVDelimiter = '=';
+	char *question = NULL;
+	char *tmp_url = NULL;
+	char *param = NULL;
+	char *end = NULL;
 	char *p = NULL;
-	char buf[2048];
+	char *q = NULL;
+	size_t len = 0;
+	size_t params_size = 0;
+	int params_num = 0;
 	int i = 0;
 	if (!pUrl || !url_data)
 	{
 		gpr_log(GPR_ERROR, "[url_parse]invalid arguments url_data or pUrl ");
 		return -1;
 	}
-	pUrl->href = gprc_strdup(url_data);
-	tmp_url_cache = tmp_url = gprc_strdup(url_data);
-	paramStart = strchr(tmp_url, '?');
-	if (paramStart > 0)
+	//一次扫描得到长度、参数起始位置及参数个数
+	for (p = url_data; *p; p++)
+	{
+		if (*p == '?')
+		{
+			if (!question)
+			{
+				question = p;
+			}
+		}
+		else if (*p == '&' && question)
+		{
+			params_num++;
+		}
+	}
+	len = p - url_data;
+	if (question)
+	{
+		params_num++;
+	}
+	params_size = sizeof(url_param) * params_num;
+	pUrl->arena_len = (int)(params_size + 2 * (len + 1));
+	pUrl->arena = (char*)malloc(pUrl->arena_len);
+	if (!pUrl->arena)
+	{
+		gpr_log(GPR_ERROR, "[url_parse] malloc memory failed");
+		pUrl->arena_len = 0;
+		return -1;
+	}
+	pUrl->href = pUrl->arena + params_size;
+	memcpy(pUrl->href, url_data, len + 1);
+	tmp_url = pUrl->href + len + 1;
+	memcpy(tmp_url, url_data, len + 1);
+	pUrl->indexed = true;
+	memset(pUrl->slots, 0, sizeof(pUrl->slots));
+
+	if (question)
 	{
-		*paramStart = '\0';
-		paramStart = paramStart + 1;
-		int params_num = countchar(paramStart, '&') + 1;
 		pUrl->params_num = params_num;
-		pUrl->parameters = malloc(sizeof(url_param) * params_num);
-		pToken = strchr(paramStart, cParamDelimiter);
-		while (pToken)
+		pUrl->parameters = (url_param*)pUrl->arena;
+		param = tmp_url + (question - url_data);
+		*param++ = '\0';
+		end = tmp_url + len;
+		for (i = 0; i < params_num; i++)
 		{
-			memset(buf, 0, 2048);
-			snprintf(buf, pToken - paramStart + 1, "%s", paramStart);
-			p = strchr(buf, '=');
+			q = (char*)memchr(param, '&', end - param);
+			if (q)
+			{
+				*q = '\0';
+			}
+			else {
+				q = end;
+			}
+			pUrl->parameters[i].key = param;
+			p = (char*)memchr(param, '=', q - param);
 			if (p)
 			{
-				pUrl->parameters[i].key = copystr(buf, p);
-				pUrl->parameters[i].value = copystr(p + 1, NULL);
+				*p = '\0';
+				pUrl->parameters[i].value = p + 1;
 			}
 			else {
-				pUrl->parameters[i].key = copystr(paramStart, pToken);
-				pUrl->parameters[i].value = copystr(paramStart, pToken);
+				//没有'='时key与value相同
+				pUrl->parameters[i].value = param;
 			}
-			paramStart = pToken + 1;
-			pToken = strchr(paramStart, cParamDelimiter);
-			i++;
-		}
-		memset(buf, 0, 2048);
-		snprintf(buf, strlen(paramStart) + 1, "%s", paramStart);
-		p = strchr(buf, '=');
-		if (p)
-		{
-			pUrl->parameters[i].key = copystr(buf, p);
-			pUrl->parameters[i].value = copystr(p + 1, NULL);
+			url_index_parameter(pUrl, i);
+			param = q + 1;
 		}
-		else {
-			pUrl->parameters[i].key = copystr(paramStart, NULL);
-			pUrl->parameters[i].value = copystr(paramStart, NULL);
-		}
-
 	}
 	p = strstr(tmp_url, "://");
-	if (p >= tmp_url) {
+	if (p) {
 		if (p == tmp_url)
 		{
 			gpr_log(GPR_ERROR, "Invalid url str");
 			return 1;
 		}
-		pUrl->protocol = copystr(tmp_url, p);
+		*p = '\0';
+		pUrl->protocol = tmp_url;
 		tmp_url = p + 3;
 	}
 	else {
@@ -162,92 +285,100 @@ int url_parse_v2(char *url_data, url_t *pUrl) {
 			gpr_log(GPR_ERROR, "Invalid url str");
 			return 2;
 		}
-		pUrl->protocol = copystr(tmp_url, p);
+		*p = '\0';
+		pUrl->protocol = tmp_url;
 		tmp_url = p + 2;
 	}
 	p = strchr(tmp_url, '/');
 	if (p)
 	{
-		pUrl->path = copystr(p + 1, NULL);
 		*p = '\0';
+		pUrl->path = p + 1;
 	}
 	p = strchr(tmp_url, '@');
 	if (p)
 	{
-		i = copystr0(buf, tmp_url, p);
-
-		tmp_url = p + 1;
-
-		p = strchr(buf, ':');
-		if (p) {
-			pUrl->username = copystr(buf, p);
-			pUrl->password = copystr(p + 1, NULL);
+		*p = '\0';
+		q = strchr(tmp_url, ':');
+		if (q) {
+			*q = '\0';
+			pUrl->username = tmp_url;
+			pUrl->password = q + 1;
 		}
+		tmp_url = p + 1;
 	}
 	p = strchr(tmp_url, ':');
 	if (p && strlen(p) > 1)
 	{
-		copystr0(buf, p + 1, NULL);
-		pUrl->port = atol(buf);
+		pUrl->port = atol(p + 1);
 		*p = '\0';
 	}
 	if (strlen(tmp_url) > 0)
 	{
-		pUrl->host = copystr(tmp_url, NULL);
-	}
-	if (tmp_url_cache)
-	{
-		free(tmp_url_cache);
+		pUrl->host = tmp_url;
 	}
 	return 0;
 }
 
-//复制url_t src中的内容到url_t dest中
+//复制url_t src中的内容到url_t dest中，dest的字符串与参数数组分配在同一块缓冲区中
 int url_clone(url_t *src, url_t *dest) {
 	size_t i = 0;
+	size_t size = 0;
+	char *cursor = NULL;
 	if (!src || !dest)
 	{
 		gpr_log(GPR_INFO, "url_clone:src or dest is null");
 		return -1;
 	}
-	if (src->href)
-	{
-		dest->href = gprc_strdup(src->href);
-	}
-	if (src->protocol)
-	{
-		dest->protocol = gprc_strdup(src->protocol);
-	}
-	if (src->auth)
-	{
-		dest->auth = gprc_strdup(src->auth);
-	}
-	if (src->username)
-	{
-		dest->username = gprc_strdup(src->username);
-	}
-	if (src->password)
+	size = sizeof(url_param) * src->params_num;
+#define URL_CLONE_SIZE(str) if (str) size += strlen(str) + 1;
+	URL_CLONE_SIZE(src->href);
+	URL_CLONE_SIZE(src->protocol);
+	URL_CLONE_SIZE(src->auth);
+	URL_CLONE_SIZE(src->username);
+	URL_CLONE_SIZE(src->password);
+	URL_CLONE_SIZE(src->host);
+	URL_CLONE_SIZE(src->path);
+	for (i = 0; i < src->params_num; i++)
 	{
-		dest->password = gprc_strdup(src->password);
+		URL_CLONE_SIZE(src->parameters[i].key);
+		URL_CLONE_SIZE(src->parameters[i].value);
 	}
-	if (src->host)
+#undef URL_CLONE_SIZE
+	dest->arena = NULL;
+	dest->arena_len = 0;
+	if (size > 0)
 	{
-		dest->host = gprc_strdup(src->host);
-	}
+		dest->arena = (char*)malloc(size);
+		if (!dest->arena)
+		{
+			gpr_log(GPR_ERROR, "url_clone malloc memory failed");
+			return -1;
+		}
+		dest->arena_len = (int)size;
+	}
+	cursor = dest->arena + sizeof(url_param) * src->params_num;
+	dest->href = url_arena_copy(&cursor, src->href);
+	dest->protocol = url_arena_copy(&cursor, src->protocol);
+	dest->auth = url_arena_copy(&cursor, src->auth);
+	dest->username = url_arena_copy(&cursor, src->username);
+	dest->password = url_arena_copy(&cursor, src->password);
+	dest->host = url_arena_copy(&cursor, src->host);
 	dest->port = src->port;
-	if (src->path)
-	{
-		dest->path = gprc_strdup(src->path);
-	}
+	dest->path = url_arena_copy(&cursor, src->path);
 	dest->params_num = src->params_num;
+	dest->parameters = NULL;
 	if (src->params_num > 0)
 	{
-		dest->parameters = (url_param *)malloc((src->params_num) * sizeof(struct _url_param));
+		dest->parameters = (url_param *)dest->arena;
 	}
+	dest->indexed = true;
+	memset(dest->slots, 0, sizeof(dest->slots));
 	for (i = 0; i < src->params_num; i++)
 	{
-		dest->parameters[i].key = gprc_strdup(src->parameters[i].key);
-		dest->parameters[i].value = gprc_strdup(src->parameters[i].value);
+		dest->parameters[i].key = url_arena_copy(&cursor, src->parameters[i].key);
+		dest->parameters[i].value = url_arena_copy(&cursor, src->parameters[i].value);
+		url_index_parameter(dest, i);
 	}
 	return 0;
 }
@@ -261,6 +392,14 @@ char *url_get_parameter(url_t *url, const char *key, char *prefix) {
 		gpr_log(GPR_INFO, "url or key is null");
 		return NULL;
 	}
+	if (!prefix && url->indexed)
+	{
+		int slot = url_key_to_slot(key, strlen(key));
+		if (slot >= 0 && url->slots[slot] > 0)
+		{
+			return gprc_strdup(url->parameters[url->slots[slot] - 1].value);
+		}
+	}
 	sprintf(search_key_full, "%s%s", prefix, key);
 	for (i = 0; i < url->params_num; i++)
 	{
@@ -340,6 +479,14 @@ char *url_get_parameter_v2(url_t *url, const char *key, char *prefix) {
 		gpr_log(GPR_INFO, "url or key is null");
 		return NULL;
 	}
+	if (!prefix && url->indexed)
+	{
+		int slot = url_key_to_slot(key, strlen(key));
+		if (slot >= 0 && url->slots[slot] > 0)
+		{
+			return url->parameters[url->slots[slot] - 1].value;
+		}
+	}
 	sprintf(search_key_full, "%s%s", prefix, key);
 	for (i = 0; i < url->params_num; i++)
 	{
@@ -377,6 +524,26 @@ char *url_get_parameter_v2(url_t *url, const char *key, char *prefix) {
 	return NULL;
 }
 
+char *url_get_slot_parameter(url_t *url, url_key_slot slot) {
+	size_t i;
+	if (!url || slot < 0 || slot >= URL_KEY_SLOT_NUM)
+	{
+		return NULL;
+	}
+	if (url->indexed)
+	{
+		return url->slots[slot] > 0 ? url->parameters[url->slots[slot] - 1].value : NULL;
+	}
+	for (i = 0; i < url->params_num; i++)
+	{
+		if (url->parameters[i].key && 0 == strcmp(url->parameters[i].key, g_url_slot_keys[slot]))
+		{
+			return url->parameters[i].value;
+		}
+	}
+	return NULL;
+}
+
 int url_update_parameter(url_t *url, char *key, char *value) {
 	size_t i = 0;
 	char *key_ptr = NULL;
@@ -402,9 +569,19 @@ int url_update_parameter(url_t *url, char *key, char *value) {
 	if (!bFind)
 	{
 		url->params_num++;
-		url->parameters = realloc(url->parameters, sizeof(url_param) * (url->params_num + 1));
+		if (url_in_arena(url, url->parameters))
+		{
+			//参数数组在缓冲区中，不能realloc
+			url_param *params = (url_param*)malloc(sizeof(url_param) * (url->params_num + 1));
+			memcpy(params, url->parameters, sizeof(url_param) * (url->params_num - 1));
+			url->parameters = params;
+		}
+		else {
+			url->parameters = realloc(url->parameters, sizeof(url_param) * (url->params_num + 1));
+		}
 		url->parameters[i].key = gprc_strdup(key);
 		url->parameters[i].value = gprc_strdup(value);
+		url_index_parameter(url, i);
 		ret = 1;
 	}
 	else {
@@ -413,7 +590,7 @@ int url_update_parameter(url_t *url, char *key, char *value) {
 			ret = 0;
 		}
 		else {
-			FREE_PTR(url->parameters[i].value);
+			url_free_field(url, url->parameters[i].value);
 			url->parameters[i].value = gprc_strdup(value);
 		}
 	}
@@ -802,28 +979,29 @@ url_data_inspect(url_t *data) {
 void url_free(url_t *data) {
 	size_t i;
 	if (!data) return;
-	if (data->href)
-	{
-		free(data->href);
-	}
-	if (data->protocol) free(data->protocol);
+	//缓冲区中的字符串随缓冲区释放，url_update_parameter新设置的值单独释放
+	url_free_field(data, data->href);
+	url_free_field(data, data->protocol);
 
-	if (data->username) free(data->username);
-	if (data->password) free(data->password);
-	if (data->auth) free(data->auth);
+	url_free_field(data, data->username);
+	url_free_field(data, data->password);
+	url_free_field(data, data->auth);
 
-	if (data->host) free(data->host);
+	url_free_field(data, data->host);
 
-	if (data->path) free(data->path);
+	url_free_field(data, data->path);
 	for (i = 0; i < data->params_num; i++)
 	{
-		if (data->parameters[i].key)
-			free(data->parameters[i].key);
-
-		if (data->parameters[i].value)
-			free(data->parameters[i].value);
+		url_free_field(data, data->parameters[i].key);
+		url_free_field(data, data->parameters[i].value);
+	}
+	url_free_field(data, data->parameters);
+	if (data->arena)
+	{
+		free(data->arena);
+		data->arena = NULL;
+		data->arena_len = 0;
 	}
-	free(data->parameters);
 }
 
 void url_full_free(url_t **data) {
@@ -97,6 +97,24 @@ typedef struct _url_param {
 	char *value;
 }url_param,*p_url_param;
 
+//常用参数的槽位，url_parse_v2解析时记录参数位置，按槽位直接访问
+typedef enum _url_key_slot {
+	URL_KEY_INTERFACE = 0,      // interface
+	URL_KEY_METHODS,            // methods
+	URL_KEY_VERSION,            // version
+	URL_KEY_GROUP,              // group
+	URL_KEY_WEIGHT,             // weight
+	URL_KEY_DEFAULT_REQUESTS,   // default.requests
+	URL_KEY_DEFAULT_CONNECTIONS,// default.connections
+	URL_KEY_DEFAULT_LOADBALANCE,// default.loadbalance
+	URL_KEY_TIMESTAMP,          // timestamp
+	URL_KEY_SIDE,               // side
+	URL_KEY_APPLICATION,        // application
+	URL_KEY_CATEGORY,           // category
+	URL_KEY_DYNAMIC,            // dynamic
+	URL_KEY_SLOT_NUM
+} url_key_slot;
+
 //url结构体
 typedef struct _url_t {
 	char *href;             // URL
@@ -110,6 +128,10 @@ typedef struct _url_t {
 	int params_num;         // 变量数量
 	url_param *parameters;  // 变量名称和数值
 	int flag;               // 标志位
+	char *arena;            // url_parse_v2分配的缓冲区，解析出的字符串及参数数组都在其中，随url_free释放
+	int arena_len;          // 缓冲区长度
+	bool indexed;           // slots是否有效
+	int slots[URL_KEY_SLOT_NUM]; // 常用参数在parameters中的下标+1，0表示不存在
 } url_t;
 
 
@@ -121,7 +143,7 @@ typedef struct _url_t {
 */
 url_t *url_parse(char *url_data);
 
-//解析串填充到url_t中
+//解析串填充到url_t中，只扫描一遍，所有字符串指向同一块缓冲区，pUrl需已清零
 int url_parse_v2(char *url_data, url_t *pUrl);
 
 //复制url_t src中的内容到url_t dest中
@@ -143,6 +165,12 @@ char *url_get_raw_parameter(url_t *url, const char *key);
 **/
 char *url_get_parameter_v2(url_t *url,const  char *key, char *prefix);
 
+/**
+* 按槽位返回常用参数的值，返回值是url中value的地址，不需要释放
+* 没有url_get_parameter_v2的前缀匹配及缺省值，参数不存在时返回NULL
+**/
+char *url_get_slot_parameter(url_t *url, url_key_slot slot);
+
 /**
 * 更新url结构体parameters的key属性对应的值，如果key不存在，则新建属性并赋值为value
 * 返回值： 0：更新成功，1，新建属性成功，-1：错误
@@ -65,6 +65,7 @@ registry_service_t *zk_get_registry_service(char* address) {
 	registry->registe = zk_registe;
 	registry->unregiste = zk_unregiste;
 	registry->subscribe = zk_subscribe;
+	registry->subscribe_delta = zk_subscribe_delta;
 	registry->unsubscribe = zk_unsubscribe;
 	registry->lookup = zk_lookup;
 	registry->getData = zk_getData;
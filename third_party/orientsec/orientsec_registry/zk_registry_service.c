@@ -25,8 +25,10 @@
 #include "orientsec_grpc_utils.h"
 #include "registry_utils.h"
 #include "zk_registry_service.h"
+#include "registry_notify_executor.h"
 #include"registry_contants.h"
 #include "orientsec_grpc_properties_tools.h"
+#include <stdlib.h>
 #include <string.h>
 #include <grpc/support/log.h>
 #include <grpc/support/alloc.h>
@@ -56,12 +58,30 @@ struct _zk_notify_node {
   gpr_mu mu;
   gpr_spinlock checker_notify_mu;
   registry_notify_f notify_func;
+  //增量订阅函数，为空时子节点变化以全量回调notify_func
+  registry_delta_notify_f delta_func;
   zk_notify_node* next;
   int live;  //是否有效，0： 有效，非0：已设置为删除，等待被删除
 };
 
 #define zk_notify_node_len (sizeof(struct _zk_notify_node))
 
+//订阅路径下的子节点缓存，按子节点名排序，未变化的子节点不再重复解析
+typedef struct _zk_child_node {
+  char* name;  //子节点名，未解码
+  url_t url;   //子节点名解码后的解析结果
+  int valid;   // protocol与host均不为空时有效
+} zk_child_node;
+
+//一次子节点变化，added为新增节点在缓存中的下标，
+// removed中的节点已移出缓存，通知结束后释放
+typedef struct _zk_children_delta {
+  int* added;
+  int added_num;
+  zk_child_node* removed;
+  int removed_num;
+} zk_children_delta;
+
 // 系统中包含的订阅url链表，每订阅一个node，生成一个zk_listener_list结构，
 typedef struct _zk_listener_node zk_listener_node;
 struct _zk_listener_node {
@@ -72,6 +92,15 @@ struct _zk_listener_node {
   zk_notify_node* notify_list_head;
   zk_listener_node* next;
   int live;  //是否有效，0： 有效，非0：已设置为删除，等待被删除
+  //保护子节点缓存，通知订阅函数期间持有
+  gpr_mu children_mu;
+  zk_child_node* children;
+  int children_num;
+  int children_synced;  //子节点缓存是否已从zk读取
+  //zk回调中读到、尚未被执行线程处理的子节点列表，只保留最新一次
+  gpr_mu pending_mu;
+  struct String_vector pending_children;
+  int children_pending;
 };
 
 #define zk_listener_node_len (sizeof(struct _zk_listener_node))
@@ -105,6 +134,13 @@ typedef enum _zk_connect_state {
 //  char passwd[128];
 //} zk_acl;
 
+//已确认存在的持久节点路径，创建子节点时不再逐级创建父节点
+typedef struct _zk_known_path zk_known_path;
+struct _zk_known_path {
+  char* path;
+  zk_known_path* next;
+};
+
 //每建立一个zk连接，生成一个如下结构对象，
 typedef struct _zk_connection_t zk_connection_t;
 struct _zk_connection_t {
@@ -117,6 +153,9 @@ struct _zk_connection_t {
   zk_connect_state connecte_state;               // zk连接状态
   zk_registy_url_node* url_list_head;            //注册的url链表
   int reconnectCount;                            //重连次数
+  gpr_mu known_mu;                               //保护known_paths
+  zk_known_path* known_paths;                    //已确认存在的持久节点
+  zhandle_t* auth_zh;                            //已调用zoo_add_auth的连接句柄
 };
 #define zk_connection_t_len (sizeof(struct _zk_connection_t))
 
@@ -136,6 +175,11 @@ static gpr_spinlock g_checker_conn_mu = GPR_SPINLOCK_STATIC_INITIALIZER;
 
 static bool g_initialized = false;
 
+void construct_empty_schema_url(const char* service_name, url_t* url);
+void zk_node_watcher_g(zhandle_t* zh, int type, int state, const char* path,
+                       void* watcherCtx);
+static void zk_clear_known_paths(zk_connection_t* conn);
+
 bool isZkConnected(zk_connection_t* conn) {
   if (conn && ((ZK_CONNECTED == conn->connecte_state) ||
                (ZK_RECONNECTED == conn->connecte_state) ||
@@ -310,26 +354,192 @@ void release_zk_listener_node_notify(zk_listener_node* p_listener_node) {
   }
 }
 
-//调用指定url的所有订阅函数
-void schedule_notify_func(zk_listener_node* p_listener_node, url_t* urls,
-                          int url_num) {
+//释放子节点缓存数组
+static void release_zk_child_nodes(zk_child_node* nodes, int num) {
+  int i = 0;
+  for (i = 0; i < num; i++) {
+    url_free(&nodes[i].url);
+    FREE_PTR(nodes[i].name);
+  }
+  FREE_PTR(nodes);
+}
+
+static void release_zk_children_delta(zk_children_delta* delta) {
+  release_zk_child_nodes(delta->removed, delta->removed_num);
+  FREE_PTR(delta->added);
+  memset(delta, 0, sizeof(zk_children_delta));
+}
+
+//释放订阅节点上的子节点缓存
+static void release_zk_listener_children(zk_listener_node* p_listener_node) {
+  gpr_mu_lock(&p_listener_node->children_mu);
+  release_zk_child_nodes(p_listener_node->children,
+                         p_listener_node->children_num);
+  p_listener_node->children = NULL;
+  p_listener_node->children_num = 0;
+  p_listener_node->children_synced = 0;
+  gpr_mu_unlock(&p_listener_node->children_mu);
+  gpr_mu_destroy(&p_listener_node->children_mu);
+  if (p_listener_node->children_pending) {
+    deallocate_String_vector(&p_listener_node->pending_children);
+    p_listener_node->children_pending = 0;
+  }
+  gpr_mu_destroy(&p_listener_node->pending_mu);
+}
+
+static int zk_child_name_cmp(const void* a, const void* b) {
+  return strcmp(*(char* const*)a, *(char* const*)b);
+}
+
+//将新读取的子节点与缓存做有序合并，只解析新增的子节点，
+//调用方需持有children_mu
+static void zk_listener_apply_children(zk_listener_node* p_listener_node,
+                                       struct String_vector* childs,
+                                       zk_children_delta* delta) {
+  zk_child_node* old_nodes = p_listener_node->children;
+  int old_num = p_listener_node->children_num;
+  zk_child_node* new_nodes = NULL;
+  int i = 0, j = 0, k = 0, cmp = 0;
+  char buf[ORIENTSEC_GRPC_PATH_MAX_LEN] = {0};
+  memset(delta, 0, sizeof(zk_children_delta));
+  if (childs->count > 0) {
+    qsort(childs->data, childs->count, sizeof(char*), zk_child_name_cmp);
+    new_nodes =
+        (zk_child_node*)gpr_zalloc(childs->count * sizeof(zk_child_node));
+    delta->added = (int*)gpr_zalloc(childs->count * sizeof(int));
+  }
+  if (old_num > 0) {
+    delta->removed = (zk_child_node*)gpr_zalloc(old_num * sizeof(zk_child_node));
+  }
+  while (i < old_num || j < childs->count) {
+    if (i >= old_num) {
+      cmp = 1;
+    } else if (j >= childs->count) {
+      cmp = -1;
+    } else {
+      cmp = strcmp(old_nodes[i].name, childs->data[j]);
+    }
+    if (cmp < 0) {
+      //已删除的子节点
+      delta->removed[delta->removed_num++] = old_nodes[i++];
+    } else if (cmp > 0) {
+      //新增的子节点，只在此处解析一次
+      new_nodes[k].name = gprc_strdup(childs->data[j++]);
+      memset(buf, 0, ORIENTSEC_GRPC_PATH_MAX_LEN);
+      url_decode_buf(new_nodes[k].name, buf, ORIENTSEC_GRPC_PATH_MAX_LEN);
+      url_parse_v2(buf, &new_nodes[k].url);
+      new_nodes[k].valid =
+          (new_nodes[k].url.protocol != NULL && new_nodes[k].url.host != NULL);
+      delta->added[delta->added_num++] = k++;
+    } else {
+      //未变化的子节点沿用缓存中的解析结果
+      new_nodes[k++] = old_nodes[i++];
+      j++;
+    }
+  }
+  FREE_PTR(old_nodes);
+  p_listener_node->children = new_nodes;
+  p_listener_node->children_num = k;
+  p_listener_node->children_synced = 1;
+}
+
+//从缓存构造全量url列表，url指向缓存，不需释放。
+//对于子节点为空的情形，返回一个empty://0.0.0.0/service_name格式url,
+// owned置1，由zk_release_full_urls释放
+static url_t* zk_listener_full_urls(zk_listener_node* p_listener_node,
+                                    int* urls_num, int* owned) {
+  int i = 0;
+  char buf[ORIENTSEC_GRPC_PATH_MAX_LEN] = {0};
+  url_t* urls = (url_t*)gpr_zalloc((p_listener_node->children_num + 1) *
+                                   sizeof(url_t));
+  *urls_num = 0;
+  *owned = 0;
+  for (i = 0; i < p_listener_node->children_num; i++) {
+    if (p_listener_node->children[i].valid) {
+      memcpy(&urls[(*urls_num)++], &p_listener_node->children[i].url,
+             sizeof(url_t));
+    }
+  }
+  if (*urls_num == 0) {
+    get_service_name_from_path(p_listener_node->url_full_string, buf,
+                               ORIENTSEC_GRPC_PATH_MAX_LEN);
+    construct_empty_schema_url(buf, urls);
+    *urls_num = 1;
+    *owned = 1;
+  }
+  return urls;
+}
+
+static void zk_release_full_urls(url_t* urls, int owned) {
+  if (owned) {
+    url_free(urls);
+  }
+  gpr_free(urls);
+}
+
+//调用指定url的所有订阅函数，全量订阅函数收到缓存中的全部url，
+//增量订阅函数只在有效子节点有变化时收到增量。skip为不需通知的订阅函数节点。
+//调用方需持有children_mu。订阅函数在释放订阅函数链表的锁后调用，
+//执行期间可以增删订阅
+void schedule_notify_func(zk_listener_node* p_listener_node,
+                          zk_children_delta* delta, zk_notify_node* skip) {
   zk_notify_node* p0 = NULL;
-  if (!p_listener_node) {
+  url_t* urls = NULL;
+  url_t* added = NULL;
+  url_t* removed = NULL;
+  registry_notify_f* notify_funcs = NULL;
+  registry_delta_notify_f* delta_funcs = NULL;
+  int urls_num = 0, added_num = 0, removed_num = 0;
+  int owned = 0;
+  int funcs_num = 0, funcs_cap = 0;
+  int i = 0;
+  if (!p_listener_node || !delta) {
     return;
   }
-  p0 = p_listener_node->notify_list_head->next;
-  if (gpr_spinlock_trylock(
-          &p_listener_node->notify_list_head->checker_notify_mu)) {
-    gpr_mu_lock(&p_listener_node->notify_list_head->mu);
-    while (p0) {
-      if (0 == p0->live) {
-        (p0->notify_func)(urls, url_num);
-      }
-      p0 = p0->next;
+  urls = zk_listener_full_urls(p_listener_node, &urls_num, &owned);
+  added = (url_t*)gpr_zalloc((delta->added_num + 1) * sizeof(url_t));
+  for (i = 0; i < delta->added_num; i++) {
+    zk_child_node* child = &p_listener_node->children[delta->added[i]];
+    if (child->valid) {
+      memcpy(&added[added_num++], &child->url, sizeof(url_t));
+    }
+  }
+  removed = (url_t*)gpr_zalloc((delta->removed_num + 1) * sizeof(url_t));
+  for (i = 0; i < delta->removed_num; i++) {
+    if (delta->removed[i].valid) {
+      memcpy(&removed[removed_num++], &delta->removed[i].url, sizeof(url_t));
     }
-    gpr_mu_unlock(&p_listener_node->notify_list_head->mu);
-    gpr_spinlock_unlock(&p_listener_node->notify_list_head->checker_notify_mu);
   }
+  //不使用trylock，订阅函数链表正被修改时等待而不是跳过本次通知
+  gpr_mu_lock(&p_listener_node->notify_list_head->mu);
+  for (p0 = p_listener_node->notify_list_head->next; p0; p0 = p0->next) {
+    if (0 != p0->live || p0 == skip) {
+      continue;
+    }
+    if (funcs_num == funcs_cap) {
+      funcs_cap = funcs_cap ? funcs_cap * 2 : 4;
+      notify_funcs = (registry_notify_f*)gpr_realloc(
+          notify_funcs, funcs_cap * sizeof(registry_notify_f));
+      delta_funcs = (registry_delta_notify_f*)gpr_realloc(
+          delta_funcs, funcs_cap * sizeof(registry_delta_notify_f));
+    }
+    notify_funcs[funcs_num] = p0->notify_func;
+    delta_funcs[funcs_num] = p0->delta_func;
+    funcs_num++;
+  }
+  gpr_mu_unlock(&p_listener_node->notify_list_head->mu);
+  for (i = 0; i < funcs_num; i++) {
+    if (delta_funcs[i] == NULL) {
+      (notify_funcs[i])(urls, urls_num);
+    } else if (added_num > 0 || removed_num > 0) {
+      (delta_funcs[i])(added, added_num, removed, removed_num);
+    }
+  }
+  gpr_free(notify_funcs);
+  gpr_free(delta_funcs);
+  gpr_free(added);
+  gpr_free(removed);
+  zk_release_full_urls(urls, owned);
 }
 
 //订阅列表操作函数，创建列表节点，分配空间。
@@ -346,6 +556,14 @@ zk_listener_node* new_zk_listener_node(bool bHead) {
     new_node->notify_list_head = new_zk_notify_node(NULL, true);
     GPR_ASSERT(NULL != new_node->notify_list_head);
     new_node->url_full_string[0] = '\0';
+    gpr_mu_init(&new_node->children_mu);
+    new_node->children = NULL;
+    new_node->children_num = 0;
+    new_node->children_synced = 0;
+    gpr_mu_init(&new_node->pending_mu);
+    new_node->pending_children.count = 0;
+    new_node->pending_children.data = NULL;
+    new_node->children_pending = 0;
   } else {
     gpr_log(GPR_ERROR, "alloc zk_listener_node failed");
   }
@@ -425,7 +643,8 @@ zk_notify_node* lookup_notify_node(zk_listener_node* p_listener_node,
 
 //将订阅函数加到指定url 链表中
 zk_notify_node* get_zk_listener_notify_node(zk_connection_t* conn, char* url,
-                                            registry_notify_f notify_func) {
+                                            registry_notify_f notify_func,
+                                            registry_delta_notify_f delta_func) {
   zk_listener_node* p_listener_node = get_zk_listener_node(conn, url);
   zk_notify_node* p_notify_node = NULL;
   if (p_listener_node) {
@@ -446,13 +665,20 @@ zk_notify_node* get_zk_listener_notify_node(zk_connection_t* conn, char* url,
         }
       }
     }
+    //同一订阅函数再次订阅时以最近一次的增量订阅函数为准
+    if (p_notify_node) {
+      p_notify_node->delta_func = delta_func;
+    }
   }
   return p_notify_node;
 }
 
-//移除某个url订阅链表
+//移除某个url订阅链表。
+//先在链表锁内摘除节点，之后zk回调和通知执行线程都查找不到该节点；
+//再在锁外取消并等待该路径上的通知，执行中的通知查找节点时需要链表锁
 void remove_zk_listener_node(zk_connection_t* conn, char* url) {
   zk_listener_node *p0 = NULL, *p1 = NULL;
+  gpr_mu_lock(&conn->listener_list_head->mu);
   p0 = conn->listener_list_head;
   p1 = p0->next;
   while (p1) {
@@ -463,8 +689,14 @@ void remove_zk_listener_node(zk_connection_t* conn, char* url) {
     p1 = p1->next;
   }
   if (p1) {
-    release_zk_listener_node_notify(p1);
     p0->next = p1->next;
+  }
+  gpr_mu_unlock(&conn->listener_list_head->mu);
+  if (p1) {
+    //尚未执行的通知不再执行，正在执行的通知结束后才能释放节点
+    registry_notify_executor_cancel_path(conn, p1->url_full_string);
+    release_zk_listener_node_notify(p1);
+    release_zk_listener_children(p1);
     FREE_PTR(p1);
   }
   return;
@@ -494,6 +726,9 @@ zk_connection_t* zk_connection_t_new(char* address) {
     new_node->url_list_head = new_zk_registy_url_node(NULL, true);
     new_node->listener_list_head = new_zk_listener_node(true);
     new_node->reconnectCount = 0;
+    gpr_mu_init(&new_node->known_mu);
+    new_node->known_paths = NULL;
+    new_node->auth_zh = NULL;
     if (address) {
       address_len = strlen(address);
       snprintf(new_node->zk_address,
@@ -558,6 +793,8 @@ void release_zk_conneciton(zk_connection_t* conn) {
   zk_notify_node *notify_node = NULL, *notify_node_0 = NULL;
   zk_registy_url_node *registry_url_node = NULL, *registry_url_node_0 = NULL;
   if (!conn) return;
+  //连接上尚未执行的通知不再执行
+  registry_notify_executor_cancel(conn);
   if (gpr_spinlock_trylock(&g_checker_conn_mu)) {
     gpr_mu_lock(&g_conn_mu);
     p0 = p_zk_connection_list_head;
@@ -598,6 +835,7 @@ void release_zk_conneciton(zk_connection_t* conn) {
           }
 
           FREE_PTR(listner_node_0->notify_list_head);
+          release_zk_listener_children(listner_node_0);
 
           FREE_PTR(listner_node_0);
           listner_node_0 = listner_node->next;
@@ -624,6 +862,7 @@ void release_zk_conneciton(zk_connection_t* conn) {
         gpr_spinlock_unlock(&p1->url_list_head->checker_registry_mu);
       }
       FREE_PTR(p1->url_list_head);
+      zk_clear_known_paths(p1);
 
       FREE_PTR(p1);
     }
@@ -796,105 +1035,179 @@ static char* get_acl_param() {
   return (char*)szDigestIds;
 }
 
-//在zookeeper 上创建节点
-void zk_create_node(zk_connection_t* conn, char* path, bool dynamic) {
-  zhandle_t* zkhandle = conn->zh;
-  char buf[ORIENTSEC_GRPC_PATH_MAX_LEN] = {0};
-  char* p = NULL;
-  int ret = 0;
-  if (!path || 0 == strlen(path)) {
-    return;
-  }
-  int root_len = strlen(ORIENTSEC_GRPC_REGISTRY_ROOT);
-  // 对于root，不能acl注册
-  if (root_len >= strlen(path)) {
-    p = strrchr(path, '/');
-    if (p) {
-      snprintf(buf, p - path + 1, "%s", path);
-      zk_create_node(conn, buf, false);
+static bool zk_is_known_path(zk_connection_t* conn, const char* path) {
+  zk_known_path* p = NULL;
+  bool found = false;
+  gpr_mu_lock(&conn->known_mu);
+  for (p = conn->known_paths; p; p = p->next) {
+    if (0 == strcmp(p->path, path)) {
+      found = true;
+      break;
     }
+  }
+  gpr_mu_unlock(&conn->known_mu);
+  return found;
+}
 
-    if (dynamic) {
-      ret = zoo_create(zkhandle, path, NULL, -1, &ZOO_OPEN_ACL_UNSAFE,
-                        ZOO_EPHEMERAL, NULL, 0);
-    } else {
-      ret = zoo_create(zkhandle, path, NULL, -1, &ZOO_OPEN_ACL_UNSAFE, 0,
-                        NULL, 0);
-    }
-    if (ZOK == ret) {
-      gpr_log(GPR_INFO, "create root node success[%s]", path);
-    } else if (ZNODEEXISTS == ret) {
-      gpr_log(GPR_INFO, "root node %s exists", path);
-    } else {
-      gpr_log(GPR_ERROR,
-              "create root node faild[%s],reason=[%s],error code=%d", path,
-              zerror(ret), ret);
-    }
+static void zk_add_known_path(zk_connection_t* conn, const char* path) {
+  zk_known_path* p = NULL;
+  if (zk_is_known_path(conn, path)) {
     return;
- }
-  p = strrchr(path, '/');
-  if (p) {
-    snprintf(buf, p - path + 1, "%s", path);
-    zk_create_node(conn, buf, false);
   }
+  p = (zk_known_path*)gpr_zalloc(sizeof(zk_known_path));
+  p->path = gprc_strdup(path);
+  gpr_mu_lock(&conn->known_mu);
+  p->next = conn->known_paths;
+  conn->known_paths = p;
+  gpr_mu_unlock(&conn->known_mu);
+}
 
-  if (g_acl_flag) {
-  
-    // 1.create ACL \ZOO_CREATOR_ALL_ACL
-    // 2.zoo_add_auth 应用程序使用zoo_add_auth方法来向服务器认证自己
-
-    size_t length = 0;
-    char* plain = combine_name_pwd(zk_acl_name, zk_acl_pwd, &length);
-    ret = zoo_add_auth(zkhandle, "digest", plain, length, 0, 0);
-    if (ZOK != ret)
-      gpr_log(GPR_ERROR, "Auth failed,zoo_add_auth = %d!!", ret);
-
-    // enc格式digest ID为 userName:base64(sha1(userName:password))
-    char enc[64] = {0};
-    strcpy(enc, get_acl_param()); 
-
-    //设置ACL_vector
-    struct ACL _CREATOR_ALL_ACL_ACL[] = {{0x1f, {"digest", enc}}};
-    struct ACL_vector ZOO_CREATOR_ALL_ACL = {1, _CREATOR_ALL_ACL_ACL};
+static void zk_clear_known_paths(zk_connection_t* conn) {
+  zk_known_path *p = NULL, *next = NULL;
+  gpr_mu_lock(&conn->known_mu);
+  p = conn->known_paths;
+  conn->known_paths = NULL;
+  gpr_mu_unlock(&conn->known_mu);
+  while (p) {
+    next = p->next;
+    FREE_PTR(p->path);
+    FREE_PTR(p);
+    p = next;
+  }
+}
 
-    if (dynamic) {
-      ret = zoo_create(zkhandle, path, NULL, -1, &ZOO_CREATOR_ALL_ACL, ZOO_EPHEMERAL, NULL, 0);
-   
-    } else {
-      ret = zoo_create(zkhandle, path, NULL, -1, &ZOO_CREATOR_ALL_ACL, 0, NULL, 0);
+//异步创建节点的上下文，在完成回调中释放
+typedef struct _zk_create_ctx {
+  zk_connection_t* conn;
+  char* path;
+  bool dynamic;
+  int retry;  //父节点不存在时重建父节点的剩余次数
+} zk_create_ctx;
+
+static void zk_acreate_node(zk_connection_t* conn, const char* path,
+                            bool dynamic, int retry);
+
+static void zk_create_completion(int rc, const char* value, const void* data) {
+  zk_create_ctx* ctx = (zk_create_ctx*)data;
+  if (ZOK == rc || ZNODEEXISTS == rc) {
+    if (!ctx->dynamic) {
+      zk_add_known_path(ctx->conn, ctx->path);
     }
-    //reset enc
-    memset(enc, 0, 64);
-    memset(_CREATOR_ALL_ACL_ACL, 0, sizeof(_CREATOR_ALL_ACL_ACL));
-    //memset(ZOO_CREATOR_ALL_ACL, 0, sizeof(ZOO_CREATOR_ALL_ACL));
+    gpr_log(GPR_INFO, "create zk node success[%s],code=%d", ctx->path, rc);
+  } else if (ZNONODE == rc && ctx->retry > 0) {
+    //缓存的父节点已被删除，清空后重新逐级创建
+    zk_clear_known_paths(ctx->conn);
+    zk_acreate_node(ctx->conn, ctx->path, ctx->dynamic, ctx->retry - 1);
+  } else {
+    gpr_log(GPR_ERROR, "create zk node faild[%s],reason=[%s],error code=%d",
+            ctx->path, zerror(rc), rc);
+  }
+  FREE_PTR(ctx->path);
+  FREE_PTR(ctx);
+}
 
-    if (ZOK == ret) {
-      gpr_log(GPR_INFO, "create zk acl node success[%s]", path);
-    } else if (ZNODEEXISTS == ret) {
-      gpr_log(GPR_INFO, "zk acl node %s exists", path);
-    } else {
-      gpr_log(GPR_ERROR, "create zk acl node faild[%s],reason=[%s],error code=%d",
-              path, zerror(ret), ret);
+//发出单个节点的异步创建请求
+static void zk_acreate_one(zk_connection_t* conn, const char* path,
+                           bool dynamic, int retry) {
+  const struct ACL_vector* acl = &ZOO_OPEN_ACL_UNSAFE;
+  struct ACL creator_all_acl[1];
+  struct ACL_vector creator_all_acl_vector;
+  char enc[64] = {0};
+  size_t length = 0;
+  int ret = 0;
+  zk_create_ctx* ctx = NULL;
+  // 对于root，不能acl注册
+  if (g_acl_flag && strlen(path) > strlen(ORIENTSEC_GRPC_REGISTRY_ROOT)) {
+    // 1.create ACL \ZOO_CREATOR_ALL_ACL
+    // 2.zoo_add_auth 应用程序使用zoo_add_auth方法来向服务器认证自己，
+    //   认证信息保存在连接句柄中，重连后由客户端自动重发，每个句柄只需一次
+    if (conn->auth_zh != conn->zh) {
+      char* plain = combine_name_pwd(zk_acl_name, zk_acl_pwd, &length);
+      ret = zoo_add_auth(conn->zh, "digest", plain, length, 0, 0);
+      if (ZOK != ret) {
+        gpr_log(GPR_ERROR, "Auth failed,zoo_add_auth = %d!!", ret);
+      } else {
+        conn->auth_zh = conn->zh;
+      }
     }
-  }else {// acl 没有开启
-    if (dynamic) {
-      ret = zoo_create(zkhandle, path, NULL, -1, &ZOO_OPEN_ACL_UNSAFE,
-                       ZOO_EPHEMERAL, NULL, 0);
-    } else {
-      ret = zoo_create(zkhandle, path, NULL, -1, &ZOO_OPEN_ACL_UNSAFE, 0, NULL, 0);
+    // enc格式digest ID为 userName:base64(sha1(userName:password))
+    strcpy(enc, get_acl_param());
+    creator_all_acl[0].perms = 0x1f;
+    creator_all_acl[0].id.scheme = "digest";
+    creator_all_acl[0].id.id = enc;
+    creator_all_acl_vector.count = 1;
+    creator_all_acl_vector.data = creator_all_acl;
+    acl = &creator_all_acl_vector;
+  }
+  ctx = (zk_create_ctx*)gpr_zalloc(sizeof(zk_create_ctx));
+  ctx->conn = conn;
+  ctx->path = gprc_strdup(path);
+  ctx->dynamic = dynamic;
+  ctx->retry = retry;
+  //请求在调用返回前已序列化，acl不需要在回调前保持有效
+  ret = zoo_acreate(conn->zh, path, NULL, -1, acl, dynamic ? ZOO_EPHEMERAL : 0,
+                    zk_create_completion, ctx);
+  memset(enc, 0, sizeof(enc));
+  if (ZOK != ret) {
+    gpr_log(GPR_ERROR, "create zk node faild[%s],reason=[%s],error code=%d",
+            path, zerror(ret), ret);
+    FREE_PTR(ctx->path);
+    FREE_PTR(ctx);
+  }
+}
+
+//异步创建节点：按顺序发出未确认存在的各级父节点及节点本身的创建请求。
+//同一会话中的请求按发送顺序执行，不需要等待父节点创建完成，
+//多个节点的创建请求可以连续发出，总耗时约为一次往返
+static void zk_acreate_node(zk_connection_t* conn, const char* path,
+                            bool dynamic, int retry) {
+  char buf[ORIENTSEC_GRPC_PATH_MAX_LEN] = {0};
+  const char* p = NULL;
+  if (!conn || !path || 0 == strlen(path)) {
+    return;
+  }
+  for (p = strchr(path + 1, '/'); p; p = strchr(p + 1, '/')) {
+    if (p - path >= ORIENTSEC_GRPC_PATH_MAX_LEN) {
+      break;
     }
-    if (ZOK == ret) {
-      gpr_log(GPR_INFO, "create zk node success[%s]", path);
-    } else if (ZNODEEXISTS == ret) {
-      gpr_log(GPR_INFO, "zk node %s exists", path);
-    } else {
-      gpr_log(GPR_ERROR, "create zk node faild[%s],reason=[%s],error code=%d",
-              path, zerror(ret), ret);
+    snprintf(buf, p - path + 1, "%s", path);
+    if (!zk_is_known_path(conn, buf)) {
+      zk_acreate_one(conn, buf, false, 0);
     }
   }
+  if (dynamic || !zk_is_known_path(conn, path)) {
+    zk_acreate_one(conn, path, dynamic, retry);
+  }
 }
 
-//在zk上删除指定节点
+//在zookeeper 上创建节点，异步执行，结果在完成回调中记录
+void zk_create_node(zk_connection_t* conn, char* path, bool dynamic) {
+  zk_acreate_node(conn, path, dynamic, 1);
+}
+
+static void zk_delete_completion(int rc, const void* data) {
+  char* path = (char*)data;
+  if (ZOK == rc) {
+    gpr_log(GPR_INFO, "delete zk node success[%s]", path);
+  } else {
+    gpr_log(GPR_ERROR, "delete zk node faild[%s],reason=[%s],error code=%d",
+            path, zerror(rc), rc);
+  }
+  FREE_PTR(path);
+}
+
+//异步删除指定节点，用于恢复时批量删除已取消注册的节点
+static void zk_adelete_node(zk_connection_t* conn, char* path) {
+  char* ctx = gprc_strdup(path);
+  int ret = zoo_adelete(conn->zh, path, -1, zk_delete_completion, ctx);
+  if (ZOK != ret) {
+    gpr_log(GPR_ERROR, "delete zk node faild[%s],reason=[%s],error code=%d",
+            path, zerror(ret), ret);
+    FREE_PTR(ctx);
+  }
+}
+
+//在zk上删除指定节点，取消注册需要根据删除结果清理注册链表，保持同步调用
 int zk_delete_node(zk_connection_t* conn, char* path) {
   zhandle_t* zkhandle = conn->zh;
   int ret = 0;
@@ -964,77 +1277,117 @@ void construct_empty_schema_url(const char* service_name, url_t* url) {
   return;
 }
 
-//节点监控函数
-void zk_node_watcher_g(zhandle_t* zh, int type, int state, const char* path,
-                       void* watcherCtx) {
-  zk_notify_node* p_notify_node = NULL;
+//异步读取子节点的上下文，在完成回调中释放。
+//订阅节点可能在回调前被取消，回调中按路径重新查找
+typedef struct _zk_children_ctx {
+  zk_connection_t* conn;
+  char* path;
+} zk_children_ctx;
+
+//在通知执行线程中处理一个订阅路径上的变化：取出最新的子节点列表，
+//与缓存比较后通知订阅函数
+static void zk_children_dispatch(void* owner, const char* path) {
+  zk_connection_t* conn = (zk_connection_t*)owner;
+  zk_listener_node* p_listener_node = NULL;
   struct String_vector childs;
-  url_t* urls = NULL;
-  int urls_num = 0;
-  size_t i = 0;
-  int ret = 0;
-  char buf[ORIENTSEC_GRPC_PATH_MAX_LEN] = {0};
-  zk_connection_t* conn = (zk_connection_t*)watcherCtx;
-  zk_listener_node* p_listener_node = lookup_listener_node(conn, path);
-  if (!conn || !p_listener_node) {
+  zk_children_delta delta;
+  //节点在执行期间被摘除时，remove_zk_listener_node等待本任务结束后才释放
+  gpr_mu_lock(&conn->listener_list_head->mu);
+  p_listener_node = lookup_listener_node(conn, (char*)path);
+  gpr_mu_unlock(&conn->listener_list_head->mu);
+  if (!p_listener_node) {
     return;
   }
-  if (ZOO_CHILD_EVENT != type) {
+  gpr_mu_lock(&p_listener_node->pending_mu);
+  childs = p_listener_node->pending_children;
+  p_listener_node->pending_children.count = 0;
+  p_listener_node->pending_children.data = NULL;
+  if (!p_listener_node->children_pending) {
+    //已被之前的任务处理
+    gpr_mu_unlock(&p_listener_node->pending_mu);
     return;
   }
-  ret = zoo_wget_children(conn->zh, path, zk_node_watcher_g, (void*)conn,
-                          &childs);
-  if (ZOK == ret) {
-    /*对childs分析，删除无效节点by lm*/
-    url_t* myurl;
-    int url_valid = childs.count;
-    int url_curse = 0;
-    urls_num = childs.count;
-    myurl = (url_t*)gpr_zalloc(1 * sizeof(url_t));
-    if (urls_num ==
-        0)  //对于子节点为空的情形，返回一个empty://0.0.0.0/service_name格式url
-    {
-    } else {
-      urls = (url_t*)gpr_zalloc(urls_num * sizeof(url_t));
-      for (i = 0; i < urls_num; i++) {
-        memset(buf, 0, ORIENTSEC_GRPC_PATH_MAX_LEN);
-        url_decode_buf(childs.data[i], buf, ORIENTSEC_GRPC_PATH_MAX_LEN);
-        url_parse_v2(buf, myurl);
-        if (myurl->protocol == NULL || myurl->host == NULL) {
-          url_valid--;
-          memcpy(&urls[url_valid], myurl, sizeof(url_t));
-          memset(myurl, 0, sizeof(url_t));
-        } else {
-          memcpy(&urls[url_curse], myurl, sizeof(url_t));
-          memset(myurl, 0, sizeof(url_t));
-          url_curse++;
-        }
-      }
-      for (i = 0; i < childs.count - url_valid; i++) {
-        url_free(&urls[url_curse + i]);
-      }
+  p_listener_node->children_pending = 0;
+  gpr_mu_unlock(&p_listener_node->pending_mu);
+
+  gpr_mu_lock(&p_listener_node->children_mu);
+  zk_listener_apply_children(p_listener_node, &childs, &delta);
+  schedule_notify_func(p_listener_node, &delta, NULL);
+  release_zk_children_delta(&delta);
+  gpr_mu_unlock(&p_listener_node->children_mu);
+  deallocate_String_vector(&childs);
+}
+
+//只保存读到的子节点列表并登记到通知执行器，不在zk事件线程中调用订阅函数。
+//执行前再次读到的列表覆盖之前的列表
+static void zk_children_completion(int rc, const struct String_vector* strings,
+                                   const void* data) {
+  zk_children_ctx* ctx = (zk_children_ctx*)data;
+  zk_listener_node* p_listener_node = NULL;
+  int i = 0;
+  //查找、保存和登记都在链表锁内，节点摘除后的取消不会遗漏本次登记
+  gpr_mu_lock(&ctx->conn->listener_list_head->mu);
+  p_listener_node = lookup_listener_node(ctx->conn, ctx->path);
+  if (ZOK != rc) {
+    gpr_log(GPR_ERROR, "get children of [%s] faild,error code=%d,reason=%s",
+            ctx->path, rc, zerror(rc));
+  } else if (p_listener_node && strings) {
+    //回调中的子节点数组在返回后由zk释放，需复制
+    gpr_mu_lock(&p_listener_node->pending_mu);
+    if (p_listener_node->children_pending) {
+      deallocate_String_vector(&p_listener_node->pending_children);
     }
-    urls_num = url_valid;
-    if (url_valid == 0) {
-      urls_num = 1;
-      urls = (url_t*)gpr_zalloc(urls_num * sizeof(url_t));
-      get_service_name_from_path(p_listener_node->url_full_string, buf,
-                                 ORIENTSEC_GRPC_PATH_MAX_LEN);
-      construct_empty_schema_url(buf, urls);
+    p_listener_node->pending_children.count = strings->count;
+    p_listener_node->pending_children.data =
+        strings->count > 0 ? (char**)calloc(strings->count, sizeof(char*))
+                           : NULL;
+    for (i = 0; i < strings->count; i++) {
+      p_listener_node->pending_children.data[i] = gprc_strdup(strings->data[i]);
     }
-    url_free(myurl);
-    if (NULL != myurl) gpr_free(myurl);
-    /*end by lm*/
+    p_listener_node->children_pending = 1;
+    gpr_mu_unlock(&p_listener_node->pending_mu);
+    registry_notify_executor_post(zk_children_dispatch, ctx->conn, ctx->path);
+  }
+  gpr_mu_unlock(&ctx->conn->listener_list_head->mu);
+  FREE_PTR(ctx->path);
+  FREE_PTR(ctx);
+}
 
-    schedule_notify_func(p_listener_node, urls, urls_num);
-    for (i = 0; i < urls_num; i++) {
-      url_free(urls + i);
-    }
-    gpr_free(urls);
+//异步读取子节点并重新设置监听，结果在完成回调中与缓存比较后通知订阅函数。
+//不阻塞调用线程，可在zk事件线程中调用，多个路径的读取可以连续发出
+static int zk_listener_refresh(zk_connection_t* conn,
+                               zk_listener_node* p_listener_node) {
+  int ret = 0;
+  zk_children_ctx* ctx = (zk_children_ctx*)gpr_zalloc(sizeof(zk_children_ctx));
+  ctx->conn = conn;
+  ctx->path = gprc_strdup(p_listener_node->url_full_string);
+  ret = zoo_awget_children(conn->zh, ctx->path, zk_node_watcher_g, (void*)conn,
+                           zk_children_completion, ctx);
+  if (ZOK != ret) {
+    FREE_PTR(ctx->path);
+    FREE_PTR(ctx);
   }
-  deallocate_String_vector(&childs);
+  return ret;
+}
+
+//节点监控函数
+void zk_node_watcher_g(zhandle_t* zh, int type, int state, const char* path,
+                       void* watcherCtx) {
+  zk_connection_t* conn = (zk_connection_t*)watcherCtx;
+  zk_listener_node* p_listener_node = NULL;
+  if (!conn || ZOO_CHILD_EVENT != type) {
+    return;
+  }
+  gpr_mu_lock(&conn->listener_list_head->mu);
+  p_listener_node = lookup_listener_node(conn, (char*)path);
+  if (p_listener_node) {
+    //只解析新增的子节点，未变化的子节点沿用缓存
+    zk_listener_refresh(conn, p_listener_node);
+  }
+  gpr_mu_unlock(&conn->listener_list_head->mu);
 }
 
+//恢复注册与订阅，在zk事件线程中调用，所有请求异步连续发出，不等待结果
 void registy_recover(zk_connection_t* conn) {
   zk_listener_node *p_listener_node = NULL, *p_listener_node0 = NULL;
   zk_registy_url_node *p_registry_node = NULL, *p_registry_node0 = NULL;
@@ -1042,7 +1395,6 @@ void registy_recover(zk_connection_t* conn) {
   url_t* url = NULL;
   char buf[ORIENTSEC_GRPC_PATH_MAX_LEN] = {0};
   int ret = 0;
-  struct String_vector childs;
   if (!conn || ZK_MANU_RECONNECTED != conn->connecte_state) {
     return;
   }
@@ -1066,7 +1418,7 @@ void registy_recover(zk_connection_t* conn) {
       memset(buf, 0, ORIENTSEC_GRPC_PATH_MAX_LEN);
       url = url_parse(p_registry_node->urlStr);
       p = zk_get_url_path(url);
-      zk_delete_node(conn, p);
+      zk_adelete_node(conn, p);
       url_free(url);
       FREE_PTR(p);
 
@@ -1077,14 +1429,16 @@ void registy_recover(zk_connection_t* conn) {
       p_registry_node = p_registry_node0->next;
     }
   }
+  //读取为异步请求，可在链表锁内连续发出
+  gpr_mu_lock(&conn->listener_list_head->mu);
   p_listener_node0 = conn->listener_list_head;
   p_listener_node = p_listener_node0->next;
   while (p_listener_node) {
     if (0 == p_listener_node->live) {
-      ret = zoo_wget_children(conn->zh, p_listener_node->url_full_string,
-                              zk_node_watcher_g, (void*)conn, &childs);
+      //断线期间的子节点变化与缓存比较后补发通知，各路径的读取连续发出
+      ret = zk_listener_refresh(conn, p_listener_node);
       if (ZOK == ret) {
-        gpr_log(GPR_INFO, "recover connection [%s] subscribe[%s] success\n",
+        gpr_log(GPR_INFO, "recover connection [%s] subscribe[%s] sent\n",
                 conn->zk_address, p_listener_node->url_full_string);
       } else {
         gpr_log(GPR_ERROR,
@@ -1096,6 +1450,7 @@ void registy_recover(zk_connection_t* conn) {
     }
     p_listener_node = p_listener_node->next;
   }
+  gpr_mu_unlock(&conn->listener_list_head->mu);
 }
 
 //连接zk,keepSession:   0：新建session，1：使用原session,
@@ -1228,20 +1583,21 @@ void zk_unregiste(registry_service_args_t* param, url_t* url) {
     gpr_free(url_full_path);
   }
 }
-void zk_subscribe(registry_service_args_t* param, url_t* url,
-                  registry_notify_f notify) {
+static void zk_subscribe_internal(registry_service_args_t* param, url_t* url,
+                                  registry_notify_f notify,
+                                  registry_delta_notify_f delta_notify) {
   zk_connection_t* conn = NULL;
   char* url_category_path = NULL;
   zk_listener_node* p_listener_node = NULL;
   zk_notify_node* p_notify_node = NULL;
   struct String_vector childs;
+  zk_children_delta delta;
   childs.count = 0;
   childs.data = NULL;
   url_t* urls = NULL;
   int urls_num = 0;
-  size_t i = 0;
-  int ret = 0;
-  char buf[ORIENTSEC_GRPC_PATH_MAX_LEN] = {0};
+  int owned = 0;
+  int ret = ZOK;
   if (!param || !url) {
     gpr_log(GPR_INFO, "zk_subscribe failed for param or url is null");
     return;
@@ -1249,69 +1605,36 @@ void zk_subscribe(registry_service_args_t* param, url_t* url,
   conn = (zk_connection_t*)(param->param->data);
   if (!conn) return;
   url_category_path = zk_get_category_path(url);
+  //创建请求异步发出，之后的读取在同一会话中按顺序执行，读到的是创建后的节点
   zk_create_node(conn, url_category_path, false);
   p_listener_node = lookup_listener_node(conn, url_category_path);
 
-  p_notify_node = get_zk_listener_notify_node(conn, url_category_path, notify);
+  p_notify_node = get_zk_listener_notify_node(conn, url_category_path, notify,
+                                              delta_notify);
 
-  //读取子节点信息
-  if (p_listener_node) {
-    ret = zoo_get_children(conn->zh, url_category_path, 0, &childs);
-  } else {
+  //读取子节点信息，子节点缓存已同步时由监听维护，不再读取
+  if (!p_listener_node) {
     ret = zoo_wget_children(conn->zh, url_category_path, zk_node_watcher_g,
                             (void*)conn, &childs);
+  } else if (!p_listener_node->children_synced) {
+    ret = zoo_get_children(conn->zh, url_category_path, 0, &childs);
   }
 
   if (ZOK == ret) {
     p_listener_node = get_zk_listener_node(conn, url_category_path);
     if (p_listener_node) {
-      /*对childs分析，删除无效节点by lm*/
-      url_t* myurl;
-      int url_valid = childs.count;
-      int url_curse = 0;
-      urls_num = childs.count;
-      myurl = (url_t*)gpr_zalloc(1 * sizeof(url_t));
-      //对于子节点为空的情形，返回一个empty://0.0.0.0/service_name格式url
-      if (urls_num == 0)  
-      {
-      } else {
-        urls = (url_t*)gpr_zalloc(urls_num * sizeof(url_t));
-        for (i = 0; i < urls_num; i++) {
-          memset(buf, 0, ORIENTSEC_GRPC_PATH_MAX_LEN);
-          url_decode_buf(childs.data[i], buf, ORIENTSEC_GRPC_PATH_MAX_LEN);
-          url_parse_v2(buf, myurl);
-          if (myurl->protocol == NULL || myurl->host == NULL) {
-            url_valid--;
-            memcpy(&urls[url_valid], myurl, sizeof(url_t));
-            memset(myurl, 0, sizeof(url_t));
-          } else {
-            memcpy(&urls[url_curse], myurl, sizeof(url_t));
-            memset(myurl, 0, sizeof(url_t));
-            url_curse++;
-          }
-        }
-        for (i = 0; i < childs.count - url_valid; i++) {
-          url_free(&urls[url_curse + i]);
-          printf("%s\n", urls[url_curse + i]);
-        }
+      gpr_mu_lock(&p_listener_node->children_mu);
+      if (!p_listener_node->children_synced) {
+        zk_listener_apply_children(p_listener_node, &childs, &delta);
+        //已有的订阅函数同样需要收到本次变化
+        schedule_notify_func(p_listener_node, &delta, p_notify_node);
+        release_zk_children_delta(&delta);
       }
-      urls_num = url_valid;
-      if (url_valid == 0) {
-        urls_num = 1;
-        urls = (url_t*)gpr_zalloc(urls_num * sizeof(url_t));
-        get_service_name_from_path(p_listener_node->url_full_string, buf,
-                                   ORIENTSEC_GRPC_PATH_MAX_LEN);
-        construct_empty_schema_url(buf, urls);
-      }
-      url_free(myurl);
-      if (NULL != myurl) gpr_free(myurl);
-      /*end by lm*/
       //第一次订阅时调用回调函数
+      urls = zk_listener_full_urls(p_listener_node, &urls_num, &owned);
       notify(urls, urls_num);
-      for (i = 0; i < urls_num; i++) {
-        url_free(urls + i);
-      }
-      gpr_free(urls);
+      zk_release_full_urls(urls, owned);
+      gpr_mu_unlock(&p_listener_node->children_mu);
     }
   } else {
     gpr_log(GPR_ERROR, "add subscribe failed,reason=%s", zerror(ret));
@@ -1320,6 +1643,15 @@ void zk_subscribe(registry_service_args_t* param, url_t* url,
   FREE_PTR(url_category_path);
   return;
 }
+void zk_subscribe(registry_service_args_t* param, url_t* url,
+                  registry_notify_f notify) {
+  zk_subscribe_internal(param, url, notify, NULL);
+}
+void zk_subscribe_delta(registry_service_args_t* param, url_t* url,
+                        registry_notify_f notify,
+                        registry_delta_notify_f delta_notify) {
+  zk_subscribe_internal(param, url, notify, delta_notify);
+}
 void zk_unsubscribe(registry_service_args_t* param, url_t* url,
                     registry_notify_f notify) {
   zk_connection_t* conn = NULL;
@@ -1338,11 +1670,8 @@ void zk_unsubscribe(registry_service_args_t* param, url_t* url,
   }
   //如果该链接上的所有订阅函数已取消，则移除节点
   if (p_listener_node && (!p_listener_node->notify_list_head->next)) {
+    //节点已释放，不再访问
     remove_zk_listener_node(conn, url_category_path);
-
-    // add by huyn
-    p_listener_node->notify_list_head = NULL;
-    p_listener_node->next = NULL;
     p_listener_node = NULL;
   }
   FREE_PTR(url_category_path);
@@ -37,6 +37,7 @@ void zk_start(registry_service_args_t *param);
 void zk_registe(registry_service_args_t *param, url_t *url);
 void zk_unregiste(registry_service_args_t *param, url_t *url);
 void zk_subscribe(registry_service_args_t *param, url_t *url, registry_notify_f notify);
+void zk_subscribe_delta(registry_service_args_t *param, url_t *url, registry_notify_f notify, registry_delta_notify_f delta_notify);
 void zk_unsubscribe(registry_service_args_t *param, url_t *url, registry_notify_f notify);
 void zk_lookup(registry_service_args_t *param, url_t *src, url_t **result, int *len);
 char* zk_getData(registry_service_args_t *param, char *path);